@@ -155,25 +155,42 @@ int arch_runtime_detect_architecture(void) {
     info->page_size = 4096; // Default page size
     
     // Detect architecture family
+    int result;
 #if defined(__x86_64__) || defined(_M_X64)
-    return detect_x86_family(info);
+    result = detect_x86_family(info);
 #elif defined(__i386__) || defined(_M_IX86)
-    return detect_x86_family(info);
+    result = detect_x86_family(info);
 #elif defined(__arm__) || defined(_M_ARM)
-    return detect_arm_family(info);
+    result = detect_arm_family(info);
 #elif defined(__aarch64__) || defined(_M_ARM64)
-    return detect_arm_family(info);
+    result = detect_arm_family(info);
 #elif defined(__powerpc__) || defined(_M_PPC)
-    return detect_ppc_family(info);
+    result = detect_ppc_family(info);
 #elif defined(__m68k__) || defined(_M_M68K)
-    return detect_m68k_family(info);
+    result = detect_m68k_family(info);
 #elif defined(__mips__) || defined(_M_MIPS)
-    return detect_mips_family(info);
+    result = detect_mips_family(info);
 #else
     info->arch_type = ARCH_UNKNOWN;
     info->arch_name = "Unknown";
     return -1;
 #endif
+    if (result != 0) {
+        return result;
+    }
+
+    // Replace the per-family defaults with what the host reports
+    arch_topology_t *topology = malloc(sizeof(arch_topology_t));
+    if (topology && arch_runtime_get_topology(topology) == 0 && topology->detected) {
+        info->num_cores = topology->num_cores;
+        if (topology->l1d_size) info->cache_info.l1d_size = topology->l1d_size;
+        if (topology->l2_size) info->cache_info.l2_size = topology->l2_size;
+        if (topology->l3_size) info->cache_info.l3_size = topology->l3_size;
+        if (topology->line_size) info->cache_info.line_size = topology->line_size;
+        if (topology->associativity) info->cache_info.associativity = topology->associativity;
+    }
+    free(topology);
+    return 0;
 }
 
 // Get architecture information
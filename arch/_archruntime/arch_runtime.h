@@ -11,6 +11,8 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+#include "arch_topology.h"
+
 // Architecture types
 typedef enum {
     ARCH_UNKNOWN = 0,
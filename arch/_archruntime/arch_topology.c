@@ -0,0 +1,302 @@
+/*
+ * Host CPU Topology Detection for MIRIX Cross-Architecture Runtime
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "arch_topology.h"
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+
+// Read one integer from a sysfs file; -1 if missing
+static long read_sysfs_long(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    long value = -1;
+    if (fscanf(file, "%ld", &value) != 1) {
+        value = -1;
+    }
+    fclose(file);
+    return value;
+}
+
+// Read a cache size such as "32K" or "8192K" in bytes; 0 if missing
+static uint32_t read_sysfs_size(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    unsigned long value = 0;
+    char suffix = 0;
+    int fields = fscanf(file, "%lu%c", &value, &suffix);
+    fclose(file);
+    if (fields < 1) {
+        return 0;
+    }
+    if (suffix == 'K') {
+        value *= 1024;
+    } else if (suffix == 'M') {
+        value *= 1024 * 1024;
+    }
+    return (uint32_t)value;
+}
+
+// Parse a CPU list ("0-3,8,10-11") into a bitmap; returns the lowest CPU or -1
+static int parse_cpu_list(const char *list, unsigned char *bitmap) {
+    int lowest = -1;
+    const char *p = list;
+
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < ARCH_MAX_HOST_CPUS; cpu++) {
+            if (cpu < 0) {
+                continue;
+            }
+            if (bitmap) {
+                bitmap[cpu / 8] |= (unsigned char)(1u << (cpu % 8));
+            }
+            if (lowest < 0 || cpu < lowest) {
+                lowest = (int)cpu;
+            }
+        }
+        if (*p == ',') {
+            p++;
+        } else {
+            break;
+        }
+    }
+
+    return lowest;
+}
+
+static int read_cpu_list(const char *path, unsigned char *bitmap) {
+    char buffer[4096];
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    int lowest = -1;
+    if (fgets(buffer, sizeof(buffer), file)) {
+        lowest = parse_cpu_list(buffer, bitmap);
+    }
+    fclose(file);
+    return lowest;
+}
+
+// NUMA node of a CPU: its sysfs directory holds a "nodeN" link
+static int read_cpu_node(int cpu) {
+    char path[128];
+    snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d", cpu);
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return -1;
+    }
+
+    int node = -1;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "node", 4) == 0 && ent->d_name[4] >= '0' && ent->d_name[4] <= '9') {
+            node = atoi(ent->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// Fill the cache fields of one CPU (and the global sizes) from cache/indexN
+static void read_cpu_caches(arch_topology_t *topology, arch_cpu_topology_t *cpu) {
+    char path[160];
+    char type[32];
+
+    for (int index = 0; index < 8; index++) {
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/level", cpu->cpu, index);
+        long level = read_sysfs_long(path);
+        if (level < 0) {
+            break;
+        }
+
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/type", cpu->cpu, index);
+        FILE *file = fopen(path, "r");
+        type[0] = '\0';
+        if (file) {
+            if (!fgets(type, sizeof(type), file)) {
+                type[0] = '\0';
+            }
+            fclose(file);
+        }
+        if (strncmp(type, "Instruction", 11) == 0) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list", cpu->cpu, index);
+        int shared = read_cpu_list(path, NULL);
+
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/size", cpu->cpu, index);
+        uint32_t size = read_sysfs_size(path);
+
+        if (level == 1) {
+            if (size) topology->l1d_size = size;
+            snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/coherency_line_size", cpu->cpu, index);
+            long line = read_sysfs_long(path);
+            if (line > 0) topology->line_size = (uint32_t)line;
+        } else if (level == 2) {
+            cpu->l2_id = shared;
+            if (size) topology->l2_size = size;
+        } else if (level == 3) {
+            cpu->l3_id = shared;
+            if (size) topology->l3_size = size;
+            snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/cache/index%d/ways_of_associativity", cpu->cpu, index);
+            long ways = read_sysfs_long(path);
+            if (ways > 0) topology->associativity = (uint32_t)ways;
+        }
+    }
+}
+
+// Count distinct values of one field
+static uint32_t count_distinct(const arch_topology_t *topology, size_t offset) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < topology->num_cpus; i++) {
+        int32_t value = *(const int32_t *)((const char *)&topology->cpus[i] + offset);
+        bool seen = false;
+        for (uint32_t j = 0; j < i && !seen; j++) {
+            seen = *(const int32_t *)((const char *)&topology->cpus[j] + offset) == value;
+        }
+        if (!seen) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Without sysfs: every online CPU is a core of its own on one package
+static void fallback_topology(arch_topology_t *topology) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) {
+        online = 1;
+    }
+    if (online > ARCH_MAX_HOST_CPUS) {
+        online = ARCH_MAX_HOST_CPUS;
+    }
+
+    topology->num_cpus = (uint32_t)online;
+    for (uint32_t i = 0; i < topology->num_cpus; i++) {
+        arch_cpu_topology_t *cpu = &topology->cpus[i];
+        cpu->cpu = (int32_t)i;
+        cpu->core_id = (int32_t)i;
+        cpu->package_id = 0;
+        cpu->numa_node = 0;
+        cpu->l2_id = (int32_t)i;
+        cpu->l3_id = 0;
+        cpu->smt_index = 0;
+    }
+}
+
+// Read the host CPU topology
+int arch_runtime_get_topology(arch_topology_t *topology) {
+    if (!topology) {
+        return -1;
+    }
+
+    memset(topology, 0, sizeof(arch_topology_t));
+
+#ifdef __linux__
+    unsigned char online[ARCH_MAX_HOST_CPUS / 8];
+    memset(online, 0, sizeof(online));
+
+    if (read_cpu_list(SYSFS_CPU "/online", online) >= 0) {
+        char path[128];
+        for (int n = 0; n < ARCH_MAX_HOST_CPUS; n++) {
+            if (!(online[n / 8] & (1u << (n % 8)))) {
+                continue;
+            }
+
+            arch_cpu_topology_t *cpu = &topology->cpus[topology->num_cpus++];
+            cpu->cpu = n;
+
+            snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/physical_package_id", n);
+            long package = read_sysfs_long(path);
+            cpu->package_id = package < 0 ? 0 : (int32_t)package;
+
+            // core_id is only unique within a package; siblings share the
+            // lowest CPU of thread_siblings_list, which is unique everywhere
+            unsigned char siblings[ARCH_MAX_HOST_CPUS / 8];
+            memset(siblings, 0, sizeof(siblings));
+            snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/thread_siblings_list", n);
+            int first_sibling = read_cpu_list(path, siblings);
+            cpu->core_id = first_sibling < 0 ? n : first_sibling;
+            cpu->smt_index = 0;
+            for (int s = 0; s < n; s++) {
+                if (siblings[s / 8] & (1u << (s % 8))) {
+                    cpu->smt_index++;
+                }
+            }
+
+            cpu->numa_node = read_cpu_node(n);
+            if (cpu->numa_node < 0) {
+                cpu->numa_node = 0;
+            }
+
+            cpu->l2_id = -1;
+            cpu->l3_id = -1;
+            read_cpu_caches(topology, cpu);
+            if (cpu->l2_id < 0) {
+                cpu->l2_id = cpu->core_id;
+            }
+        }
+        topology->detected = topology->num_cpus > 0;
+    }
+#endif
+
+    if (topology->num_cpus == 0) {
+        fallback_topology(topology);
+    }
+
+    topology->num_cores = count_distinct(topology, offsetof(arch_cpu_topology_t, core_id));
+    topology->num_packages = count_distinct(topology, offsetof(arch_cpu_topology_t, package_id));
+    topology->num_nodes = count_distinct(topology, offsetof(arch_cpu_topology_t, numa_node));
+    return 0;
+}
+
+// Topology distance between two logical CPUs
+int arch_topology_distance(const arch_cpu_topology_t *a, const arch_cpu_topology_t *b) {
+    if (a->cpu == b->cpu) {
+        return 0;
+    }
+    if (a->core_id == b->core_id) {
+        return 1;
+    }
+    if (a->l2_id >= 0 && a->l2_id == b->l2_id) {
+        return 2;
+    }
+    if (a->l3_id >= 0 && a->l3_id == b->l3_id) {
+        return 3;
+    }
+    if (a->package_id == b->package_id) {
+        return 4;
+    }
+    if (a->numa_node == b->numa_node) {
+        return 5;
+    }
+    return 6;
+}
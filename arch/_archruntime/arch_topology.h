@@ -0,0 +1,50 @@
+/*
+ * MIRIX Cross-Architecture Runtime - Host CPU Topology
+ * Which logical CPUs share a core, a cache, a socket and a NUMA node
+ */
+
+#ifndef ARCH_TOPOLOGY_H
+#define ARCH_TOPOLOGY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Logical CPUs described by one topology snapshot
+#define ARCH_MAX_HOST_CPUS 1024
+
+// One logical CPU. Ids are only meaningful for equality: two CPUs with the
+// same l2_id share an L2, and so on; -1 = unknown / not shared.
+typedef struct {
+    int32_t cpu;             // Logical CPU number (affinity mask index)
+    int32_t core_id;         // Physical core, unique across packages
+    int32_t package_id;      // Socket
+    int32_t numa_node;
+    int32_t l2_id;           // Lowest CPU number sharing this CPU's L2
+    int32_t l3_id;           // Lowest CPU number sharing this CPU's L3
+    uint32_t smt_index;      // 0 for the first hardware thread of its core
+} arch_cpu_topology_t;
+
+// Host topology
+typedef struct {
+    uint32_t num_cpus;       // Online logical CPUs described in cpus[]
+    uint32_t num_cores;
+    uint32_t num_packages;
+    uint32_t num_nodes;
+    uint32_t l1d_size;       // Cache sizes in bytes, 0 = unknown
+    uint32_t l2_size;
+    uint32_t l3_size;
+    uint32_t line_size;
+    uint32_t associativity;  // Of the last-level cache
+    bool detected;           // False: read from sysconf only, one CPU per core
+    arch_cpu_topology_t cpus[ARCH_MAX_HOST_CPUS];
+} arch_topology_t;
+
+// Read the host topology (Linux sysfs; elsewhere every CPU is its own core
+// on a single package). Works without arch_runtime_init.
+int arch_runtime_get_topology(arch_topology_t *topology);
+
+// Distance between two logical CPUs: 0 same CPU, 1 SMT siblings, 2 shared
+// L2, 3 shared L3, 4 same package, 5 same NUMA node, 6 remote
+int arch_topology_distance(const arch_cpu_topology_t *a, const arch_cpu_topology_t *b);
+
+#endif // ARCH_TOPOLOGY_H
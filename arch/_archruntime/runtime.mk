@@ -5,14 +5,16 @@
 # Runtime source files
 ARCHRUNTIME_SOURCES = \
 	arch/_archruntime/arch_runtime.c \
-	arch/_archruntime/arch_detect.c
+	arch/_archruntime/arch_detect.c \
+	arch/_archruntime/arch_topology.c
 
 # Runtime object files
 ARCHRUNTIME_OBJECTS = $(ARCHRUNTIME_SOURCES:.c=.o)
 
 # Runtime headers
 ARCHRUNTIME_HEADERS = \
-	arch/_archruntime/arch_runtime.h
+	arch/_archruntime/arch_runtime.h \
+	arch/_archruntime/arch_topology.h
 
 # Include paths
 ARCHRUNTIME_INCLUDES = -Iarch/_archruntime
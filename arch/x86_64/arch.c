@@ -99,58 +99,131 @@ void arch_syscall_entry(uint64_t syscall_num, uint64_t arg1, uint64_t arg2,
     // For now, just log the call
 }
 
-// Context switching
-int arch_context_switch(arch_context_t *old_ctx, arch_context_t *new_ctx) {
-    printf("arch_context_switch: old=%p, new=%p\n", old_ctx, new_ctx);
-    
-    // In a real kernel, this would perform actual context switch
-    // For lazykernel, we rely on host threading
-    
-    return 0;
-}
+// Context switching: save the callee-saved registers, stack pointer and
+// return address of the caller in old_ctx, load new_ctx's and jump to its
+// rip. Returns 0 when something later switches back to old_ctx. Everything
+// else is caller-saved under the SysV ABI, so this is a few dozen
+// instructions instead of a host thread switch.
+#ifdef __APPLE__
+#define ARCH_ASM_FUNCTION(name) ".globl _" name "\n_" name ":\n"
+#define ARCH_ASM_END(name) ""
+#else
+#define ARCH_ASM_FUNCTION(name) ".globl " name "\n.type " name ", @function\n" name ":\n"
+#define ARCH_ASM_END(name) ".size " name ", .-" name "\n"
+#endif
 
-// Save current context
-int arch_save_context(arch_context_t *ctx) {
-    if (!ctx) return -1;
-    
-    // Restore registers
-    __asm__ volatile (
-        "movq %0, %%rsp\n"
-        "movq %1, %%rbp\n"
-        "movq %2, %%rbx\n"
-        "movq %3, %%r12\n"
-        "movq %4, %%r13\n"
-        "movq %5, %%r14\n"
-        "movq %6, %%r15\n"
-        : "=m" (ctx->rsp), "=m" (ctx->rbp), "=m" (ctx->rbx),
-          "=m" (ctx->r12), "=m" (ctx->r13), "=m" (ctx->r14), "=m" (ctx->r15)
-        : : "memory"
-    );
-    
-    return 0;
-}
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ARCH_ASM_FUNCTION("arch_context_switch")
+    "    movq (%rsp), %rdx\n"            // Resume at our return address...
+    "    leaq 8(%rsp), %rcx\n"           // ...with the return address popped
+    "    movq %rcx, 0(%rdi)\n"
+    "    movq %rbp, 8(%rdi)\n"
+    "    movq %rbx, 16(%rdi)\n"
+    "    movq %r12, 24(%rdi)\n"
+    "    movq %r13, 32(%rdi)\n"
+    "    movq %r14, 40(%rdi)\n"
+    "    movq %r15, 48(%rdi)\n"
+    "    movq %rdx, 56(%rdi)\n"
+    "    stmxcsr 64(%rdi)\n"
+    "    fnstcw 68(%rdi)\n"
+    "    movq 0(%rsi), %rsp\n"
+    "    movq 8(%rsi), %rbp\n"
+    "    movq 16(%rsi), %rbx\n"
+    "    movq 24(%rsi), %r12\n"
+    "    movq 32(%rsi), %r13\n"
+    "    movq 40(%rsi), %r14\n"
+    "    movq 48(%rsi), %r15\n"
+    "    ldmxcsr 64(%rsi)\n"
+    "    fldcw 68(%rsi)\n"
+    "    xorl %eax, %eax\n"
+    "    jmpq *56(%rsi)\n"
+    ARCH_ASM_END("arch_context_switch")
+    // First switch into a new context lands here with entry in r12 and
+    // its argument in r13, on a 16-byte aligned stack
+    ".p2align 4\n"
+    "arch_context_start:\n"
+    "    movq %r13, %rdi\n"
+    "    callq *%r12\n"
+    "    ud2\n"
+);
 
-// Restore context
-int arch_restore_context(arch_context_t *ctx) {
-    if (!ctx) return -1;
-    
-    // Restore registers
-    __asm__ volatile (
-        "movq %%rsp, %0\n"
-        "movq %%rbp, %1\n"
-        "movq %%rbx, %2\n"
-        "movq %%r12, %3\n"
-        "movq %%r13, %4\n"
-        "movq %%r14, %5\n"
-        "movq %%r15, %6\n"
-        : "=m" (ctx->rsp), "=m" (ctx->rbp), "=m" (ctx->rbx),
-          "=m" (ctx->r12), "=m" (ctx->r13), "=m" (ctx->r14), "=m" (ctx->r15)
-        : : "memory"
-    );
-    
+// Address of the start stub for arch_context_init
+extern char arch_context_start[] __asm__("arch_context_start");
+
+// Prepare ctx so the first arch_context_switch to it calls entry(arg) on
+// the given stack
+int arch_context_init(arch_context_t *ctx, void *stack, size_t stack_size,
+                      arch_context_entry_t entry, void *arg) {
+    if (!ctx || !stack || stack_size < 64 || !entry) {
+        return -1;
+    }
+
+    uintptr_t top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)15;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->rsp = top;
+    ctx->r12 = (uint64_t)(uintptr_t)entry;
+    ctx->r13 = (uint64_t)(uintptr_t)arg;
+    ctx->rip = (uint64_t)(uintptr_t)arch_context_start;
+
+    // Inherit the caller's floating point modes
+    __asm__ volatile ("stmxcsr %0\n"
+                      "fnstcw %1\n"
+                      : "=m" (ctx->mxcsr), "=m" (ctx->fpucw));
     return 0;
 }
 
+// setjmp-style save and restore on the same context layout.
+// arch_save_context returns 0 after recording its caller's resume point;
+// arch_restore_context resumes that point, where arch_save_context
+// returns 1. As with longjmp, the frame that called arch_save_context must
+// still be live, and callers see only callee-saved registers restored.
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    ARCH_ASM_FUNCTION("arch_save_context")
+    "    testq %rdi, %rdi\n"
+    "    jz 1f\n"
+    "    movq (%rsp), %rdx\n"
+    "    leaq 8(%rsp), %rcx\n"
+    "    movq %rcx, 0(%rdi)\n"
+    "    movq %rbp, 8(%rdi)\n"
+    "    movq %rbx, 16(%rdi)\n"
+    "    movq %r12, 24(%rdi)\n"
+    "    movq %r13, 32(%rdi)\n"
+    "    movq %r14, 40(%rdi)\n"
+    "    movq %r15, 48(%rdi)\n"
+    "    movq %rdx, 56(%rdi)\n"
+    "    stmxcsr 64(%rdi)\n"
+    "    fnstcw 68(%rdi)\n"
+    "    xorl %eax, %eax\n"
+    "    retq\n"
+    "1:  movl $-1, %eax\n"
+    "    retq\n"
+    ARCH_ASM_END("arch_save_context")
+    ".p2align 4\n"
+    ARCH_ASM_FUNCTION("arch_restore_context")
+    "    testq %rdi, %rdi\n"
+    "    jz 1f\n"
+    "    cmpq $0, 56(%rdi)\n"
+    "    je 1f\n"
+    "    movq 0(%rdi), %rsp\n"
+    "    movq 8(%rdi), %rbp\n"
+    "    movq 16(%rdi), %rbx\n"
+    "    movq 24(%rdi), %r12\n"
+    "    movq 32(%rdi), %r13\n"
+    "    movq 40(%rdi), %r14\n"
+    "    movq 48(%rdi), %r15\n"
+    "    ldmxcsr 64(%rdi)\n"
+    "    fldcw 68(%rdi)\n"
+    "    movl $1, %eax\n"
+    "    jmpq *56(%rdi)\n"
+    "1:  movl $-1, %eax\n"
+    "    retq\n"
+    ARCH_ASM_END("arch_restore_context")
+);
+
 // Get CPU information
 int arch_get_cpu_info(arch_cpu_info_t *info) {
     if (!info) return -1;
@@ -3,10 +3,12 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // x86_64 architecture-specific definitions
 
-// Context structure for x86_64
+// Context structure for x86_64: the SysV callee-saved state, which is all
+// a cooperative switch has to preserve (offsets are used by the switch asm)
 typedef struct {
     uint64_t rsp;    // Stack pointer
     uint64_t rbp;    // Base pointer
@@ -16,8 +18,14 @@ typedef struct {
     uint64_t r14;
     uint64_t r15;
     uint64_t rip;    // Instruction pointer (saved separately)
+    uint32_t mxcsr;  // SSE control/status
+    uint16_t fpucw;  // x87 control word
+    uint16_t reserved;
 } arch_context_t;
 
+// Entry point of a context made by arch_context_init; must not return
+typedef void (*arch_context_entry_t)(void *arg);
+
 // CPU information structure
 typedef struct {
     char vendor[13];     // CPU vendor string
@@ -110,7 +118,10 @@ typedef struct {
 // Architecture-specific functions
 int arch_init(void);
 int arch_context_switch(arch_context_t *old_ctx, arch_context_t *new_ctx);
-int arch_save_context(arch_context_t *ctx);
+int arch_context_init(arch_context_t *ctx, void *stack, size_t stack_size,
+                      arch_context_entry_t entry, void *arg);
+// setjmp/longjmp pair: save returns 0, then 1 when restored
+int arch_save_context(arch_context_t *ctx) __attribute__((returns_twice));
 int arch_restore_context(arch_context_t *ctx);
 int arch_get_cpu_info(arch_cpu_info_t *info);
 
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "uthread.h"
+#include "scheduler.h"
+#if defined(__x86_64__)
+#include "arch/x86_64/arch.h"
+#endif
+
+// Green-thread benchmark
+// Cost of a bare context switch pair (arch_context_switch there and back)
+// and of a uthread_yield round trip through a process's ready queue on one
+// vCPU. Results are printed one JSON object per line.
+
+#define BENCH_PID 0x7b000000u
+#define BENCH_DEFAULT_ITERATIONS 1000000
+
+static struct {
+    int iterations;
+} bench_config = { BENCH_DEFAULT_ITERATIONS };
+
+// Results; stdout itself carries the scheduler's setup messages
+static FILE *bench_out;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_report(const char *test, int iterations, uint64_t elapsed_ns, uint64_t switches) {
+    fprintf(bench_out, "{\"test\":\"%s\",\"iterations\":%d,\"elapsed_ns\":%llu,\"ns_per_op\":%.1f}\n",
+            test, iterations, (unsigned long long)elapsed_ns, (double)elapsed_ns / (double)switches);
+    fflush(bench_out);
+}
+
+#if defined(__x86_64__)
+
+static arch_context_t bench_main_context;
+static arch_context_t bench_peer_context;
+static uint8_t bench_peer_stack[64 * 1024];
+
+static void bench_peer(void *arg) {
+    (void)arg;
+    for (;;) {
+        arch_context_switch(&bench_peer_context, &bench_main_context);
+    }
+}
+
+// Switch into a peer context and straight back, iterations times
+static void bench_switch(void) {
+    arch_context_init(&bench_peer_context, bench_peer_stack, sizeof(bench_peer_stack), bench_peer, NULL);
+
+    int iterations = bench_config.iterations;
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < iterations; i++) {
+        arch_context_switch(&bench_main_context, &bench_peer_context);
+    }
+    bench_report("switch_pair", iterations, bench_now_ns() - start, (uint64_t)iterations);
+}
+
+#endif
+
+static uint64_t bench_yield_start;
+static uint64_t bench_yield_end;
+static int bench_yield_running;
+
+static void bench_yielder(void *arg) {
+    (void)arg;
+    uint64_t now = bench_now_ns();
+    uint64_t unset = 0;
+    __atomic_compare_exchange_n(&bench_yield_start, &unset, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+
+    for (int i = 0; i < bench_config.iterations; i++) {
+        uthread_yield();
+    }
+
+    if (__atomic_sub_fetch(&bench_yield_running, 1, __ATOMIC_ACQ_REL) == 0) {
+        __atomic_store_n(&bench_yield_end, bench_now_ns(), __ATOMIC_RELEASE);
+    }
+}
+
+// Two green threads of one process yield to each other on one vCPU; each
+// yield leaves one thread for the dispatch loop and enters the other
+static void bench_yield(void) {
+    scheduler_init_cpus(1);
+    uthread_runtime_init();
+
+    mirix_process_t process;
+    memset(&process, 0, sizeof(process));
+    process.pid = BENCH_PID;
+    strcpy(process.name, "bench-uthread");
+    process.status = MIRIX_KERNEL_STOPPED;
+    process.priority = MIRIX_SCHED_DEFAULT_PRIORITY;
+    scheduler_add_process(&process);
+
+    bench_yield_running = 2;
+    for (int i = 0; i < 2; i++) {
+        uthread_t *thread = uthread_create(BENCH_PID, bench_yielder, NULL);
+        if (thread) {
+            uthread_detach(thread);
+        }
+    }
+    scheduler_start();
+    while (!__atomic_load_n(&bench_yield_end, __ATOMIC_ACQUIRE)) {
+        usleep(1000);
+    }
+
+    int iterations = bench_config.iterations;
+    bench_report("yield", iterations, bench_yield_end - bench_yield_start, (uint64_t)iterations * 2);
+
+    scheduler_stop();
+    uthread_runtime_cleanup();
+    scheduler_remove_process(BENCH_PID);
+    scheduler_cleanup();
+}
+
+static void bench_usage(FILE *out, const char *prog) {
+    fprintf(out, "MIRIX green-thread benchmark\n");
+    fprintf(out, "Usage: %s [OPTIONS]\n\n", prog);
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -n, --iterations=N   Switch pairs and yields per thread (default %d)\n",
+            BENCH_DEFAULT_ITERATIONS);
+    fprintf(out, "  -h, --help           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                bench_config.iterations = atoi(optarg);
+                break;
+            case 'h':
+                bench_usage(stdout, argv[0]);
+                return 0;
+            default:
+                bench_usage(stderr, argv[0]);
+                return 1;
+        }
+    }
+    if (bench_config.iterations <= 0) {
+        fprintf(stderr, "Iteration count must be positive\n");
+        return 1;
+    }
+
+    // Scheduler and runtime setup messages go to stderr so stdout stays JSON
+    bench_out = fdopen(dup(STDOUT_FILENO), "w");
+    if (!bench_out) {
+        perror("bench-uthread");
+        return 1;
+    }
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+#if defined(__x86_64__)
+    bench_switch();
+#endif
+    bench_yield();
+    return 0;
+}
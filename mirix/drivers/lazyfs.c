@@ -12,6 +12,7 @@
 #include <math.h> // For ceil
 
 #include "lazyfs.h"
+#include "../host/host_interface.h"
 
 // Constants
 #define LAZYFS_SUPERBLOCK_BLOCK 0
@@ -65,13 +66,14 @@ static lazyfs_superblock_t fs_superblock = {
     .backing_file_path = {0} // Initialize fixed-size array
 };
 
-// Helper to save superblock
+// Helper to save superblock. Runs at init and shutdown, outside the host
+// event loop, so it writes synchronously; positioned so it does not move
+// the offset shared with queued host I/O on the same fd.
 static int lazyfs_save_superblock(void) {
     if (fs_superblock.backing_file_fd == -1) {
         return -1; // No backing file
     }
-    lseek(fs_superblock.backing_file_fd, 0, SEEK_SET);
-    if (write(fs_superblock.backing_file_fd, &fs_superblock, sizeof(lazyfs_superblock_t)) != sizeof(lazyfs_superblock_t)) {
+    if (pwrite(fs_superblock.backing_file_fd, &fs_superblock, sizeof(lazyfs_superblock_t), 0) != sizeof(lazyfs_superblock_t)) {
         perror("lazyfs_save_superblock: write failed");
         return -1;
     }
@@ -199,8 +201,16 @@ int lazyfs_init(const char *backing_file_path, bool case_sensitive) {
                 fs_superblock.backing_file_path[0] = '\0';
                 return -1;
             }
-    // Try to read existing superblock
-    if (read(fs_superblock.backing_file_fd, &fs_superblock, sizeof(lazyfs_superblock_t)) == sizeof(lazyfs_superblock_t)) {
+    // Block I/O on the image goes through host_interface_io_*; on io_uring
+    // the fd becomes a fixed file (a no-op elsewhere, or without a host loop)
+    host_interface_io_register_file(fs_superblock.backing_file_fd);
+
+    // Try to read existing superblock. The image holds the fd of whoever
+    // wrote it, so put the open one back.
+    int backing_file_fd = fs_superblock.backing_file_fd;
+    ssize_t loaded = pread(backing_file_fd, &fs_superblock, sizeof(lazyfs_superblock_t), 0);
+    fs_superblock.backing_file_fd = backing_file_fd;
+    if (loaded == sizeof(lazyfs_superblock_t)) {
         printf("lazyfs_init: Loaded existing filesystem from '%s'.\n", backing_file_path);
         // Root node needs to be re-pointed correctly if serialized
         // For now, assume it's valid if read succeeds, will need more complex deserialization
@@ -211,6 +221,7 @@ int lazyfs_init(const char *backing_file_path, bool case_sensitive) {
                 fs_superblock.free_inodes = 0; // Initialize free inode count
                 fs_superblock.root_inode_num = 0; // No root inode yet, will be created by lazyfs_mkdir("/")
                         if (lazyfs_save_superblock() == -1) {
+                            host_interface_io_unregister_file(fs_superblock.backing_file_fd);
                             close(fs_superblock.backing_file_fd);
                             fs_superblock.backing_file_path[0] = '\0'; // Clear the path
                             fs_superblock.backing_file_fd = -1;
@@ -225,6 +236,7 @@ int lazyfs_init(const char *backing_file_path, bool case_sensitive) {
 void lazyfs_cleanup(void) {
     if (fs_superblock.backing_file_fd != -1) {
         lazyfs_save_superblock(); // Save before closing
+        host_interface_io_unregister_file(fs_superblock.backing_file_fd);
         close(fs_superblock.backing_file_fd);
         fs_superblock.backing_file_fd = -1;
     }
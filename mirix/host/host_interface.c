@@ -4,177 +4,1561 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
-#include <sys/event.h>
 #include <sys/time.h>
 #include <fcntl.h>
 #include <time.h>
 #include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+
+// Backends built into this binary
+#if defined(__linux__) && !defined(MIRIX_HOST_NO_EPOLL)
+#define HOST_HAVE_EPOLL 1
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+#if defined(__linux__) && !defined(MIRIX_HOST_NO_URING)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#ifdef __NR_io_uring_setup
+#define HOST_HAVE_URING 1
+#endif
+#endif
+#if defined(HOST_HAVE_EPOLL) || defined(HOST_HAVE_URING)
+#define HOST_HAVE_SIGNALFD 1
+#include <sys/signalfd.h>
+#endif
+#if (!defined(MIRIX_PLATFORM_DOS) && !defined(__linux__)) || defined(MIRIX_HOST_KQUEUE)
+#define HOST_HAVE_KQUEUE 1
+#include <sys/event.h>
+#endif
 
 #include "host_interface.h"
+#include "timer_wheel.h"
+
+#ifndef NSIG
+#define NSIG 65
+#endif
+
+// Events taken per wait unless host_interface_set_poll_batch says otherwise
+#define HOST_EVENT_BATCH 64
+#define HOST_EVENT_BATCH_MAX 4096
+
+// io_uring: submission queue depth and registered file table size
+#define HOST_URING_ENTRIES 256
+#define HOST_URING_FILES 64
+
+// Per-fd registration, indexed by fd
+typedef struct {
+    void (*callback)(int fd, void *data);
+    void *data;
+    unsigned events;               // HOST_EVENT_* interest
+    int poll_index;                // Slot in pollfds (poll backend), -1 = none
+    uint32_t generation;           // io_uring: bumped per monitor so stale polls are dropped
+    int file_slot;                 // io_uring: registered file index + 1, 0 = none
+    bool monitored;
+} host_fd_t;
+
+// Asynchronous I/O operations
+typedef enum {
+    HOST_IO_READ,
+    HOST_IO_WRITE,
+    HOST_IO_RECV,
+    HOST_IO_SEND
+} host_io_op_t;
+
+// One asynchronous I/O request
+typedef struct host_io {
+    host_io_callback_t callback;
+    void *data;
+    int result;
+    struct host_io *next;          // Deferred completion list
+} host_io_t;
+
+#ifdef HOST_HAVE_URING
+// What a completion is for: the low three bits of user_data. I/O requests
+// carry their host_io_t pointer, which malloc aligns to at least 8.
+enum {
+    HOST_URING_IO = 0,
+    HOST_URING_WAKE,               // Poll on the wakeup pipe
+    HOST_URING_TIMEOUT,            // Deadline timeout (generation in the high bits)
+    HOST_URING_SIGNAL,             // Poll on the signalfd
+    HOST_URING_FD,                 // Poll on a monitored fd (fd and generation above)
+    HOST_URING_IGNORE              // Removal requests
+};
+
+#define HOST_URING_TAG(user_data) ((unsigned)((user_data) & 0x7))
+#define HOST_URING_FD_DATA(fd, gen) \
+    (((uint64_t)((gen) & 0xffffff) << 40) | ((uint64_t)(uint32_t)(fd) << 8) | HOST_URING_FD)
+
+// Mapped rings
+typedef struct {
+    int fd;
+    uint32_t features;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned sq_entries;
+    unsigned pending;              // Queued SQEs not yet handed to the kernel
+    pthread_mutex_t sq_lock;       // Producers; the CQ is reaped by the poller only
+    struct __kernel_timespec timeout;
+    uint64_t timeout_armed_ns;     // Deadline of the pending timeout, 0 = none
+    uint32_t timeout_generation;
+    int files[HOST_URING_FILES];   // Registered file table, -1 = free
+    bool files_registered;
+    struct iovec *buffers;         // Registered buffers
+    int buffer_count;
+} host_uring_t;
+#endif
+
+// Per-signal callback
+typedef struct {
+    void (*callback)(int signo, void *data);
+    void *data;
+} host_signal_t;
 
 // Host interface state
 static struct {
+    host_backend_t backend;
     int kqueue_fd;
+    int epoll_fd;
+    int timer_fd;                  // epoll: armed at the timer wheel's next deadline
+    uint64_t timer_armed_ns;       // CLOCK_MONOTONIC deadline timer_fd is set to, 0 = disarmed
+    int signal_fd;                 // epoll, io_uring: signalfd over signal_mask
+    sigset_t signal_mask;
+    int wake_fds[2];               // Self-pipe: writing wakes a blocked poll
+    pthread_mutex_t lock;          // fds, pollfds and signals
+    host_fd_t *fds;
+    int fd_capacity;
+    struct pollfd *pollfds;        // poll: monitored fds (the wake pipe is added per wait)
+    int pollfd_count;
+    host_signal_t signals[NSIG];
+    int batch;                     // Events taken per wait
+    void *events;                  // Poller's event buffer (epoll_event or kevent)
+    int events_capacity;
+    host_io_t *deferred_head;      // Completed I/O awaiting its callback (no io_uring)
+    host_io_t *deferred_tail;
+#ifdef HOST_HAVE_URING
+    host_uring_t uring;
+#endif
     bool initialized;
-} host_state;
+} host_state = {
+    .kqueue_fd = -1, .epoll_fd = -1, .timer_fd = -1, .signal_fd = -1,
+    .wake_fds = { -1, -1 }, .lock = PTHREAD_MUTEX_INITIALIZER, .batch = HOST_EVENT_BATCH,
+#ifdef HOST_HAVE_URING
+    .uring = { .fd = -1, .sq_lock = PTHREAD_MUTEX_INITIALIZER },
+#endif
+};
 
-// Initialize host interface
-int host_interface_init(void) {
-#ifdef MIRIX_PLATFORM_DOS
+// poll: signals caught by host_signal_handler and not yet dispatched
+static volatile sig_atomic_t host_signal_pending[NSIG];
+
+// Create the non-blocking wakeup pipe
+static int host_wake_init(void) {
+    if (pipe(host_state.wake_fds) == -1) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(host_state.wake_fds[i], F_SETFL, fcntl(host_state.wake_fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(host_state.wake_fds[i], F_SETFD, FD_CLOEXEC);
+    }
     return 0;
+}
+
+// Empty the wakeup pipe so the next poll can block again
+static void host_wake_drain(void) {
+    char buf[64];
+    while (read(host_state.wake_fds[0], buf, sizeof(buf)) > 0) {
+    }
+}
+
+static const char *host_backend_names[] = { "default", "epoll", "kqueue", "poll", "io_uring" };
+
+static bool host_backend_available(host_backend_t backend) {
+    switch (backend) {
+#ifdef HOST_HAVE_EPOLL
+        case HOST_BACKEND_EPOLL:
+            return true;
 #endif
-    if (host_state.initialized) {
+#ifdef HOST_HAVE_KQUEUE
+        case HOST_BACKEND_KQUEUE:
+            return true;
+#endif
+#ifdef HOST_HAVE_URING
+        case HOST_BACKEND_URING:
+            return true;
+#endif
+        case HOST_BACKEND_POLL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Pick a backend by name before init
+int host_interface_set_backend(const char *name) {
+    if (host_state.initialized || !name) {
+        return -1;
+    }
+    for (int backend = HOST_BACKEND_EPOLL; backend <= HOST_BACKEND_URING; backend++) {
+        if (strcmp(name, host_backend_names[backend]) == 0 && host_backend_available((host_backend_t)backend)) {
+            host_state.backend = (host_backend_t)backend;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *host_interface_backend_name(void) {
+    return host_backend_names[host_state.backend];
+}
+
+// Make room for fd in the fd table (caller holds lock)
+static int host_fd_reserve(int fd) {
+    if (fd < host_state.fd_capacity) {
         return 0;
     }
-    
-    // Create kqueue for event handling
+
+    int capacity = host_state.fd_capacity ? host_state.fd_capacity : 64;
+    while (capacity <= fd) {
+        capacity *= 2;
+    }
+    host_fd_t *fds = realloc(host_state.fds, sizeof(host_fd_t) * (size_t)capacity);
+    if (!fds) {
+        return -1;
+    }
+    memset(fds + host_state.fd_capacity, 0, sizeof(host_fd_t) * (size_t)(capacity - host_state.fd_capacity));
+    host_state.fds = fds;
+    host_state.fd_capacity = capacity;
+    return 0;
+}
+
+// Run a monitored fd's callback outside the lock; false if it is no
+// longer monitored
+static bool host_fd_dispatch(int fd) {
+    pthread_mutex_lock(&host_state.lock);
+    bool monitored = fd >= 0 && fd < host_state.fd_capacity && host_state.fds[fd].monitored;
+    void (*callback)(int fd, void *data) = monitored ? host_state.fds[fd].callback : NULL;
+    void *data = monitored ? host_state.fds[fd].data : NULL;
+    pthread_mutex_unlock(&host_state.lock);
+
+    if (callback) {
+        callback(fd, data);
+    }
+    return monitored;
+}
+
+// Size the poller's event buffer to the current batch (poller only)
+static int host_events_reserve(size_t event_size) {
+    int batch = __atomic_load_n(&host_state.batch, __ATOMIC_RELAXED);
+    if (host_state.events_capacity != batch) {
+        void *events = realloc(host_state.events, event_size * (size_t)batch);
+        if (!events) {
+            return host_state.events_capacity;
+        }
+        host_state.events = events;
+        host_state.events_capacity = batch;
+    }
+    return batch;
+}
+
+// Run a signal's callback outside the lock
+static void host_signal_dispatch(int signo) {
+    pthread_mutex_lock(&host_state.lock);
+    host_signal_t handler = host_state.signals[signo];
+    pthread_mutex_unlock(&host_state.lock);
+
+    if (handler.callback) {
+        handler.callback(signo, handler.data);
+    }
+}
+
+// poll: note the signal and wake the event loop (async-signal-safe)
+static void host_signal_handler(int signo) {
+    host_signal_pending[signo] = 1;
+    host_interface_wakeup();
+}
+
+#ifdef HOST_HAVE_SIGNALFD
+// Dispatch every queued signal from the signalfd
+static int host_signalfd_drain(void) {
+    struct signalfd_siginfo info[8];
+    int handled = 0;
+    ssize_t bytes;
+
+    while ((bytes = read(host_state.signal_fd, info, sizeof(info))) > 0) {
+        for (size_t i = 0; i < (size_t)bytes / sizeof(info[0]); i++) {
+            if (info[i].ssi_signo < NSIG) {
+                host_signal_dispatch((int)info[i].ssi_signo);
+                handled++;
+            }
+        }
+    }
+    return handled;
+}
+
+// Add or drop a signal from the signalfd (caller holds lock). Returns 1
+// when the signalfd was just created and still has to be watched.
+static int host_signalfd_update(int signo, bool add) {
+    sigset_t one;
+    sigemptyset(&one);
+    sigaddset(&one, signo);
+
+    if (add) {
+        sigaddset(&host_state.signal_mask, signo);
+        pthread_sigmask(SIG_BLOCK, &one, NULL);
+    } else {
+        sigdelset(&host_state.signal_mask, signo);
+    }
+
+    int fd = signalfd(host_state.signal_fd, &host_state.signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (!add) {
+        pthread_sigmask(SIG_UNBLOCK, &one, NULL);
+    }
+    if (host_state.signal_fd == -1) {
+        host_state.signal_fd = fd;
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+#ifdef HOST_HAVE_EPOLL
+static int host_epoll_add(int fd, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(host_state.epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int host_epoll_init(void) {
+    host_state.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    host_state.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (host_state.epoll_fd == -1 || host_state.timer_fd == -1) {
+        return -1;
+    }
+    host_state.timer_armed_ns = 0;
+
+    // The wakeup pipe and the timer are drained on every wakeup, so
+    // edge-triggered is enough for them too
+    if (host_epoll_add(host_state.wake_fds[0], EPOLLIN | EPOLLET) == -1 ||
+        host_epoll_add(host_state.timer_fd, EPOLLIN | EPOLLET) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+// Arm the timerfd at the timer wheel's next deadline. A timer already set
+// for sooner is left alone: it fires early at worst and is re-armed then.
+static void host_epoll_arm_timer(int timer_ms) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    if (timer_ms < 0) {
+        if (host_state.timer_armed_ns != 0) {
+            timerfd_settime(host_state.timer_fd, 0, &spec, NULL);
+            host_state.timer_armed_ns = 0;
+        }
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    uint64_t deadline_ns = now_ns + (uint64_t)timer_ms * 1000000ULL;
+    if (host_state.timer_armed_ns > now_ns && host_state.timer_armed_ns <= deadline_ns) {
+        return;
+    }
+
+    if (timer_ms == 0) {
+        deadline_ns = now_ns + 1; // 0 would disarm
+    }
+    spec.it_value.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+    spec.it_value.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+    timerfd_settime(host_state.timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+    host_state.timer_armed_ns = deadline_ns;
+}
+
+static int host_epoll_poll(int timeout_ms, int timer_ms) {
+    host_epoll_arm_timer(timer_ms);
+
+    int batch = host_events_reserve(sizeof(struct epoll_event));
+    struct epoll_event *events = host_state.events;
+    int nev = events ? epoll_wait(host_state.epoll_fd, events, batch, timeout_ms) : -1;
+    if (nev == -1) {
+        if (errno == EINTR) {
+            return timer_wheel_expire();
+        }
+        perror("epoll_wait");
+        return -1;
+    }
+
+    int handled = 0;
+    for (int i = 0; i < nev; i++) {
+        int fd = events[i].data.fd;
+        if (fd == host_state.wake_fds[0]) {
+            host_wake_drain();
+            continue;
+        }
+        if (fd == host_state.timer_fd) {
+            uint64_t expirations;
+            (void)!read(host_state.timer_fd, &expirations, sizeof(expirations));
+            host_state.timer_armed_ns = 0;
+            continue;
+        }
+        if (fd == host_state.signal_fd) {
+            handled += host_signalfd_drain();
+            continue;
+        }
+
+        // Skipped if unmonitored since the wait returned
+        if (host_fd_dispatch(fd)) {
+            handled++;
+        }
+    }
+
+    return handled + timer_wheel_expire();
+}
+
+#endif
+
+#ifdef HOST_HAVE_URING
+static int host_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int host_uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, host_state.uring.fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int host_uring_register(unsigned opcode, const void *arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, host_state.uring.fd, opcode, arg, count);
+}
+
+static int host_uring_init(void) {
+    host_uring_t *ring = &host_state.uring;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = host_uring_setup(HOST_URING_ENTRIES, &params);
+    if (ring->fd == -1) {
+        return -1;
+    }
+    fcntl(ring->fd, F_SETFD, FD_CLOEXEC);
+    ring->features = params.features;
+    ring->sq_entries = params.sq_entries;
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        ring->sq_ring = NULL;
+        return -1;
+    }
+    if (ring->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            ring->cq_ring = NULL;
+            return -1;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        return -1;
+    }
+
+    char *sq = ring->sq_ring;
+    char *cq = ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    ring->pending = 0;
+    ring->timeout_armed_ns = 0;
+
+    // A sparse file table that register_file fills slot by slot; kernels
+    // without sparse tables just go without registered files
+    for (int i = 0; i < HOST_URING_FILES; i++) {
+        ring->files[i] = -1;
+    }
+    ring->files_registered = host_uring_register(IORING_REGISTER_FILES, ring->files, HOST_URING_FILES) == 0;
+    return 0;
+}
+
+static void host_uring_cleanup(void) {
+    host_uring_t *ring = &host_state.uring;
+    // Requests still in flight are cancelled with the ring; their
+    // host_io_t records are not reclaimed
+    if (ring->sqes) {
+        munmap(ring->sqes, ring->sqes_size);
+        ring->sqes = NULL;
+    }
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    ring->cq_ring = NULL;
+    if (ring->sq_ring) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        ring->sq_ring = NULL;
+    }
+    if (ring->fd != -1) {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+    free(ring->buffers);
+    ring->buffers = NULL;
+    ring->buffer_count = 0;
+    ring->files_registered = false;
+}
+
+// Hand queued SQEs to the kernel (caller holds sq_lock)
+static int host_uring_submit_locked(void) {
+    host_uring_t *ring = &host_state.uring;
+    while (ring->pending > 0) {
+        int submitted = host_uring_enter(ring->pending, 0, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        ring->pending -= (unsigned)submitted;
+        if (submitted == 0) {
+            break;
+        }
+    }
+    return 0;
+}
+
+// Next free SQE, zeroed (caller holds sq_lock). A full queue is flushed first.
+static struct io_uring_sqe *host_uring_get_sqe(void) {
+    host_uring_t *ring = &host_state.uring;
+    unsigned tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (host_uring_submit_locked() != 0 ||
+            tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+            return NULL;
+        }
+    }
+
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    return sqe;
+}
+
+// Publish the SQE taken by host_uring_get_sqe (caller holds sq_lock)
+static void host_uring_queue(void) {
+    host_uring_t *ring = &host_state.uring;
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+}
+
+// Queue a one-shot poll on fd for HOST_EVENT_* interest
+static int host_uring_poll_add(int fd, unsigned events, uint64_t user_data, bool flush) {
+    host_uring_t *ring = &host_state.uring;
+    pthread_mutex_lock(&ring->sq_lock);
+    struct io_uring_sqe *sqe = host_uring_get_sqe();
+    if (!sqe) {
+        pthread_mutex_unlock(&ring->sq_lock);
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    unsigned mask = (events & HOST_EVENT_READ ? POLLIN | POLLRDHUP : 0) | (events & HOST_EVENT_WRITE ? POLLOUT : 0);
+    if (ring->features & IORING_FEAT_POLL_32BITS) {
+        sqe->poll32_events = mask;
+    } else {
+        sqe->poll_events = (uint16_t)mask;
+    }
+    sqe->user_data = user_data;
+    host_uring_queue();
+    int result = flush ? host_uring_submit_locked() : 0;
+    pthread_mutex_unlock(&ring->sq_lock);
+    return result;
+}
+
+// Cancel the poll queued with user_data
+static int host_uring_poll_remove(uint64_t user_data) {
+    host_uring_t *ring = &host_state.uring;
+    pthread_mutex_lock(&ring->sq_lock);
+    struct io_uring_sqe *sqe = host_uring_get_sqe();
+    if (!sqe) {
+        pthread_mutex_unlock(&ring->sq_lock);
+        return -1;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = HOST_URING_IGNORE;
+    host_uring_queue();
+    int result = host_uring_submit_locked();
+    pthread_mutex_unlock(&ring->sq_lock);
+    return result;
+}
+
+// Whether a poll completion belongs to the fd's current registration
+// (caller holds lock)
+static bool host_uring_fd_current(int fd, uint32_t generation) {
+    return fd < host_state.fd_capacity && host_state.fds[fd].monitored &&
+           (host_state.fds[fd].generation & 0xffffff) == generation;
+}
+
+// Re-arm a monitored fd's poll unless it was unmonitored meanwhile
+static void host_uring_rearm_fd(int fd, uint32_t generation) {
+    pthread_mutex_lock(&host_state.lock);
+    if (host_uring_fd_current(fd, generation)) {
+        host_uring_poll_add(fd, host_state.fds[fd].events, HOST_URING_FD_DATA(fd, generation), false);
+    }
+    pthread_mutex_unlock(&host_state.lock);
+}
+
+// Arm the deadline timeout at deadline_ns, replacing a later one (caller
+// holds sq_lock). Like the timerfd on epoll, a sooner one is left alone.
+static void host_uring_arm_timeout(uint64_t deadline_ns, uint64_t now_ns) {
+    host_uring_t *ring = &host_state.uring;
+    if (ring->timeout_armed_ns > now_ns && ring->timeout_armed_ns <= deadline_ns) {
+        return;
+    }
+
+    struct io_uring_sqe *sqe;
+    if (ring->timeout_armed_ns != 0 && (sqe = host_uring_get_sqe()) != NULL) {
+        sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = ((uint64_t)ring->timeout_generation << 8) | HOST_URING_TIMEOUT;
+        sqe->user_data = HOST_URING_IGNORE;
+        host_uring_queue();
+    }
+
+    if ((sqe = host_uring_get_sqe()) == NULL) {
+        return;
+    }
+    // The kernel copies the timespec when it takes the SQE, which happens
+    // before this is next rewritten
+    ring->timeout.tv_sec = (long long)(deadline_ns / 1000000000ULL);
+    ring->timeout.tv_nsec = (long long)(deadline_ns % 1000000000ULL);
+    ring->timeout_generation = (ring->timeout_generation + 1) & 0xffffff;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&ring->timeout;
+    sqe->len = 1;          // One timespec; the kernel rejects any other count
+    sqe->off = 0;          // Pure timeout: other completions do not end it
+    sqe->timeout_flags = IORING_TIMEOUT_ABS;
+    sqe->user_data = ((uint64_t)ring->timeout_generation << 8) | HOST_URING_TIMEOUT;
+    host_uring_queue();
+    ring->timeout_armed_ns = deadline_ns;
+}
+
+// Handle one completion; returns 1 if it counts as an event
+static int host_uring_complete(uint64_t user_data, int res) {
+    host_uring_t *ring = &host_state.uring;
+
+    switch (HOST_URING_TAG(user_data)) {
+        case HOST_URING_IO: {
+            host_io_t *io = (host_io_t *)(uintptr_t)user_data;
+            io->callback(res, io->data);
+            free(io);
+            return 1;
+        }
+        case HOST_URING_WAKE:
+            host_wake_drain();
+            host_uring_poll_add(host_state.wake_fds[0], HOST_EVENT_READ, HOST_URING_WAKE, false);
+            return 0;
+        case HOST_URING_TIMEOUT:
+            pthread_mutex_lock(&ring->sq_lock);
+            if ((user_data >> 8) == ring->timeout_generation) {
+                ring->timeout_armed_ns = 0;
+            }
+            pthread_mutex_unlock(&ring->sq_lock);
+            return 0;
+        case HOST_URING_SIGNAL: {
+            int handled = host_signalfd_drain();
+            host_uring_poll_add(host_state.signal_fd, HOST_EVENT_READ, HOST_URING_SIGNAL, false);
+            return handled;
+        }
+        case HOST_URING_FD: {
+            int fd = (int)(uint32_t)(user_data >> 8);
+            uint32_t generation = (uint32_t)(user_data >> 40);
+            pthread_mutex_lock(&host_state.lock);
+            bool current = res != -ECANCELED && host_uring_fd_current(fd, generation);
+            pthread_mutex_unlock(&host_state.lock);
+            if (!current) {
+                return 0;
+            }
+            host_fd_dispatch(fd);
+            host_uring_rearm_fd(fd, generation);
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Reap up to one batch of posted completions; the rest stay for the next
+// poll, which then does not block
+static int host_uring_reap(void) {
+    host_uring_t *ring = &host_state.uring;
+    int batch = __atomic_load_n(&host_state.batch, __ATOMIC_RELAXED);
+    int handled = 0;
+
+    unsigned head = *ring->cq_head;
+    for (int reaped = 0; reaped < batch && head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE); reaped++) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+        // Free the slot before the callback, which may submit more
+        __atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+        handled += host_uring_complete(user_data, res);
+    }
+    return handled;
+}
+
+static int host_uring_poll(int timeout_ms, int timer_ms) {
+    host_uring_t *ring = &host_state.uring;
+
+    // One absolute timeout covers both the caller's limit and the wheel
+    int wait_ms = timeout_ms;
+    if (timer_ms >= 0 && (wait_ms < 0 || timer_ms < wait_ms)) {
+        wait_ms = timer_ms;
+    }
+
+    pthread_mutex_lock(&ring->sq_lock);
+    if (wait_ms > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint64_t now_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+        host_uring_arm_timeout(now_ns + (uint64_t)wait_ms * 1000000ULL, now_ns);
+    }
+    unsigned to_submit = ring->pending;
+    ring->pending = 0;
+    pthread_mutex_unlock(&ring->sq_lock);
+
+    // Submit the batch and wait in the same call
+    bool ready = *ring->cq_head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned flags = wait_ms != 0 && !ready ? IORING_ENTER_GETEVENTS : 0;
+    if (to_submit > 0 || flags) {
+        int submitted = host_uring_enter(to_submit, flags ? 1 : 0, flags);
+        // Whatever the kernel did not take goes out with the next batch
+        unsigned taken = submitted > 0 ? (unsigned)submitted : 0;
+        if (taken < to_submit) {
+            pthread_mutex_lock(&ring->sq_lock);
+            ring->pending += to_submit - taken;
+            pthread_mutex_unlock(&ring->sq_lock);
+        }
+        if (submitted < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN) {
+            perror("io_uring_enter");
+            return -1;
+        }
+    }
+
+    return host_uring_reap() + timer_wheel_expire();
+}
+
+// Queue one I/O request
+static int host_uring_io(uint8_t opcode, int fd, void *buf, size_t len, uint64_t offset, int flags,
+                         host_io_callback_t callback, void *data) {
+    host_uring_t *ring = &host_state.uring;
+    host_io_t *io = malloc(sizeof(host_io_t));
+    if (!io) {
+        return -1;
+    }
+    io->callback = callback;
+    io->data = data;
+
+    // Registered files and buffers spare the kernel a lookup and a page pin
+    pthread_mutex_lock(&host_state.lock);
+    int file_slot = fd < host_state.fd_capacity ? host_state.fds[fd].file_slot : 0;
+    pthread_mutex_unlock(&host_state.lock);
+
+    pthread_mutex_lock(&ring->sq_lock);
+    struct io_uring_sqe *sqe = host_uring_get_sqe();
+    if (!sqe) {
+        pthread_mutex_unlock(&ring->sq_lock);
+        free(io);
+        return -1;
+    }
+    sqe->opcode = opcode;
+    sqe->fd = file_slot ? file_slot - 1 : fd;
+    sqe->flags = file_slot ? IOSQE_FIXED_FILE : 0;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = (uint32_t)len;
+    sqe->off = offset;
+    sqe->msg_flags = (uint32_t)flags;
+    sqe->user_data = (uint64_t)(uintptr_t)io;
+    if (opcode == IORING_OP_READ || opcode == IORING_OP_WRITE) {
+        for (int i = 0; i < ring->buffer_count; i++) {
+            char *base = ring->buffers[i].iov_base;
+            if ((char *)buf >= base && (char *)buf + len <= base + ring->buffers[i].iov_len) {
+                sqe->opcode = opcode == IORING_OP_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+                sqe->buf_index = (uint16_t)i;
+                break;
+            }
+        }
+    }
+    host_uring_queue();
+    pthread_mutex_unlock(&ring->sq_lock);
+    return 0;
+}
+#endif
+
+#ifdef HOST_HAVE_KQUEUE
+static int host_kqueue_init(void) {
     host_state.kqueue_fd = kqueue();
     if (host_state.kqueue_fd == -1) {
         return -1;
     }
-    
+
+    // The wakeup pipe is the one read event without a callback
+    struct kevent kev;
+    EV_SET(&kev, host_state.wake_fds[0], EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, NULL);
+    return kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL);
+}
+
+static int host_kqueue_poll(int timeout_ms) {
+    struct timespec timeout;
+    if (timeout_ms >= 0) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+    }
+
+    int batch = host_events_reserve(sizeof(struct kevent));
+    struct kevent *events = host_state.events;
+    int nev = events ? kevent(host_state.kqueue_fd, NULL, 0, events, batch, timeout_ms >= 0 ? &timeout : NULL) : -1;
+    if (nev == -1) {
+        if (errno == EINTR) {
+            return timer_wheel_expire();
+        }
+        perror("kevent");
+        return -1;
+    }
+
+    int handled = 0;
+    for (int i = 0; i < nev; i++) {
+        if (events[i].filter == EVFILT_READ && (int)events[i].ident == host_state.wake_fds[0]) {
+            host_wake_drain();
+            continue;
+        }
+
+        if (events[i].filter == EVFILT_SIGNAL) {
+            host_signal_dispatch((int)events[i].ident);
+            handled++;
+        } else if (host_fd_dispatch((int)events[i].ident)) {
+            handled++;
+        }
+    }
+
+    return handled + timer_wheel_expire();
+}
+#endif
+
+// poll: wait on the monitored fds plus the wakeup pipe
+static int host_poll_poll(int timeout_ms) {
+    pthread_mutex_lock(&host_state.lock);
+    int count = host_state.pollfd_count;
+    struct pollfd *pfds = malloc(sizeof(struct pollfd) * (size_t)(count + 1));
+    if (!pfds) {
+        pthread_mutex_unlock(&host_state.lock);
+        return -1;
+    }
+    if (count) {
+        memcpy(pfds, host_state.pollfds, sizeof(struct pollfd) * (size_t)count);
+    }
+    pthread_mutex_unlock(&host_state.lock);
+    pfds[count].fd = host_state.wake_fds[0];
+    pfds[count].events = POLLIN;
+    pfds[count].revents = 0;
+
+    int ready = poll(pfds, (nfds_t)(count + 1), timeout_ms);
+    if (ready == -1 && errno != EINTR) {
+        free(pfds);
+        return -1;
+    }
+
+    int handled = 0;
+    if (ready > 0 && pfds[count].revents) {
+        host_wake_drain();
+    }
+    for (int i = 0; ready > 0 && i < count; i++) {
+        if (pfds[i].revents && host_fd_dispatch(pfds[i].fd)) {
+            handled++;
+        }
+    }
+    free(pfds);
+
+    for (int signo = 1; signo < NSIG; signo++) {
+        if (host_signal_pending[signo]) {
+            host_signal_pending[signo] = 0;
+            host_signal_dispatch(signo);
+            handled++;
+        }
+    }
+
+    return handled + timer_wheel_expire();
+}
+
+// Queue a completed synchronous I/O for its callback (no io_uring)
+static void host_io_defer(host_io_t *io) {
+    io->next = NULL;
+    pthread_mutex_lock(&host_state.lock);
+    bool was_empty = host_state.deferred_head == NULL;
+    if (host_state.deferred_tail) {
+        host_state.deferred_tail->next = io;
+    } else {
+        host_state.deferred_head = io;
+    }
+    host_state.deferred_tail = io;
+    pthread_mutex_unlock(&host_state.lock);
+
+    // One wakeup covers the whole list
+    if (was_empty) {
+        host_interface_wakeup();
+    }
+}
+
+// Run the callbacks of deferred completions
+static int host_io_dispatch_deferred(void) {
+    pthread_mutex_lock(&host_state.lock);
+    host_io_t *io = host_state.deferred_head;
+    host_state.deferred_head = NULL;
+    host_state.deferred_tail = NULL;
+    pthread_mutex_unlock(&host_state.lock);
+
+    int handled = 0;
+    while (io) {
+        host_io_t *next = io->next;
+        io->callback(io->result, io->data);
+        free(io);
+        io = next;
+        handled++;
+    }
+    return handled;
+}
+
+// Initialize host interface
+int host_interface_init(void) {
+    if (host_state.initialized) {
+        return 0;
+    }
+
+    if (host_state.backend == HOST_BACKEND_DEFAULT) {
+#if defined(HOST_HAVE_EPOLL)
+        host_state.backend = HOST_BACKEND_EPOLL;
+#elif defined(HOST_HAVE_KQUEUE)
+        host_state.backend = HOST_BACKEND_KQUEUE;
+#else
+        host_state.backend = HOST_BACKEND_POLL;
+#endif
+    }
+
+    if (host_wake_init() != 0) {
+        return -1;
+    }
+    sigemptyset(&host_state.signal_mask);
+
+    // All kernel timers share the wheel; a new nearest deadline wakes the poller
+    if (timer_wheel_init(host_interface_wakeup) != 0) {
+        host_interface_cleanup();
+        return -1;
+    }
+
+    int result = 0;
+    switch (host_state.backend) {
+#ifdef HOST_HAVE_EPOLL
+        case HOST_BACKEND_EPOLL:
+            result = host_epoll_init();
+            break;
+#endif
+#ifdef HOST_HAVE_KQUEUE
+        case HOST_BACKEND_KQUEUE:
+            result = host_kqueue_init();
+            break;
+#endif
+#ifdef HOST_HAVE_URING
+        case HOST_BACKEND_URING:
+            result = host_uring_init();
+            if (result == 0) {
+                result = host_uring_poll_add(host_state.wake_fds[0], HOST_EVENT_READ, HOST_URING_WAKE, true);
+            }
+            break;
+#endif
+        default:
+            break;
+    }
+    if (result != 0) {
+        host_interface_cleanup();
+        return -1;
+    }
+
     host_state.initialized = true;
     return 0;
 }
 
 // Cleanup host interface
 void host_interface_cleanup(void) {
-    if (host_state.kqueue_fd != -1) {
-        close(host_state.kqueue_fd);
-        host_state.kqueue_fd = -1;
+    timer_wheel_cleanup();
+
+    for (int signo = 1; signo < NSIG; signo++) {
+        if (host_state.signals[signo].callback) {
+            host_interface_unmonitor_signal(signo);
+        }
     }
+
+#ifdef HOST_HAVE_URING
+    host_uring_cleanup();
+#endif
+
+    int *fds[] = { &host_state.kqueue_fd, &host_state.epoll_fd, &host_state.timer_fd, &host_state.signal_fd,
+                   &host_state.wake_fds[0], &host_state.wake_fds[1] };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] != -1) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+
+    pthread_mutex_lock(&host_state.lock);
+    free(host_state.fds);
+    host_state.fds = NULL;
+    host_state.fd_capacity = 0;
+    free(host_state.pollfds);
+    host_state.pollfds = NULL;
+    host_state.pollfd_count = 0;
+    free(host_state.events);
+    host_state.events = NULL;
+    host_state.events_capacity = 0;
+    while (host_state.deferred_head) {
+        host_io_t *io = host_state.deferred_head;
+        host_state.deferred_head = io->next;
+        free(io);
+    }
+    host_state.deferred_tail = NULL;
+    pthread_mutex_unlock(&host_state.lock);
+
     host_state.initialized = false;
 }
 
-// Poll for host events
-int host_interface_poll_events(void) {
-#ifdef MIRIX_PLATFORM_DOS
-    return 0;
-#endif
+// Wake a thread blocked in host_interface_poll_events (async-signal-safe)
+void host_interface_wakeup(void) {
+    if (host_state.wake_fds[1] != -1) {
+        char byte = 0;
+        // A full pipe already guarantees a pending wakeup
+        (void)!write(host_state.wake_fds[1], &byte, 1);
+    }
+}
+
+// Wait up to timeout_ms for host events and handle them (-1 = until an
+// event or host_interface_wakeup, 0 = don't block). The wait is also cut
+// short at the nearest kernel timer deadline, which stands in for a single
+// host timer (a timerfd on epoll, a timeout request on io_uring). Returns
+// the number of events, I/O completions and timers handled, 0 on timeout
+// or wakeup.
+int host_interface_poll_events(int timeout_ms) {
     if (!host_state.initialized) {
         return -1;
     }
-    
-    struct kevent events[10];
-    int nev = kevent(host_state.kqueue_fd, NULL, 0, events, 10, NULL);
-    
-    if (nev == -1) {
-        perror("kevent");
+
+    int timer_ms = timer_wheel_next_timeout();
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        return host_uring_poll(timeout_ms, timer_ms);
+    }
+#endif
+
+    int handled;
+#ifdef HOST_HAVE_EPOLL
+    if (host_state.backend == HOST_BACKEND_EPOLL) {
+        handled = host_epoll_poll(timeout_ms, timer_ms);
+        return handled < 0 ? handled : handled + host_io_dispatch_deferred();
+    }
+#endif
+
+    if (timer_ms >= 0 && (timeout_ms < 0 || timer_ms < timeout_ms)) {
+        timeout_ms = timer_ms;
+    }
+#ifdef HOST_HAVE_KQUEUE
+    if (host_state.backend == HOST_BACKEND_KQUEUE) {
+        handled = host_kqueue_poll(timeout_ms);
+        return handled < 0 ? handled : handled + host_io_dispatch_deferred();
+    }
+#endif
+    handled = host_poll_poll(timeout_ms);
+    return handled < 0 ? handled : handled + host_io_dispatch_deferred();
+}
+
+// Add file descriptor to monitor
+int host_interface_monitor_fd(int fd, void (*callback)(int fd, void *data), void *data) {
+    return host_interface_monitor_fd_events(fd, HOST_EVENT_READ, callback, data);
+}
+
+int host_interface_monitor_fd_events(int fd, unsigned events, void (*callback)(int fd, void *data), void *data) {
+    events &= HOST_EVENT_READ | HOST_EVENT_WRITE;
+    if (!host_state.initialized || fd < 0 || !callback || !events) {
         return -1;
     }
-    
-    for (int i = 0; i < nev; i++) {
-        // Handle different types of events
-        switch (events[i].filter) {
-            case EVFILT_READ:
-                handle_read_event(&events[i]);
+
+    pthread_mutex_lock(&host_state.lock);
+    if (host_fd_reserve(fd) != 0 || host_state.fds[fd].monitored) {
+        pthread_mutex_unlock(&host_state.lock);
+        return -1;
+    }
+    // Registered before the backend can report the fd; the poller takes
+    // the lock before reading it
+    host_state.fds[fd].callback = callback;
+    host_state.fds[fd].data = data;
+    host_state.fds[fd].events = events;
+    host_state.fds[fd].monitored = true;
+
+    int result = 0;
+    switch (host_state.backend) {
+#ifdef HOST_HAVE_EPOLL
+        case HOST_BACKEND_EPOLL:
+            result = host_epoll_add(fd, (events & HOST_EVENT_READ ? EPOLLIN | EPOLLRDHUP : 0) |
+                                        (events & HOST_EVENT_WRITE ? EPOLLOUT : 0) | EPOLLET);
+            if (result == -1) {
+                perror("epoll_ctl add");
+            }
+            break;
+#endif
+#ifdef HOST_HAVE_KQUEUE
+        case HOST_BACKEND_KQUEUE: {
+            struct kevent kev[2];
+            int nkev = 0;
+            if (events & HOST_EVENT_READ) {
+                EV_SET(&kev[nkev++], fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, NULL);
+            }
+            if (events & HOST_EVENT_WRITE) {
+                EV_SET(&kev[nkev++], fd, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, NULL);
+            }
+            result = kevent(host_state.kqueue_fd, kev, nkev, NULL, 0, NULL);
+            if (result == -1) {
+                perror("kevent add");
+            }
+            break;
+        }
+#endif
+#ifdef HOST_HAVE_URING
+        case HOST_BACKEND_URING: {
+            // One-shot polls, re-armed after each event
+            uint32_t generation = ++host_state.fds[fd].generation & 0xffffff;
+            result = host_uring_poll_add(fd, events, HOST_URING_FD_DATA(fd, generation), true);
+            break;
+        }
+#endif
+        default: {
+            struct pollfd *pollfds = realloc(host_state.pollfds, sizeof(struct pollfd) * (size_t)(host_state.pollfd_count + 1));
+            if (!pollfds) {
+                result = -1;
                 break;
-            case EVFILT_WRITE:
-                handle_write_event(&events[i]);
+            }
+            host_state.pollfds = pollfds;
+            host_state.fds[fd].poll_index = host_state.pollfd_count;
+            pollfds[host_state.pollfd_count].fd = fd;
+            pollfds[host_state.pollfd_count].events = (short)((events & HOST_EVENT_READ ? POLLIN : 0) |
+                                                              (events & HOST_EVENT_WRITE ? POLLOUT : 0));
+            pollfds[host_state.pollfd_count].revents = 0;
+            host_state.pollfd_count++;
+            break;
+        }
+    }
+
+    if (result != 0) {
+        host_state.fds[fd].monitored = false;
+        host_state.fds[fd].callback = NULL;
+        host_state.fds[fd].data = NULL;
+    }
+    pthread_mutex_unlock(&host_state.lock);
+
+    // poll picks up the new fd on its next wait
+    if (result == 0 && host_state.backend == HOST_BACKEND_POLL) {
+        host_interface_wakeup();
+    }
+    return result == 0 ? 0 : -1;
+}
+
+// Remove file descriptor from monitoring
+int host_interface_unmonitor_fd(int fd) {
+    if (!host_state.initialized || fd < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&host_state.lock);
+    if (fd >= host_state.fd_capacity || !host_state.fds[fd].monitored) {
+        pthread_mutex_unlock(&host_state.lock);
+        return -1;
+    }
+
+    int result = 0;
+    switch (host_state.backend) {
+#ifdef HOST_HAVE_EPOLL
+        case HOST_BACKEND_EPOLL:
+            result = epoll_ctl(host_state.epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            if (result == -1 && errno != EBADF) {
+                perror("epoll_ctl delete");
+            }
+            result = 0; // A closed fd has already left the set
+            break;
+#endif
+#ifdef HOST_HAVE_KQUEUE
+        case HOST_BACKEND_KQUEUE: {
+            struct kevent kev[2];
+            int nkev = 0;
+            if (host_state.fds[fd].events & HOST_EVENT_READ) {
+                EV_SET(&kev[nkev++], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+            }
+            if (host_state.fds[fd].events & HOST_EVENT_WRITE) {
+                EV_SET(&kev[nkev++], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+            }
+            result = kevent(host_state.kqueue_fd, kev, nkev, NULL, 0, NULL);
+            if (result == -1) {
+                perror("kevent delete");
+            }
+            break;
+        }
+#endif
+#ifdef HOST_HAVE_URING
+        case HOST_BACKEND_URING:
+            result = host_uring_poll_remove(HOST_URING_FD_DATA(fd, host_state.fds[fd].generation));
+            break;
+#endif
+        default: {
+            // Move the last entry into the hole
+            int index = host_state.fds[fd].poll_index;
+            int last = --host_state.pollfd_count;
+            if (index != last) {
+                host_state.pollfds[index] = host_state.pollfds[last];
+                host_state.fds[host_state.pollfds[index].fd].poll_index = index;
+            }
+            host_state.fds[fd].poll_index = -1;
+            break;
+        }
+    }
+
+    host_state.fds[fd].monitored = false;
+    host_state.fds[fd].callback = NULL;
+    host_state.fds[fd].data = NULL;
+    host_state.fds[fd].events = 0;
+    pthread_mutex_unlock(&host_state.lock);
+    return result == 0 ? 0 : -1;
+}
+
+// Deliver a signal through the event loop instead of a handler
+int host_interface_monitor_signal(int signo, void (*callback)(int signo, void *data), void *data) {
+    if (!host_state.initialized || signo <= 0 || signo >= NSIG || !callback ||
+        signo == SIGKILL || signo == SIGSTOP) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&host_state.lock);
+    bool added = host_state.signals[signo].callback == NULL;
+    host_state.signals[signo].callback = callback;
+    host_state.signals[signo].data = data;
+
+    int result = 0;
+    if (added) {
+        switch (host_state.backend) {
+#ifdef HOST_HAVE_EPOLL
+            case HOST_BACKEND_EPOLL:
+                result = host_signalfd_update(signo, true);
+                if (result == 1) {
+                    result = host_epoll_add(host_state.signal_fd, EPOLLIN | EPOLLET);
+                }
                 break;
-            case EVFILT_TIMER:
-                handle_timer_event(&events[i]);
+#endif
+#ifdef HOST_HAVE_KQUEUE
+            case HOST_BACKEND_KQUEUE: {
+                // kqueue records signals even when they are ignored
+                struct kevent kev;
+                signal(signo, SIG_IGN);
+                EV_SET(&kev, signo, EVFILT_SIGNAL, EV_ADD | EV_ENABLE, 0, 0, NULL);
+                result = kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL);
+                break;
+            }
+#endif
+#ifdef HOST_HAVE_URING
+            case HOST_BACKEND_URING:
+                result = host_signalfd_update(signo, true);
+                if (result == 1) {
+                    result = host_uring_poll_add(host_state.signal_fd, HOST_EVENT_READ, HOST_URING_SIGNAL, true);
+                }
                 break;
-            default:
-                printf("Unknown event filter: %d\n", events[i].filter);
+#endif
+            default: {
+                struct sigaction sa;
+                memset(&sa, 0, sizeof(sa));
+                sa.sa_handler = host_signal_handler;
+                sigemptyset(&sa.sa_mask);
+                sa.sa_flags = SA_RESTART;
+                result = sigaction(signo, &sa, NULL);
                 break;
+            }
         }
     }
-    
-    return nev;
+    if (result != 0) {
+        host_state.signals[signo].callback = NULL;
+        host_state.signals[signo].data = NULL;
+    }
+    pthread_mutex_unlock(&host_state.lock);
+    return result == 0 ? 0 : -1;
 }
 
-// Add file descriptor to monitor
-int host_interface_monitor_fd(int fd, void (*callback)(int fd, void *data), void *data) {
-#ifdef MIRIX_PLATFORM_DOS
-    (void)fd;
-    (void)callback;
-    (void)data;
-    return -1;
-#endif
-    if (!host_state.initialized) {
+// Restore default delivery of a signal
+int host_interface_unmonitor_signal(int signo) {
+    if (signo <= 0 || signo >= NSIG) {
         return -1;
     }
-    
-    struct kevent kev;
-    EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, data);
-    
-    if (kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL) == -1) {
-        perror("kevent add");
+
+    pthread_mutex_lock(&host_state.lock);
+    if (!host_state.signals[signo].callback) {
+        pthread_mutex_unlock(&host_state.lock);
         return -1;
     }
-    
+    host_state.signals[signo].callback = NULL;
+    host_state.signals[signo].data = NULL;
+
+    switch (host_state.backend) {
+#ifdef HOST_HAVE_EPOLL
+        case HOST_BACKEND_EPOLL:
+            host_signalfd_update(signo, false);
+            break;
+#endif
+#ifdef HOST_HAVE_KQUEUE
+        case HOST_BACKEND_KQUEUE: {
+            struct kevent kev;
+            EV_SET(&kev, signo, EVFILT_SIGNAL, EV_DELETE, 0, 0, NULL);
+            kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL);
+            signal(signo, SIG_DFL);
+            break;
+        }
+#endif
+#ifdef HOST_HAVE_URING
+        case HOST_BACKEND_URING:
+            host_signalfd_update(signo, false);
+            break;
+#endif
+        default:
+            signal(signo, SIG_DFL);
+            host_signal_pending[signo] = 0;
+            break;
+    }
+    pthread_mutex_unlock(&host_state.lock);
     return 0;
 }
 
-// Remove file descriptor from monitoring
-int host_interface_unmonitor_fd(int fd) {
-#ifdef MIRIX_PLATFORM_DOS
-    (void)fd;
-    return -1;
-#endif
-    if (!host_state.initialized) {
+// Events handled per wait; read by the poller at its next wait
+int host_interface_set_poll_batch(int events) {
+    if (events < 1 || events > HOST_EVENT_BATCH_MAX) {
         return -1;
     }
-    
-    struct kevent kev;
-    EV_SET(&kev, fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-    
-    if (kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL) == -1) {
-        perror("kevent delete");
+    __atomic_store_n(&host_state.batch, events, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// Start one asynchronous I/O: queued on io_uring, run at once elsewhere
+static int host_io_submit(host_io_op_t op, int fd, void *buf, size_t len, off_t offset, int flags,
+                          host_io_callback_t callback, void *data) {
+    if (!host_state.initialized || fd < 0 || !callback) {
         return -1;
     }
-    
+
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        static const uint8_t opcodes[] = { IORING_OP_READ, IORING_OP_WRITE, IORING_OP_RECV, IORING_OP_SEND };
+        // Sockets take no offset
+        uint64_t off = op == HOST_IO_READ || op == HOST_IO_WRITE ? (uint64_t)(int64_t)offset : 0;
+        return host_uring_io(opcodes[op], fd, buf, len, off, flags, callback, data);
+    }
+#endif
+
+    host_io_t *io = malloc(sizeof(host_io_t));
+    if (!io) {
+        return -1;
+    }
+    io->callback = callback;
+    io->data = data;
+
+    ssize_t result;
+    switch (op) {
+        case HOST_IO_READ:
+            result = offset == -1 ? read(fd, buf, len) : pread(fd, buf, len, offset);
+            break;
+        case HOST_IO_WRITE:
+            result = offset == -1 ? write(fd, buf, len) : pwrite(fd, buf, len, offset);
+            break;
+        case HOST_IO_RECV:
+            result = recv(fd, buf, len, flags);
+            break;
+        default:
+            result = send(fd, buf, len, flags);
+            break;
+    }
+    io->result = result < 0 ? -errno : (int)result;
+    host_io_defer(io);
     return 0;
 }
 
-// Create timer
-int host_interface_create_timer(uint64_t interval_ms, bool periodic, 
-                              void (*callback)(void *data), void *data) {
-#ifdef MIRIX_PLATFORM_DOS
-    (void)interval_ms;
-    (void)periodic;
-    (void)callback;
-    (void)data;
-    return -1;
-#endif
+int host_interface_io_read(int fd, void *buf, size_t len, off_t offset, host_io_callback_t callback, void *data) {
+    return host_io_submit(HOST_IO_READ, fd, buf, len, offset, 0, callback, data);
+}
+
+int host_interface_io_write(int fd, const void *buf, size_t len, off_t offset, host_io_callback_t callback, void *data) {
+    return host_io_submit(HOST_IO_WRITE, fd, (void *)buf, len, offset, 0, callback, data);
+}
+
+int host_interface_io_recv(int fd, void *buf, size_t len, int flags, host_io_callback_t callback, void *data) {
+    return host_io_submit(HOST_IO_RECV, fd, buf, len, 0, flags, callback, data);
+}
+
+int host_interface_io_send(int fd, const void *buf, size_t len, int flags, host_io_callback_t callback, void *data) {
+    return host_io_submit(HOST_IO_SEND, fd, (void *)buf, len, 0, flags, callback, data);
+}
+
+// Send the queued batch to the host now instead of at the next poll
+int host_interface_io_flush(void) {
     if (!host_state.initialized) {
         return -1;
     }
-    
-    struct kevent kev;
-    
-    // Use kqueue timer instead of timerfd (macOS compatible)
-    EV_SET(&kev, 1, EVFILT_TIMER, EV_ADD | EV_ENABLE, 0, interval_ms, data);
-    
-    if (kevent(host_state.kqueue_fd, &kev, 1, NULL, 0, NULL) == -1) {
-        perror("kevent timer");
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        pthread_mutex_lock(&host_state.uring.sq_lock);
+        int result = host_uring_submit_locked();
+        pthread_mutex_unlock(&host_state.uring.sq_lock);
+        return result;
+    }
+#endif
+    return 0;
+}
+
+int host_interface_io_register_buffers(const struct iovec *iov, int count) {
+    if (!host_state.initialized || !iov || count <= 0) {
         return -1;
     }
-    
-    return 1; // Return timer ID
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        host_uring_t *ring = &host_state.uring;
+        if (ring->buffers) {
+            return -1;
+        }
+        struct iovec *buffers = malloc(sizeof(struct iovec) * (size_t)count);
+        if (!buffers) {
+            return -1;
+        }
+        memcpy(buffers, iov, sizeof(struct iovec) * (size_t)count);
+        if (host_uring_register(IORING_REGISTER_BUFFERS, buffers, (unsigned)count) != 0) {
+            free(buffers);
+            return -1;
+        }
+        // Published under sq_lock, which host_uring_io reads them under
+        pthread_mutex_lock(&ring->sq_lock);
+        ring->buffers = buffers;
+        ring->buffer_count = count;
+        pthread_mutex_unlock(&ring->sq_lock);
+    }
+#endif
+    return 0;
 }
 
-// Event handlers
-static void handle_read_event(struct kevent *event) {
-    int fd = event->ident;
-    void *data = event->udata;
-    
-    // Call the registered callback if available
-    if (data) {
-        // In a real implementation, you'd have a callback registry
-        printf("Read event on fd %d\n", fd);
+int host_interface_io_register_file(int fd) {
+    if (!host_state.initialized || fd < 0) {
+        return -1;
+    }
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        host_uring_t *ring = &host_state.uring;
+        pthread_mutex_lock(&host_state.lock);
+        if (!ring->files_registered || host_fd_reserve(fd) != 0) {
+            pthread_mutex_unlock(&host_state.lock);
+            return -1;
+        }
+        if (host_state.fds[fd].file_slot) {
+            pthread_mutex_unlock(&host_state.lock);
+            return 0;
+        }
+        int slot = 0;
+        while (slot < HOST_URING_FILES && ring->files[slot] != -1) {
+            slot++;
+        }
+        struct io_uring_files_update update = { .offset = (uint32_t)slot, .fds = (uint64_t)(uintptr_t)&fd };
+        if (slot == HOST_URING_FILES || host_uring_register(IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+            pthread_mutex_unlock(&host_state.lock);
+            return -1;
+        }
+        ring->files[slot] = fd;
+        host_state.fds[fd].file_slot = slot + 1;
+        pthread_mutex_unlock(&host_state.lock);
     }
+#endif
+    return 0;
 }
 
-static void handle_write_event(struct kevent *event) {
-    int fd = event->ident;
-    printf("Write event on fd %d\n", fd);
+int host_interface_io_unregister_file(int fd) {
+    if (!host_state.initialized || fd < 0) {
+        return -1;
+    }
+#ifdef HOST_HAVE_URING
+    if (host_state.backend == HOST_BACKEND_URING) {
+        host_uring_t *ring = &host_state.uring;
+        pthread_mutex_lock(&host_state.lock);
+        int slot = fd < host_state.fd_capacity ? host_state.fds[fd].file_slot - 1 : -1;
+        if (slot < 0) {
+            pthread_mutex_unlock(&host_state.lock);
+            return -1;
+        }
+        // Queued requests name the slot, so send them while it still holds fd
+        host_interface_io_flush();
+        int none = -1;
+        struct io_uring_files_update update = { .offset = (uint32_t)slot, .fds = (uint64_t)(uintptr_t)&none };
+        host_uring_register(IORING_REGISTER_FILES_UPDATE, &update, 1);
+        ring->files[slot] = -1;
+        host_state.fds[fd].file_slot = 0;
+        pthread_mutex_unlock(&host_state.lock);
+    }
+#endif
+    return 0;
 }
 
-static void handle_timer_event(struct kevent *event) {
-    int timer_id = event->ident;
-    uint64_t count = event->data;
-    
-    printf("Timer %d triggered %llu times\n", timer_id, (unsigned long long)count);
+// Create timer; callback runs on the thread polling host events
+int host_interface_create_timer(uint64_t interval_ms, bool periodic,
+                              void (*callback)(void *data), void *data) {
+    if (!host_state.initialized) {
+        return -1;
+    }
+
+    return timer_wheel_add(interval_ms, periodic ? interval_ms : 0, callback, data);
+}
+
+// Cancel a timer
+int host_interface_cancel_timer(int timer_id) {
+    if (!host_state.initialized) {
+        return -1;
+    }
+
+    return timer_wheel_cancel(timer_id);
 }
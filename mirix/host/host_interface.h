@@ -4,26 +4,71 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
-// Forward declarations
-struct kevent;
+// Host event backends. epoll and io_uring are built on Linux, kqueue on the
+// BSDs and macOS (or with -DMIRIX_HOST_KQUEUE against a compatibility
+// library), and poll everywhere; the default is the first of epoll, kqueue
+// and poll available. io_uring is opted into by name.
+typedef enum {
+    HOST_BACKEND_DEFAULT = 0,
+    HOST_BACKEND_EPOLL,
+    HOST_BACKEND_KQUEUE,
+    HOST_BACKEND_POLL,
+    HOST_BACKEND_URING
+} host_backend_t;
 
 // Host interface API
 int host_interface_init(void);
 void host_interface_cleanup(void);
-int host_interface_poll_events(void);
+int host_interface_poll_events(int timeout_ms);
+void host_interface_wakeup(void);
 
-// File descriptor monitoring
+// Most events handled per wait (default 64); takes effect at the next wait
+int host_interface_set_poll_batch(int events);
+
+// Pick a backend by name ("epoll", "kqueue", "poll", "io_uring") before
+// host_interface_init; -1 if it is not built in
+int host_interface_set_backend(const char *name);
+const char *host_interface_backend_name(void);
+
+// File descriptor monitoring. The callback runs on the polling thread when
+// any event of interest is ready; monitor_fd is read interest. On epoll
+// readiness is edge-triggered: a callback must read (or write) until
+// EAGAIN or it will not hear about the rest.
+#define HOST_EVENT_READ  0x1
+#define HOST_EVENT_WRITE 0x2
 int host_interface_monitor_fd(int fd, void (*callback)(int fd, void *data), void *data);
+int host_interface_monitor_fd_events(int fd, unsigned events, void (*callback)(int fd, void *data), void *data);
 int host_interface_unmonitor_fd(int fd);
 
+// Signal delivery through the event loop (signalfd on epoll). The signal
+// is blocked in the calling thread, so register before starting others.
+int host_interface_monitor_signal(int signo, void (*callback)(int signo, void *data), void *data);
+int host_interface_unmonitor_signal(int signo);
+
+// Asynchronous host I/O. Requests are queued and go to the host in one
+// batch at host_interface_io_flush or the next poll; the callback runs on
+// the polling thread with the byte count or -errno. An offset of -1 uses
+// the file position. Without io_uring the operation runs at once and only
+// the callback is deferred.
+typedef void (*host_io_callback_t)(int result, void *data);
+int host_interface_io_read(int fd, void *buf, size_t len, off_t offset, host_io_callback_t callback, void *data);
+int host_interface_io_write(int fd, const void *buf, size_t len, off_t offset, host_io_callback_t callback, void *data);
+int host_interface_io_recv(int fd, void *buf, size_t len, int flags, host_io_callback_t callback, void *data);
+int host_interface_io_send(int fd, const void *buf, size_t len, int flags, host_io_callback_t callback, void *data);
+int host_interface_io_flush(void);
+
+// Pin long-lived buffers and fds in the kernel (io_uring) so I/O on them
+// skips per-request page mapping and fd lookup; no-ops on other backends.
+// Buffers can be registered once, before they are used.
+int host_interface_io_register_buffers(const struct iovec *iov, int count);
+int host_interface_io_register_file(int fd);
+int host_interface_io_unregister_file(int fd);
+
 // Timer management
-int host_interface_create_timer(uint64_t interval_ms, bool periodic, 
+int host_interface_create_timer(uint64_t interval_ms, bool periodic,
                               void (*callback)(void *data), void *data);
-
-// Internal event handlers
-static void handle_read_event(struct kevent *event);
-static void handle_write_event(struct kevent *event);
-static void handle_timer_event(struct kevent *event);
+int host_interface_cancel_timer(int timer_id);
 
 #endif // MIRIX_HOST_INTERFACE_H
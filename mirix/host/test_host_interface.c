@@ -0,0 +1,314 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_interface.h"
+
+// Host interface regression tests
+// Every test runs once per backend built into this host (epoll, kqueue,
+// poll, io_uring), each time against a freshly initialized interface.
+// Waits are bounded, so a backend that misses an event fails on time
+// instead of hanging.
+
+// How late an event may be handled before the test counts it as missed
+#define TEST_SLACK_MS 200
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: [%s] ", __FILE__, __LINE__, test_backend); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+static const char *test_backends[] = { "epoll", "kqueue", "poll", "io_uring" };
+static const char *test_backend;
+
+static uint64_t test_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static int test_pipe(int fds[2]) {
+    if (pipe(fds) == -1) {
+        return -1;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+// Readable-fd callback: drains the pipe (epoll is edge-triggered) and
+// counts the call in *data
+static void test_fd_ready(int fd, void *data) {
+    char buf[64];
+    while (read(fd, buf, sizeof(buf)) > 0) {
+    }
+    __atomic_add_fetch((int *)data, 1, __ATOMIC_ACQ_REL);
+}
+
+// Poll from this thread until *count reaches want or limit_ms passes
+static void test_poll_until(const int *count, int want, uint64_t limit_ms) {
+    uint64_t start = test_now_ms();
+    while (__atomic_load_n(count, __ATOMIC_ACQUIRE) < want && test_now_ms() - start < limit_ms) {
+        host_interface_poll_events((int)limit_ms);
+    }
+}
+
+// The backend asked for is the one running
+static void test_selection(void) {
+    TEST_CHECK(strcmp(host_interface_backend_name(), test_backend) == 0, "running %s",
+               host_interface_backend_name());
+    TEST_CHECK(host_interface_set_backend("poll") == -1, "backend switched while initialized");
+    TEST_CHECK(host_interface_set_backend("none") == -1, "unknown backend accepted");
+}
+
+// Each write to a monitored pipe is reported once; on io_uring every
+// report re-arms the one-shot poll
+static void test_fd_readiness(void) {
+    int fds[2];
+    int calls = 0;
+    TEST_CHECK(test_pipe(fds) == 0, "pipe failed");
+    TEST_CHECK(host_interface_monitor_fd(fds[0], test_fd_ready, &calls) == 0, "monitor failed");
+    TEST_CHECK(host_interface_monitor_fd(fds[0], test_fd_ready, &calls) == -1, "fd monitored twice");
+
+    for (int round = 1; round <= 3; round++) {
+        (void)!write(fds[1], "x", 1);
+        test_poll_until(&calls, round, TEST_SLACK_MS);
+        TEST_CHECK(calls == round, "round %d: callback ran %d times", round, calls);
+    }
+
+    // Nothing written: a non-blocking poll reports nothing
+    host_interface_poll_events(0);
+    TEST_CHECK(calls == 3, "callback ran without data");
+
+    TEST_CHECK(host_interface_unmonitor_fd(fds[0]) == 0, "unmonitor failed");
+    TEST_CHECK(host_interface_unmonitor_fd(fds[0]) == -1, "fd unmonitored twice");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static int test_timer_fired;
+static uint64_t test_timer_at;
+
+static void test_timer(void *data) {
+    (void)data;
+    test_timer_at = test_now_ms();
+    __atomic_add_fetch(&test_timer_fired, 1, __ATOMIC_ACQ_REL);
+}
+
+// A wait with a long timeout ends at the nearest timer deadline, and a
+// periodic timer keeps firing until cancelled
+static void test_timers(void) {
+    test_timer_fired = 0;
+    uint64_t start = test_now_ms();
+    TEST_CHECK(host_interface_create_timer(20, false, test_timer, NULL) > 0, "timer not created");
+    // Adding the timer wakes the poller once; a wait that is not cut short
+    // at the deadline runs its full 5 s and fails the timing check
+    while (test_timer_fired == 0 && test_now_ms() - start < 1000) {
+        host_interface_poll_events(5000);
+    }
+    TEST_CHECK(test_timer_fired == 1, "one-shot timer fired %d times", test_timer_fired);
+    TEST_CHECK(test_timer_at - start >= 20 && test_timer_at - start <= 20 + TEST_SLACK_MS,
+               "20 ms timer fired after %llu ms", (unsigned long long)(test_timer_at - start));
+
+    test_timer_fired = 0;
+    start = test_now_ms();
+    int id = host_interface_create_timer(10, true, test_timer, NULL);
+    TEST_CHECK(id > 0, "periodic timer not created");
+    test_poll_until(&test_timer_fired, 3, 30 + TEST_SLACK_MS);
+    TEST_CHECK(test_timer_fired == 3, "periodic timer fired %d times", test_timer_fired);
+    TEST_CHECK(host_interface_cancel_timer(id) == 0, "periodic timer not cancelled");
+
+    test_timer_fired = 0;
+    host_interface_poll_events(50);
+    TEST_CHECK(test_timer_fired == 0, "cancelled timer fired");
+}
+
+// An fd that became ready, then was unmonitored and monitored again
+// before anyone polled: the readiness seen under the old registration
+// (an already completed poll on io_uring) must not reach the new callback
+// twice or the old one at all
+static void test_stale_readiness(void) {
+    int fds[2];
+    int first = 0, second = 0;
+    TEST_CHECK(test_pipe(fds) == 0, "pipe failed");
+    TEST_CHECK(host_interface_monitor_fd(fds[0], test_fd_ready, &first) == 0, "monitor failed");
+    (void)!write(fds[1], "x", 1);
+    TEST_CHECK(host_interface_unmonitor_fd(fds[0]) == 0, "unmonitor failed");
+    TEST_CHECK(host_interface_monitor_fd(fds[0], test_fd_ready, &second) == 0, "re-monitor failed");
+
+    test_poll_until(&second, 1, TEST_SLACK_MS);
+    host_interface_poll_events(20);
+    host_interface_poll_events(0);
+    TEST_CHECK(first == 0, "old callback ran %d times", first);
+    TEST_CHECK(second == 1, "new callback ran %d times", second);
+
+    TEST_CHECK(host_interface_unmonitor_fd(fds[0]) == 0, "unmonitor failed");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// Poller thread for the in-flight tests
+static struct {
+    pthread_t thread;
+    int timeout_ms;
+    int stop;
+    int returns;                   // Completed waits
+} test_poller;
+
+static void *test_poller_main(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&test_poller.stop, __ATOMIC_ACQUIRE)) {
+        host_interface_poll_events(test_poller.timeout_ms);
+        __atomic_add_fetch(&test_poller.returns, 1, __ATOMIC_ACQ_REL);
+    }
+    return NULL;
+}
+
+static void test_poller_start(int timeout_ms) {
+    test_poller.timeout_ms = timeout_ms;
+    test_poller.stop = 0;
+    test_poller.returns = 0;
+    pthread_create(&test_poller.thread, NULL, test_poller_main, NULL);
+    // Let it block in the backend
+    usleep(20000);
+}
+
+static void test_poller_stop(void) {
+    __atomic_store_n(&test_poller.stop, 1, __ATOMIC_RELEASE);
+    host_interface_wakeup();
+    pthread_join(test_poller.thread, NULL);
+}
+
+// Wait up to limit_ms for *value to reach want
+static bool test_wait(const int *value, int want, uint64_t limit_ms) {
+    uint64_t start = test_now_ms();
+    while (__atomic_load_n(value, __ATOMIC_ACQUIRE) < want) {
+        if (test_now_ms() - start >= limit_ms) {
+            return false;
+        }
+        usleep(1000);
+    }
+    return true;
+}
+
+// host_interface_wakeup ends a wait that has no timeout; a timer added
+// during a long wait shortens it
+static void test_wakeup(void) {
+    test_poller_start(-1);
+    int before = __atomic_load_n(&test_poller.returns, __ATOMIC_ACQUIRE);
+    host_interface_wakeup();
+    bool woke = test_wait(&test_poller.returns, before + 1, TEST_SLACK_MS);
+    test_poller_stop();
+    TEST_CHECK(woke, "wakeup did not end the wait");
+
+    test_timer_fired = 0;
+    test_poller_start(5000);
+    uint64_t start = test_now_ms();
+    int id = host_interface_create_timer(10, false, test_timer, NULL);
+    bool fired = test_wait(&test_timer_fired, 1, 10 + TEST_SLACK_MS);
+    test_poller_stop();
+    TEST_CHECK(id > 0, "timer not created");
+    TEST_CHECK(fired, "timer added during a 5 s wait did not fire on time");
+    TEST_CHECK(test_timer_at - start >= 10, "10 ms timer fired after %llu ms",
+               (unsigned long long)(test_timer_at - start));
+}
+
+// Monitoring changes while another thread is blocked in the backend: a
+// new fd is picked up, an unmonitored fd goes quiet (on io_uring its
+// cancelled poll is ignored) and a re-monitored fd reports only to its
+// new callback
+static void test_monitor_in_flight(void) {
+    int fds[2];
+    int first = 0, second = 0;
+    TEST_CHECK(test_pipe(fds) == 0, "pipe failed");
+
+    test_poller_start(-1);
+    int monitored = host_interface_monitor_fd(fds[0], test_fd_ready, &first);
+    (void)!write(fds[1], "x", 1);
+    bool reported = test_wait(&first, 1, TEST_SLACK_MS);
+
+    int unmonitored = host_interface_unmonitor_fd(fds[0]);
+    (void)!write(fds[1], "x", 1);
+    host_interface_wakeup();
+    usleep(50000);
+    int quiet = __atomic_load_n(&first, __ATOMIC_ACQUIRE);
+
+    // Drain what was written while unmonitored so only new data counts
+    char buf[64];
+    while (read(fds[0], buf, sizeof(buf)) > 0) {
+    }
+    int remonitored = host_interface_monitor_fd(fds[0], test_fd_ready, &second);
+    (void)!write(fds[1], "x", 1);
+    bool rereported = test_wait(&second, 1, TEST_SLACK_MS);
+    usleep(20000);
+
+    int unmonitored_again = host_interface_unmonitor_fd(fds[0]);
+    test_poller_stop();
+    close(fds[0]);
+    close(fds[1]);
+
+    TEST_CHECK(monitored == 0 && unmonitored == 0 && remonitored == 0 && unmonitored_again == 0,
+               "monitor %d, unmonitor %d, monitor %d, unmonitor %d", monitored, unmonitored, remonitored,
+               unmonitored_again);
+    TEST_CHECK(reported, "fd monitored during a wait never reported");
+    TEST_CHECK(quiet == 1, "unmonitored fd reported (%d calls)", quiet);
+    TEST_CHECK(rereported, "re-monitored fd never reported");
+    TEST_CHECK(__atomic_load_n(&first, __ATOMIC_ACQUIRE) == 1, "old callback ran after re-monitor");
+    TEST_CHECK(__atomic_load_n(&second, __ATOMIC_ACQUIRE) == 1, "new callback ran %d times", second);
+}
+
+static void test_run(const char *name, void (*test)(void)) {
+    printf("%s\n", name);
+    test();
+}
+
+int main(void) {
+    int ran = 0;
+    for (size_t i = 0; i < sizeof(test_backends) / sizeof(test_backends[0]); i++) {
+        test_backend = test_backends[i];
+        printf("[%s]\n", test_backend);
+        if (host_interface_set_backend(test_backend) != 0) {
+            printf("  skipped: not built in\n");
+            continue;
+        }
+        if (host_interface_init() != 0) {
+            // io_uring can be built in yet refused by the host (seccomp, sysctl)
+            printf("  skipped: not available on this host\n");
+            continue;
+        }
+        ran++;
+
+        test_run("backend selection", test_selection);
+        test_run("fd readiness", test_fd_readiness);
+        test_run("stale readiness", test_stale_readiness);
+        test_run("timers", test_timers);
+        test_run("wakeup", test_wakeup);
+        test_run("monitor in flight", test_monitor_in_flight);
+
+        host_interface_cleanup();
+    }
+
+    if (ran == 0) {
+        printf("No backend available\n");
+        return 1;
+    }
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All host interface tests passed (%d backend%s)\n", ran, ran == 1 ? "" : "s");
+    return 0;
+}
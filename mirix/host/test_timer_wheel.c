@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "timer_wheel.h"
+
+// Timer wheel regression tests
+// Each test runs against a fresh wheel on the real monotonic clock, so
+// fire times are checked against their delay with some scheduling slack.
+
+// How late a timer may fire before the test counts it as wrong
+#define TEST_SLACK_MS 50
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+static uint64_t test_start_ms;
+
+static uint64_t test_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static uint64_t test_elapsed_ms(void) {
+    return test_now_ms() - test_start_ms;
+}
+
+static void test_begin(const char *name) {
+    printf("%s\n", name);
+    timer_wheel_init(NULL);
+    test_start_ms = test_now_ms();
+}
+
+static void test_end(void) {
+    timer_wheel_cleanup();
+}
+
+// Poll the wheel the way the host event loop does until *count reaches
+// want (count NULL = never) or limit_ms passes
+static void test_run_until(const int *count, int want, uint64_t limit_ms) {
+    while ((!count || *count < want) && test_elapsed_ms() < limit_ms) {
+        int timeout = timer_wheel_next_timeout();
+        if (timeout < 0 || (uint64_t)timeout > limit_ms) {
+            timeout = (int)limit_ms;
+        }
+        poll(NULL, 0, timeout);
+        timer_wheel_expire();
+    }
+}
+
+#define TEST_CASCADE_TIMERS 5
+
+static const uint64_t test_cascade_delays[TEST_CASCADE_TIMERS] = {
+    3,      // Level 0
+    63,     // Last level 0 slot
+    70,     // Level 1, cascades once
+    200,    // Level 1, a few slots further on
+    4100    // Level 2, cascades through level 1 into level 0
+};
+static uint64_t test_cascade_fired[TEST_CASCADE_TIMERS];
+static int test_cascade_order[TEST_CASCADE_TIMERS];
+static int test_cascade_count;
+
+static void test_cascade_timer(void *data) {
+    int i = (int)(intptr_t)data;
+    test_cascade_fired[i] = test_elapsed_ms();
+    test_cascade_order[test_cascade_count++] = i;
+}
+
+// Timers parked in upper levels come down level by level and fire on
+// time, in deadline order, never early
+static void test_cascade(void) {
+    // Added out of order so bucket order cannot pass for deadline order
+    for (int i = TEST_CASCADE_TIMERS - 1; i >= 0; i--) {
+        TEST_CHECK(timer_wheel_add(test_cascade_delays[i], 0, test_cascade_timer, (void *)(intptr_t)i) > 0,
+                   "timer %d not added", i);
+    }
+
+    test_run_until(&test_cascade_count, TEST_CASCADE_TIMERS, test_cascade_delays[TEST_CASCADE_TIMERS - 1] + 1000);
+
+    TEST_CHECK(test_cascade_count == TEST_CASCADE_TIMERS, "%d of %d timers fired", test_cascade_count,
+               TEST_CASCADE_TIMERS);
+    for (int i = 0; i < TEST_CASCADE_TIMERS; i++) {
+        TEST_CHECK(test_cascade_order[i] == i, "timer %d fired in place %d", test_cascade_order[i], i);
+        TEST_CHECK(test_cascade_fired[i] >= test_cascade_delays[i], "%llu ms timer fired at %llu ms",
+                   (unsigned long long)test_cascade_delays[i], (unsigned long long)test_cascade_fired[i]);
+        TEST_CHECK(test_cascade_fired[i] <= test_cascade_delays[i] + TEST_SLACK_MS,
+                   "%llu ms timer fired at %llu ms", (unsigned long long)test_cascade_delays[i],
+                   (unsigned long long)test_cascade_fired[i]);
+    }
+    TEST_CHECK(timer_wheel_next_timeout() == -1, "wheel not empty after every timer fired");
+}
+
+static int test_periodic_count;
+static uint64_t test_periodic_last;
+
+static void test_periodic_timer(void *data) {
+    (void)data;
+    test_periodic_count++;
+    test_periodic_last = test_elapsed_ms();
+}
+
+// A periodic timer that missed many periods fires once, then keeps its
+// phase from where the clock is now rather than replaying the backlog
+static void test_periodic_skip(void) {
+    int id = timer_wheel_add(10, 10, test_periodic_timer, NULL);
+    TEST_CHECK(id > 0, "timer not added");
+
+    // Stall for about ten periods without expiring anything
+    usleep(105 * 1000);
+    timer_wheel_expire();
+    TEST_CHECK(test_periodic_count == 1, "fired %d times after the stall", test_periodic_count);
+
+    int timeout = timer_wheel_next_timeout();
+    TEST_CHECK(timeout >= 0 && timeout <= 10, "next period in %d ms", timeout);
+
+    uint64_t stalled = test_periodic_last;
+    test_run_until(&test_periodic_count, 3, 1000);
+    TEST_CHECK(test_periodic_count == 3, "fired %d times", test_periodic_count);
+    TEST_CHECK(test_periodic_last - stalled >= 10 && test_periodic_last - stalled <= 20 + TEST_SLACK_MS,
+               "two more periods took %llu ms", (unsigned long long)(test_periodic_last - stalled));
+    TEST_CHECK(timer_wheel_cancel(id) == 0, "periodic timer not cancelled");
+}
+
+static int test_cancel_self_id;
+static int test_cancel_other_id;
+static int test_cancel_self_count;
+static int test_cancel_other_count;
+static int test_cancel_results[2];
+
+static void test_cancel_self_timer(void *data) {
+    (void)data;
+    if (++test_cancel_self_count == 3) {
+        test_cancel_results[0] = timer_wheel_cancel(test_cancel_other_id);
+        test_cancel_results[1] = timer_wheel_cancel(test_cancel_self_id);
+    }
+}
+
+static void test_cancel_other_timer(void *data) {
+    (void)data;
+    test_cancel_other_count++;
+}
+
+// A periodic callback cancels another pending timer and then itself:
+// neither fires again and both ids go stale
+static void test_cancel_in_callback(void) {
+    test_cancel_self_id = timer_wheel_add(5, 5, test_cancel_self_timer, NULL);
+    test_cancel_other_id = timer_wheel_add(100, 0, test_cancel_other_timer, NULL);
+    TEST_CHECK(test_cancel_self_id > 0 && test_cancel_other_id > 0, "timers not added");
+
+    test_run_until(NULL, 0, 200);
+
+    TEST_CHECK(test_cancel_self_count == 3, "periodic timer fired %d times", test_cancel_self_count);
+    TEST_CHECK(test_cancel_other_count == 0, "cancelled timer fired");
+    TEST_CHECK(test_cancel_results[0] == 0 && test_cancel_results[1] == 0,
+               "cancel from the callback returned %d, %d", test_cancel_results[0], test_cancel_results[1]);
+    TEST_CHECK(timer_wheel_cancel(test_cancel_self_id) == -1, "stale periodic id still cancellable");
+    TEST_CHECK(timer_wheel_cancel(test_cancel_other_id) == -1, "stale one-shot id still cancellable");
+    TEST_CHECK(timer_wheel_next_timeout() == -1, "wheel not empty after the cancels");
+
+    // The freed slots are handed out again under new ids
+    int id = timer_wheel_add(1000, 0, test_cancel_other_timer, NULL);
+    TEST_CHECK(id > 0 && id != test_cancel_self_id && id != test_cancel_other_id, "reused id %d", id);
+    TEST_CHECK(timer_wheel_cancel(id) == 0, "new timer not cancelled");
+}
+
+int main(void) {
+    test_begin("cascade");
+    test_cascade();
+    test_end();
+
+    test_begin("periodic skip-ahead");
+    test_periodic_skip();
+    test_end();
+
+    test_begin("cancel in callback");
+    test_cancel_in_callback();
+    test_end();
+
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All timer wheel tests passed\n");
+    return 0;
+}
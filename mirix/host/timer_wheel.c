@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "timer_wheel.h"
+
+// End-of-list marker for timer indices
+#define WHEEL_NIL UINT32_MAX
+
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOT_MASK (MIRIX_TIMER_WHEEL_SLOTS - 1)
+
+// Ticks the whole wheel spans; later deadlines are parked at its far end
+#define WHEEL_RANGE (1ULL << (WHEEL_SLOT_BITS * MIRIX_TIMER_WHEEL_LEVELS))
+
+// Timer id = generation << 20 | (index + 1), so stale ids are rejected
+#define WHEEL_INDEX_BITS 20
+#define WHEEL_GENERATION_MASK 0x3ff
+
+#define WHEEL_INITIAL_TIMERS 256
+
+typedef enum {
+    WHEEL_TIMER_FREE = 0,
+    WHEEL_TIMER_PENDING,           // Linked into a bucket
+    WHEEL_TIMER_FIRING,            // Callback running
+    WHEEL_TIMER_CANCELLED          // Cancelled while its callback ran
+} wheel_timer_state_t;
+
+// Timer table entry; bucket links are table indices
+typedef struct {
+    uint32_t next;
+    uint32_t prev;
+    uint64_t expires;              // Absolute tick
+    uint64_t interval;             // Ticks between repeats, 0 = one-shot
+    timer_wheel_fn callback;
+    void *data;
+    uint16_t bucket;               // level * SLOTS + slot while pending
+    uint16_t generation;
+    uint8_t state;
+} wheel_timer_t;
+
+// Timer wheel state
+static struct {
+    pthread_mutex_t lock;
+    wheel_timer_t *timers;
+    uint32_t capacity;
+    uint32_t free_head;
+    uint32_t buckets[MIRIX_TIMER_WHEEL_LEVELS * MIRIX_TIMER_WHEEL_SLOTS];
+    uint64_t occupied[MIRIX_TIMER_WHEEL_LEVELS];  // Bit n set = slot n non-empty
+    uint64_t now;                  // Last tick processed
+    uint64_t armed;                // Tick the poller sleeps until
+    struct timespec base;          // Tick 0
+    void (*wakeup)(void);
+    bool initialized;
+} wheel_state = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Milliseconds (ticks) and nanoseconds since the wheel was created
+static uint64_t wheel_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - wheel_state.base.tv_sec) * 1000000000ULL +
+           (uint64_t)(ts.tv_nsec - wheel_state.base.tv_nsec);
+}
+
+static uint64_t wheel_clock_tick(void) {
+    return wheel_clock_ns() / 1000000ULL;
+}
+
+static int wheel_timer_id(uint32_t index) {
+    return (int)(((uint32_t)wheel_state.timers[index].generation << WHEEL_INDEX_BITS) | (index + 1));
+}
+
+// Resolve a timer id to a live table index, or WHEEL_NIL
+static uint32_t wheel_timer_index(int timer_id) {
+    if (timer_id <= 0) {
+        return WHEEL_NIL;
+    }
+
+    uint32_t index = ((uint32_t)timer_id & ((1u << WHEEL_INDEX_BITS) - 1)) - 1;
+    if (index >= wheel_state.capacity) {
+        return WHEEL_NIL;
+    }
+
+    wheel_timer_t *timer = &wheel_state.timers[index];
+    if (timer->state == WHEEL_TIMER_FREE ||
+        timer->generation != ((uint32_t)timer_id >> WHEEL_INDEX_BITS)) {
+        return WHEEL_NIL;
+    }
+    return index;
+}
+
+// Double the timer table (caller holds lock)
+static int wheel_grow(void) {
+    uint32_t capacity = wheel_state.capacity ? wheel_state.capacity * 2 : WHEEL_INITIAL_TIMERS;
+    if (capacity > MIRIX_TIMER_MAX) {
+        capacity = MIRIX_TIMER_MAX;
+    }
+    if (capacity <= wheel_state.capacity) {
+        return -1;
+    }
+
+    wheel_timer_t *timers = realloc(wheel_state.timers, capacity * sizeof(wheel_timer_t));
+    if (!timers) {
+        return -1;
+    }
+    memset(&timers[wheel_state.capacity], 0, (capacity - wheel_state.capacity) * sizeof(wheel_timer_t));
+
+    // Thread the new entries onto the free list
+    for (uint32_t i = capacity; i > wheel_state.capacity; i--) {
+        timers[i - 1].next = wheel_state.free_head;
+        wheel_state.free_head = i - 1;
+    }
+    wheel_state.timers = timers;
+    wheel_state.capacity = capacity;
+    return 0;
+}
+
+static void wheel_timer_free(uint32_t index) {
+    wheel_timer_t *timer = &wheel_state.timers[index];
+    timer->state = WHEEL_TIMER_FREE;
+    timer->generation = (timer->generation + 1) & WHEEL_GENERATION_MASK;
+    timer->callback = NULL;
+    timer->data = NULL;
+    timer->next = wheel_state.free_head;
+    wheel_state.free_head = index;
+}
+
+// Put a timer in the bucket for its deadline relative to now: the lowest
+// level whose span still reaches it (caller holds lock)
+static void wheel_link(uint32_t index) {
+    wheel_timer_t *timer = &wheel_state.timers[index];
+    uint64_t expires = timer->expires;
+    uint64_t delta = expires - wheel_state.now;
+
+    if (delta >= WHEEL_RANGE) {
+        expires = wheel_state.now + WHEEL_RANGE - 1;
+        delta = WHEEL_RANGE - 1;
+    }
+
+    int level = 0;
+    while (level < MIRIX_TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((expires >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK);
+    uint16_t bucket = (uint16_t)(level * MIRIX_TIMER_WHEEL_SLOTS + slot);
+
+    timer->bucket = bucket;
+    timer->prev = WHEEL_NIL;
+    timer->next = wheel_state.buckets[bucket];
+    if (timer->next != WHEEL_NIL) {
+        wheel_state.timers[timer->next].prev = index;
+    }
+    wheel_state.buckets[bucket] = index;
+    wheel_state.occupied[level] |= 1ULL << slot;
+    timer->state = WHEEL_TIMER_PENDING;
+}
+
+// Take a timer out of its bucket (caller holds lock)
+static void wheel_unlink(uint32_t index) {
+    wheel_timer_t *timer = &wheel_state.timers[index];
+    uint16_t bucket = timer->bucket;
+
+    if (timer->prev == WHEEL_NIL) {
+        wheel_state.buckets[bucket] = timer->next;
+    } else {
+        wheel_state.timers[timer->prev].next = timer->next;
+    }
+    if (timer->next != WHEEL_NIL) {
+        wheel_state.timers[timer->next].prev = timer->prev;
+    }
+    if (wheel_state.buckets[bucket] == WHEEL_NIL) {
+        wheel_state.occupied[bucket / MIRIX_TIMER_WHEEL_SLOTS] &= ~(1ULL << (bucket % MIRIX_TIMER_WHEEL_SLOTS));
+    }
+}
+
+// Next tick that has a bucket to run or cascade, or UINT64_MAX
+static uint64_t wheel_next_event(void) {
+    uint64_t next = UINT64_MAX;
+
+    for (int level = 0; level < MIRIX_TIMER_WHEEL_LEVELS; level++) {
+        uint64_t occupied = wheel_state.occupied[level];
+        if (occupied == 0) {
+            continue;
+        }
+
+        // Slots ahead of the current position, nearest first
+        int shift = WHEEL_SLOT_BITS * level;
+        unsigned rotate = (unsigned)(((wheel_state.now >> shift) + 1) & WHEEL_SLOT_MASK);
+        uint64_t ahead = (occupied >> rotate) | (occupied << ((64 - rotate) & 63));
+        uint64_t distance = (uint64_t)__builtin_ctzll(ahead) + 1;
+
+        uint64_t tick = ((wheel_state.now >> shift) + distance) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+// Initialize timer wheel
+int timer_wheel_init(void (*wakeup)(void)) {
+    pthread_mutex_lock(&wheel_state.lock);
+    if (wheel_state.initialized) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wheel_state.base);
+    wheel_state.now = 0;
+    wheel_state.armed = UINT64_MAX;
+    wheel_state.free_head = WHEEL_NIL;
+    for (size_t i = 0; i < sizeof(wheel_state.buckets) / sizeof(wheel_state.buckets[0]); i++) {
+        wheel_state.buckets[i] = WHEEL_NIL;
+    }
+    memset(wheel_state.occupied, 0, sizeof(wheel_state.occupied));
+    wheel_state.wakeup = wakeup;
+
+    if (wheel_grow() != 0) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return -1;
+    }
+
+    wheel_state.initialized = true;
+    pthread_mutex_unlock(&wheel_state.lock);
+    return 0;
+}
+
+// Cleanup timer wheel; pending timers are dropped without firing
+void timer_wheel_cleanup(void) {
+    pthread_mutex_lock(&wheel_state.lock);
+    free(wheel_state.timers);
+    wheel_state.timers = NULL;
+    wheel_state.capacity = 0;
+    wheel_state.free_head = WHEEL_NIL;
+    wheel_state.initialized = false;
+    pthread_mutex_unlock(&wheel_state.lock);
+}
+
+// Arm a timer
+int timer_wheel_add(uint64_t delay_ms, uint64_t interval_ms, timer_wheel_fn callback, void *data) {
+    pthread_mutex_lock(&wheel_state.lock);
+
+    if (!wheel_state.initialized ||
+        (wheel_state.free_head == WHEEL_NIL && wheel_grow() != 0)) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return -1;
+    }
+
+    uint32_t index = wheel_state.free_head;
+    wheel_timer_t *timer = &wheel_state.timers[index];
+    wheel_state.free_head = timer->next;
+
+    // Round up so a timer never fires early; always at least one tick out
+    uint64_t expires = (wheel_clock_ns() + delay_ms * 1000000ULL + 999999ULL) / 1000000ULL;
+    if (expires <= wheel_state.now) {
+        expires = wheel_state.now + 1;
+    }
+    timer->expires = expires;
+    timer->interval = interval_ms;
+    timer->callback = callback;
+    timer->data = data;
+    wheel_link(index);
+
+    // New nearest deadline: the poller must wake earlier than it planned
+    bool wake = expires < wheel_state.armed;
+    if (wake) {
+        wheel_state.armed = expires;
+    }
+    void (*wakeup)(void) = wheel_state.wakeup;
+    int timer_id = wheel_timer_id(index);
+
+    pthread_mutex_unlock(&wheel_state.lock);
+
+    if (wake && wakeup) {
+        wakeup();
+    }
+    return timer_id;
+}
+
+// Cancel a timer
+int timer_wheel_cancel(int timer_id) {
+    pthread_mutex_lock(&wheel_state.lock);
+
+    uint32_t index = wheel_timer_index(timer_id);
+    if (index == WHEEL_NIL || wheel_state.timers[index].state == WHEEL_TIMER_CANCELLED) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return -1;
+    }
+
+    if (wheel_state.timers[index].state == WHEEL_TIMER_FIRING) {
+        // timer_wheel_expire frees it once the callback returns
+        wheel_state.timers[index].state = WHEEL_TIMER_CANCELLED;
+    } else {
+        wheel_unlink(index);
+        wheel_timer_free(index);
+    }
+
+    pthread_mutex_unlock(&wheel_state.lock);
+    return 0;
+}
+
+// Time until the next bucket is due; also records it as the armed deadline
+int timer_wheel_next_timeout(void) {
+    pthread_mutex_lock(&wheel_state.lock);
+
+    if (!wheel_state.initialized) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return -1;
+    }
+
+    uint64_t next = wheel_next_event();
+    wheel_state.armed = next;
+    pthread_mutex_unlock(&wheel_state.lock);
+
+    if (next == UINT64_MAX) {
+        return -1;
+    }
+
+    uint64_t now_ns = wheel_clock_ns();
+    uint64_t due_ns = next * 1000000ULL;
+    if (due_ns <= now_ns) {
+        return 0;
+    }
+    uint64_t timeout_ms = (due_ns - now_ns + 999999ULL) / 1000000ULL;
+    return timeout_ms > INT_MAX ? INT_MAX : (int)timeout_ms;
+}
+
+// Advance the wheel to the current tick, cascading higher levels down and
+// firing level 0 buckets as their ticks pass
+int timer_wheel_expire(void) {
+    int fired = 0;
+
+    pthread_mutex_lock(&wheel_state.lock);
+    if (!wheel_state.initialized) {
+        pthread_mutex_unlock(&wheel_state.lock);
+        return 0;
+    }
+
+    uint64_t target = wheel_clock_tick();
+    while (true) {
+        // Jump straight to the next tick with work; empty ticks cost nothing
+        uint64_t tick = wheel_next_event();
+        if (tick > target) {
+            if (target > wheel_state.now) {
+                wheel_state.now = target;
+            }
+            break;
+        }
+        wheel_state.now = tick;
+
+        // Cascade: every timer in a due upper bucket now fits a lower level
+        for (int level = MIRIX_TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            int shift = WHEEL_SLOT_BITS * level;
+            if ((tick & ((1ULL << shift) - 1)) != 0) {
+                continue;
+            }
+
+            uint16_t bucket = (uint16_t)(level * MIRIX_TIMER_WHEEL_SLOTS + ((tick >> shift) & WHEEL_SLOT_MASK));
+            uint32_t index = wheel_state.buckets[bucket];
+            wheel_state.buckets[bucket] = WHEEL_NIL;
+            wheel_state.occupied[level] &= ~(1ULL << (bucket % MIRIX_TIMER_WHEEL_SLOTS));
+            while (index != WHEEL_NIL) {
+                uint32_t next = wheel_state.timers[index].next;
+                wheel_link(index);
+                index = next;
+            }
+        }
+
+        // Fire the level 0 bucket for this tick
+        uint16_t bucket = (uint16_t)(tick & WHEEL_SLOT_MASK);
+        uint32_t index;
+        while ((index = wheel_state.buckets[bucket]) != WHEEL_NIL) {
+            wheel_unlink(index);
+
+            wheel_timer_t *timer = &wheel_state.timers[index];
+            timer->state = WHEEL_TIMER_FIRING;
+            timer_wheel_fn callback = timer->callback;
+            void *data = timer->data;
+
+            // Callbacks may add or cancel timers (the table may move)
+            if (callback) {
+                pthread_mutex_unlock(&wheel_state.lock);
+                callback(data);
+                pthread_mutex_lock(&wheel_state.lock);
+            }
+            fired++;
+
+            timer = &wheel_state.timers[index];
+            if (timer->state == WHEEL_TIMER_CANCELLED || timer->interval == 0) {
+                wheel_timer_free(index);
+                continue;
+            }
+
+            // Periodic: next multiple of the interval after the clock
+            // (missed periods are skipped, not replayed; wheel_state.now
+            // is only the tick being processed and may lag far behind)
+            timer->expires += timer->interval;
+            if (timer->expires <= target) {
+                uint64_t behind = target - timer->expires;
+                timer->expires += (behind / timer->interval + 1) * timer->interval;
+            }
+            wheel_link(index);
+        }
+    }
+
+    pthread_mutex_unlock(&wheel_state.lock);
+    return fired;
+}
@@ -0,0 +1,38 @@
+#ifndef MIRIX_TIMER_WHEEL_H
+#define MIRIX_TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hierarchical timing wheel: 1 ms ticks, five levels of 64 slots
+// (level n slots are 64^n ticks wide), covering about 12 days before
+// far timers are parked in the top level and re-cascaded.
+#define MIRIX_TIMER_WHEEL_LEVELS 5
+#define MIRIX_TIMER_WHEEL_SLOTS 64
+
+// Timer ids are positive; the low bits index the timer table
+#define MIRIX_TIMER_MAX 1048575
+
+typedef void (*timer_wheel_fn)(void *data);
+
+// Timer wheel API. wakeup is called (without locks held) whenever a new
+// timer becomes the nearest deadline, so a poller sleeping on
+// timer_wheel_next_timeout() can re-arm.
+int timer_wheel_init(void (*wakeup)(void));
+void timer_wheel_cleanup(void);
+
+// Arm a timer delay_ms from now; interval_ms > 0 repeats it. Returns the
+// timer id or -1. O(1).
+int timer_wheel_add(uint64_t delay_ms, uint64_t interval_ms, timer_wheel_fn callback, void *data);
+
+// Cancel a pending timer, including from its own callback. O(1).
+int timer_wheel_cancel(int timer_id);
+
+// Milliseconds until the wheel next needs timer_wheel_expire (-1 = no timers)
+int timer_wheel_next_timeout(void);
+
+// Run the callbacks of every expired timer; returns how many fired.
+// Called from the one thread that polls host events.
+int timer_wheel_expire(void);
+
+#endif // MIRIX_TIMER_WHEEL_H
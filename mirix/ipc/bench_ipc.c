@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "ipc.h"
+
+// IPC benchmark
+// Ping-pong latency percentiles and fan-out/fan-in throughput over the
+// shared IPC region. Results are printed one JSON object per line.
+// Uses the same region and semaphore names as the kernel, so do not run
+// it while a kernel is up.
+
+// Mailbox ids used by the benchmark (any uint32 works as a mailbox key)
+#define BENCH_ID_BASE 0x7f000000u
+#define BENCH_ID_MAIN BENCH_ID_BASE
+#define BENCH_ID_PEER(i) (BENCH_ID_BASE + 1 + (uint32_t)(i))
+
+#define BENCH_MAX_PEERS 16
+#define BENCH_BATCH 32
+
+typedef enum {
+    BENCH_SPAWN_THREAD = 0,
+    BENCH_SPAWN_PROCESS = 1
+} bench_spawn_t;
+
+#define BENCH_DEFAULT_ITERATIONS 20000
+#define BENCH_DEFAULT_MESSAGES 200000
+
+// Benchmark configuration
+static struct {
+    int pingpong_iterations;
+    int throughput_messages;     // Total per throughput run
+} bench_config = { BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_MESSAGES };
+
+static const size_t bench_payloads[] = { 16, 256, 4096 };
+static const int bench_peer_counts[] = { 1, 2, 4 };
+
+#define BENCH_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int bench_compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile of a sorted sample set
+static uint64_t bench_percentile(const uint64_t *sorted, size_t count, double pct) {
+    size_t index = (size_t)(pct / 100.0 * (double)(count - 1) + 0.5);
+    return sorted[index < count ? index : count - 1];
+}
+
+// Send one message without logging, retrying while the queue is full
+static void bench_send(uint32_t from, uint32_t to, const void *data, size_t size) {
+    mirix_ipc_send_entry_t entry = { .receiver_pid = to, .flags = 0, .data = data, .data_size = size };
+    while (ipc_send_batch(from, &entry, 1) != 1) {
+        sched_yield();
+    }
+}
+
+// Receive one message without logging
+static int bench_recv(uint32_t id, void *buf, size_t size) {
+    mirix_ipc_recv_entry_t entry = { .buf = buf, .buf_size = size };
+    return ipc_receive_batch(id, &entry, 1, -1) == 1 ? 0 : -1;
+}
+
+// Peer bodies, usable from a thread or a forked child
+typedef struct {
+    int index;
+    int mode;           // Which bench_peer_* body to run
+    size_t payload;
+    long messages;
+} bench_peer_t;
+
+enum { BENCH_PEER_ECHO, BENCH_PEER_SERVER, BENCH_PEER_SINK, BENCH_PEER_SOURCE };
+
+static void *bench_peer_main(void *arg) {
+    bench_peer_t *peer = (bench_peer_t*)arg;
+    uint32_t self = BENCH_ID_PEER(peer->index);
+    uint8_t buf[MIRIX_IPC_MAX_DATA_SIZE];
+    memset(buf, 0x5a, sizeof(buf));
+
+    switch (peer->mode) {
+        case BENCH_PEER_ECHO:
+            for (long i = 0; i < peer->messages; i++) {
+                if (bench_recv(self, buf, sizeof(buf)) == 0) {
+                    bench_send(self, BENCH_ID_MAIN, buf, peer->payload);
+                }
+            }
+            break;
+
+        case BENCH_PEER_SERVER: {
+            mirix_message_info_t info;
+            const mirix_message_info_t *reply_to = NULL;
+            for (long i = 0; i <= peer->messages; i++) {
+                // The last round only delivers the final reply
+                int timeout = (i == peer->messages) ? 0 : -1;
+                if (ipc_reply_and_receive(self, reply_to, buf, peer->payload,
+                                          &info, buf, sizeof(buf), timeout) != 0) {
+                    break;
+                }
+                reply_to = &info;
+            }
+            break;
+        }
+
+        case BENCH_PEER_SINK: {
+            mirix_ipc_recv_entry_t entries[BENCH_BATCH];
+            for (int i = 0; i < BENCH_BATCH; i++) {
+                entries[i].buf = buf;
+                entries[i].buf_size = sizeof(buf);
+            }
+            long received = 0;
+            while (received < peer->messages) {
+                int n = ipc_receive_batch(self, entries, BENCH_BATCH, -1);
+                if (n > 0) {
+                    received += n;
+                }
+            }
+            break;
+        }
+
+        case BENCH_PEER_SOURCE: {
+            mirix_ipc_send_entry_t entries[BENCH_BATCH];
+            for (int i = 0; i < BENCH_BATCH; i++) {
+                entries[i] = (mirix_ipc_send_entry_t){ BENCH_ID_MAIN, 0, buf, peer->payload };
+            }
+            long sent = 0;
+            while (sent < peer->messages) {
+                long want = peer->messages - sent;
+                int n = ipc_send_batch(self, entries, want < BENCH_BATCH ? (size_t)want : BENCH_BATCH);
+                if (n > 0) {
+                    sent += n;
+                } else {
+                    sched_yield();
+                }
+            }
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Peer handles for one run
+typedef struct {
+    bench_spawn_t spawn;
+    int count;
+    bench_peer_t peers[BENCH_MAX_PEERS];
+    pthread_t threads[BENCH_MAX_PEERS];
+    pid_t pids[BENCH_MAX_PEERS];
+} bench_group_t;
+
+static int bench_group_start(bench_group_t *group) {
+    for (int i = 0; i < group->count; i++) {
+        if (group->spawn == BENCH_SPAWN_THREAD) {
+            if (pthread_create(&group->threads[i], NULL, bench_peer_main, &group->peers[i]) != 0) {
+                return -1;
+            }
+        } else {
+            pid_t pid = fork();
+            if (pid == -1) {
+                return -1;
+            }
+            if (pid == 0) {
+                bench_peer_main(&group->peers[i]);
+                _exit(0);
+            }
+            group->pids[i] = pid;
+        }
+    }
+    return 0;
+}
+
+static void bench_group_join(bench_group_t *group) {
+    for (int i = 0; i < group->count; i++) {
+        if (group->spawn == BENCH_SPAWN_THREAD) {
+            pthread_join(group->threads[i], NULL);
+        } else {
+            waitpid(group->pids[i], NULL, 0);
+        }
+    }
+}
+
+static const char *bench_spawn_name(bench_spawn_t spawn) {
+    return spawn == BENCH_SPAWN_THREAD ? "thread" : "process";
+}
+
+// Round-trip latency against one peer, using plain send/receive or ipc_call
+static void bench_pingpong(bench_spawn_t spawn, size_t payload, bool rpc) {
+    int iterations = bench_config.pingpong_iterations;
+    uint64_t *samples = malloc(sizeof(uint64_t) * (size_t)iterations);
+    if (!samples) {
+        return;
+    }
+
+    bench_group_t group = { .spawn = spawn, .count = 1 };
+    group.peers[0] = (bench_peer_t){ 0, rpc ? BENCH_PEER_SERVER : BENCH_PEER_ECHO, payload, iterations };
+    if (bench_group_start(&group) != 0) {
+        fprintf(stderr, "bench-ipc: failed to start peer\n");
+        free(samples);
+        return;
+    }
+
+    uint8_t buf[MIRIX_IPC_MAX_DATA_SIZE];
+    memset(buf, 0xa5, sizeof(buf));
+
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = bench_now_ns();
+        if (rpc) {
+            ipc_call(BENCH_ID_MAIN, BENCH_ID_PEER(0), buf, payload, NULL, buf, sizeof(buf), -1);
+        } else {
+            bench_send(BENCH_ID_MAIN, BENCH_ID_PEER(0), buf, payload);
+            bench_recv(BENCH_ID_MAIN, buf, sizeof(buf));
+        }
+        samples[i] = bench_now_ns() - start;
+    }
+
+    bench_group_join(&group);
+
+    qsort(samples, (size_t)iterations, sizeof(uint64_t), bench_compare_u64);
+    printf("{\"test\":\"%s\",\"spawn\":\"%s\",\"payload\":%zu,\"iterations\":%d,"
+           "\"min_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+           rpc ? "call" : "pingpong", bench_spawn_name(spawn), payload, iterations,
+           (unsigned long long)samples[0],
+           (unsigned long long)bench_percentile(samples, (size_t)iterations, 50.0),
+           (unsigned long long)bench_percentile(samples, (size_t)iterations, 99.0),
+           (unsigned long long)bench_percentile(samples, (size_t)iterations, 99.9),
+           (unsigned long long)samples[iterations - 1]);
+    fflush(stdout);
+    free(samples);
+}
+
+// One sender fanning out to peers, or peers fanning in to one receiver
+static void bench_throughput(bench_spawn_t spawn, size_t payload, int peers, bool fan_in) {
+    long per_peer = bench_config.throughput_messages / peers;
+    long total = per_peer * peers;
+
+    bench_group_t group = { .spawn = spawn, .count = peers };
+    for (int i = 0; i < peers; i++) {
+        group.peers[i] = (bench_peer_t){ i, fan_in ? BENCH_PEER_SOURCE : BENCH_PEER_SINK, payload, per_peer };
+    }
+
+    uint64_t start = bench_now_ns();
+    if (bench_group_start(&group) != 0) {
+        fprintf(stderr, "bench-ipc: failed to start peers\n");
+        return;
+    }
+
+    uint8_t buf[MIRIX_IPC_MAX_DATA_SIZE];
+    memset(buf, 0xa5, sizeof(buf));
+
+    if (fan_in) {
+        mirix_ipc_recv_entry_t entries[BENCH_BATCH];
+        for (int i = 0; i < BENCH_BATCH; i++) {
+            entries[i].buf = buf;
+            entries[i].buf_size = sizeof(buf);
+        }
+        long received = 0;
+        while (received < total) {
+            int n = ipc_receive_batch(BENCH_ID_MAIN, entries, BENCH_BATCH, -1);
+            if (n > 0) {
+                received += n;
+            }
+        }
+    } else {
+        // Round-robin batches across the sinks
+        mirix_ipc_send_entry_t entries[BENCH_BATCH];
+        long sent[BENCH_MAX_PEERS] = { 0 };
+        long done = 0;
+        while (done < total) {
+            for (int p = 0; p < peers; p++) {
+                long want = per_peer - sent[p];
+                if (want <= 0) {
+                    continue;
+                }
+                size_t batch = want < BENCH_BATCH ? (size_t)want : BENCH_BATCH;
+                for (size_t i = 0; i < batch; i++) {
+                    entries[i] = (mirix_ipc_send_entry_t){ BENCH_ID_PEER(p), 0, buf, payload };
+                }
+                int n = ipc_send_batch(BENCH_ID_MAIN, entries, batch);
+                if (n > 0) {
+                    sent[p] += n;
+                    done += n;
+                } else {
+                    sched_yield();
+                }
+            }
+        }
+    }
+
+    bench_group_join(&group);
+    uint64_t elapsed = bench_now_ns() - start;
+
+    double seconds = (double)elapsed / 1e9;
+    printf("{\"test\":\"%s\",\"spawn\":\"%s\",\"payload\":%zu,\"peers\":%d,\"messages\":%ld,"
+           "\"elapsed_ns\":%llu,\"msgs_per_sec\":%.0f,\"mbytes_per_sec\":%.2f}\n",
+           fan_in ? "many_to_one" : "one_to_many", bench_spawn_name(spawn), payload, peers, total,
+           (unsigned long long)elapsed, (double)total / seconds,
+           (double)total * (double)payload / seconds / (1024.0 * 1024.0));
+    fflush(stdout);
+}
+
+static void bench_usage(FILE *out, const char *prog) {
+    fprintf(out, "MIRIX IPC benchmark\n");
+    fprintf(out, "Usage: %s [OPTIONS]\n\n", prog);
+    fprintf(out, "Options:\n");
+    fprintf(out, "  -n, --iterations COUNT  Round trips per ping-pong/call run (default: %d)\n",
+            BENCH_DEFAULT_ITERATIONS);
+    fprintf(out, "  -m, --messages COUNT    Messages per throughput run (default: %d)\n",
+            BENCH_DEFAULT_MESSAGES);
+    fprintf(out, "  -h, --help              Show this help message\n\n");
+    fprintf(out, "Results are printed one JSON object per line. Do not run alongside a kernel.\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option long_options[] = {
+        {"iterations", required_argument, 0, 'n'},
+        {"messages",   required_argument, 0, 'm'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "n:m:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                bench_config.pingpong_iterations = atoi(optarg);
+                break;
+            case 'm':
+                bench_config.throughput_messages = atoi(optarg);
+                break;
+            case 'h':
+                bench_usage(stdout, argv[0]);
+                return 0;
+            default:
+                bench_usage(stderr, argv[0]);
+                return 1;
+        }
+    }
+
+    if (bench_config.pingpong_iterations <= 0 || bench_config.throughput_messages <= 0) {
+        bench_usage(stderr, argv[0]);
+        return 1;
+    }
+
+    if (ipc_system_init_mode(MIRIX_IPC_MODE_SHARED) != 0) {
+        fprintf(stderr, "bench-ipc: failed to initialize IPC region\n");
+        return 1;
+    }
+
+    for (int spawn = BENCH_SPAWN_THREAD; spawn <= BENCH_SPAWN_PROCESS; spawn++) {
+        for (size_t p = 0; p < BENCH_COUNT(bench_payloads); p++) {
+            bench_pingpong((bench_spawn_t)spawn, bench_payloads[p], false);
+            bench_pingpong((bench_spawn_t)spawn, bench_payloads[p], true);
+        }
+    }
+
+    for (int spawn = BENCH_SPAWN_THREAD; spawn <= BENCH_SPAWN_PROCESS; spawn++) {
+        for (size_t p = 0; p < BENCH_COUNT(bench_payloads); p++) {
+            for (size_t c = 0; c < BENCH_COUNT(bench_peer_counts); c++) {
+                bench_throughput((bench_spawn_t)spawn, bench_payloads[p], bench_peer_counts[c], false);
+                bench_throughput((bench_spawn_t)spawn, bench_payloads[p], bench_peer_counts[c], true);
+            }
+        }
+    }
+
+    ipc_system_cleanup();
+    return 0;
+}
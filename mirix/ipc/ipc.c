@@ -1,50 +1,469 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 #include <semaphore.h>
+#include <sched.h>
 
 #include "ipc.h"
+#include "ipc_futex.h"
 
 // IPC system state
 static struct {
     bool initialized;
+    mirix_ipc_mode_t mode;
+    pid_t owner_pid;               // Process that created the region
     void *shared_memory;
     size_t shared_memory_size;
     int shm_fd;
     sem_t *message_sem;
     mirix_message_queue_t message_queue;
-} ipc_state;
+    ipc_traffic_fn traffic_hook;
+} ipc_state = { .shm_fd = -1, .message_sem = SEM_FAILED };
+
+static uint64_t get_current_timestamp(void);
+
+// Record size classes in units; the largest holds a full-size payload
+static const uint32_t ipc_class_units[MIRIX_IPC_SIZE_CLASSES] = {
+    1, 2, 4, 8, 16, 32,
+    (sizeof(mirix_ipc_record_t) + MIRIX_IPC_MAX_DATA_SIZE + MIRIX_IPC_RECORD_UNIT - 1) / MIRIX_IPC_RECORD_UNIT
+};
+
+// Point the process-local queue view at a mapped region
+static void ipc_bind_region(void *memory, size_t size) {
+    uint8_t *region = (uint8_t*)memory;
+    size_t arena_offset = (sizeof(mirix_ipc_region_t) + MIRIX_IPC_RECORD_UNIT - 1) &
+                          ~(size_t)(MIRIX_IPC_RECORD_UNIT - 1);
+    
+    ipc_state.shared_memory = memory;
+    ipc_state.shared_memory_size = size;
+    ipc_state.message_queue.header = (mirix_ipc_region_t*)region;
+    ipc_state.message_queue.arena = region + arena_offset;
+}
+
+// Lay out a fresh region: header with mailbox index, then an empty record arena
+static void ipc_format_region(void) {
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    size_t arena_size = ipc_state.shared_memory_size -
+                        (size_t)(ipc_state.message_queue.arena - (uint8_t*)ipc_state.shared_memory);
+    
+    memset(header, 0, sizeof(mirix_ipc_region_t));
+    header->capacity = (uint32_t)(arena_size / MIRIX_IPC_RECORD_UNIT);
+    header->count = 0;
+    header->bump = 0;
+    for (int i = 0; i < MIRIX_IPC_SIZE_CLASSES; i++) {
+        header->free_heads[i] = MIRIX_IPC_NIL;
+    }
+    header->magic = MIRIX_IPC_REGION_MAGIC;
+}
+
+// Resolve a record offset
+static inline mirix_ipc_record_t *ipc_record(uint32_t offset) {
+    return (mirix_ipc_record_t*)(ipc_state.message_queue.arena + (size_t)offset * MIRIX_IPC_RECORD_UNIT);
+}
+
+// Free list heads pack an ABA tag above the record offset
+#define IPC_FREE_OFFSET(head) ((uint32_t)(head))
+#define IPC_FREE_HEAD(tag, offset) (((uint64_t)(tag) << 32) | (uint32_t)(offset))
+
+// Lock-free pop from a size-class free list
+static uint32_t ipc_free_pop(int size_class) {
+    uint64_t *list = &ipc_state.message_queue.header->free_heads[size_class];
+    uint64_t head = __atomic_load_n(list, __ATOMIC_ACQUIRE);
+    
+    while (IPC_FREE_OFFSET(head) != MIRIX_IPC_NIL) {
+        uint32_t offset = IPC_FREE_OFFSET(head);
+        // May read a record another thread just took; the tag makes the CAS fail
+        uint32_t next = __atomic_load_n(&ipc_record(offset)->next, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(list, &head, IPC_FREE_HEAD((head >> 32) + 1, next),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return offset;
+        }
+    }
+    
+    return MIRIX_IPC_NIL;
+}
+
+// Lock-free push onto a size-class free list
+static void ipc_free_push(int size_class, uint32_t offset) {
+    uint64_t *list = &ipc_state.message_queue.header->free_heads[size_class];
+    uint64_t head = __atomic_load_n(list, __ATOMIC_RELAXED);
+    
+    do {
+        __atomic_store_n(&ipc_record(offset)->next, IPC_FREE_OFFSET(head), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(list, &head, IPC_FREE_HEAD((head >> 32) + 1, offset),
+                                          false, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Carve fresh units off the arena. Smaller classes leave room for
+// IPC_LARGE_RESERVE full-size records, so a burst of small messages
+// cannot use up the arena before a sweep gets to merge it.
+#define IPC_LARGE_RESERVE 16
+
+static uint32_t ipc_bump_alloc(int size_class) {
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    uint32_t units = ipc_class_units[size_class];
+    uint32_t limit = header->capacity;
+    if (size_class < MIRIX_IPC_SIZE_CLASSES - 1) {
+        uint32_t reserve = IPC_LARGE_RESERVE * ipc_class_units[MIRIX_IPC_SIZE_CLASSES - 1];
+        limit = limit > reserve ? limit - reserve : 0;
+    }
+    
+    uint32_t bump = __atomic_load_n(&header->bump, __ATOMIC_RELAXED);
+    do {
+        if (bump > limit || limit - bump < units) {
+            return MIRIX_IPC_NIL;
+        }
+    } while (!__atomic_compare_exchange_n(&header->bump, &bump, bump + units,
+                                          false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    
+    ipc_record(bump)->size_class = (uint8_t)size_class;
+    return bump;
+}
+
+// Cut a span of units into the largest classes that fit and free them
+static void ipc_free_span(uint32_t offset, uint32_t units) {
+    int size_class = MIRIX_IPC_SIZE_CLASSES - 1;
+    while (units > 0) {
+        while (ipc_class_units[size_class] > units) {
+            size_class--;
+        }
+        ipc_record(offset)->size_class = (uint8_t)size_class;
+        ipc_free_push(size_class, offset);
+        offset += ipc_class_units[size_class];
+        units -= ipc_class_units[size_class];
+    }
+}
+
+// Exact class free list, then fresh arena space, then a larger class's
+// free record with the unused tail split off
+static uint32_t ipc_class_alloc(int size_class) {
+    uint32_t offset = ipc_free_pop(size_class);
+    if (offset == MIRIX_IPC_NIL) {
+        offset = ipc_bump_alloc(size_class);
+    }
+    
+    for (int found = size_class + 1; offset == MIRIX_IPC_NIL && found < MIRIX_IPC_SIZE_CLASSES; found++) {
+        offset = ipc_free_pop(found);
+        if (offset != MIRIX_IPC_NIL) {
+            ipc_record(offset)->size_class = (uint8_t)size_class;
+            ipc_free_span(offset + ipc_class_units[size_class],
+                          ipc_class_units[found] - ipc_class_units[size_class]);
+        }
+    }
+    
+    return offset;
+}
+
+#define IPC_ARENA_MAX_UNITS (MIRIX_IPC_REGION_SIZE / MIRIX_IPC_RECORD_UNIT)
+
+// Merge free space after an allocation came up empty: take every free
+// list, mark the free units, and give each run of them back either to the
+// bump pointer (if it ends there) or to the largest classes that fit. One
+// sweep at a time; records in use are never touched, and frees that race
+// the sweep simply land on the emptied lists. Returns true if an
+// allocation is worth retrying.
+static bool ipc_arena_sweep(void) {
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    
+    uint32_t idle = 0;
+    if (!__atomic_compare_exchange_n(&header->sweeping, &idle, 1, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // Someone else is merging; give them a moment (bounded, in case
+        // the sweeping process died)
+        for (int spins = 0; spins < 1000 && __atomic_load_n(&header->sweeping, __ATOMIC_ACQUIRE); spins++) {
+            sched_yield();
+        }
+        return true;
+    }
+    
+    uint64_t free_map[IPC_ARENA_MAX_UNITS / 64];
+    memset(free_map, 0, sizeof(free_map));
+    uint32_t limit = header->capacity < IPC_ARENA_MAX_UNITS ? header->capacity : IPC_ARENA_MAX_UNITS;
+    bool stolen = false;
+    
+    for (int size_class = 0; size_class < MIRIX_IPC_SIZE_CLASSES; size_class++) {
+        uint64_t *list = &header->free_heads[size_class];
+        uint64_t head = __atomic_load_n(list, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(list, &head, IPC_FREE_HEAD((head >> 32) + 1, MIRIX_IPC_NIL),
+                                            false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        }
+        
+        for (uint32_t offset = IPC_FREE_OFFSET(head); offset != MIRIX_IPC_NIL; ) {
+            uint32_t next = ipc_record(offset)->next;
+            uint32_t end = offset + ipc_class_units[ipc_record(offset)->size_class];
+            for (uint32_t unit = offset; unit < end && unit < limit; unit++) {
+                free_map[unit / 64] |= 1ULL << (unit % 64);
+            }
+            stolen = true;
+            offset = next;
+        }
+    }
+    
+    // Walk the runs of free units below the bump pointer
+    uint32_t bump = __atomic_load_n(&header->bump, __ATOMIC_ACQUIRE);
+    for (uint32_t unit = 0; unit < bump && unit < limit; ) {
+        if (!(free_map[unit / 64] & (1ULL << (unit % 64)))) {
+            unit++;
+            continue;
+        }
+        
+        uint32_t start = unit;
+        while (unit < bump && unit < limit && (free_map[unit / 64] & (1ULL << (unit % 64)))) {
+            unit++;
+        }
+        
+        // A run up against the bump pointer becomes fresh space again,
+        // unless an allocation moved the pointer meanwhile
+        uint32_t expected = unit;
+        if (unit == bump && __atomic_compare_exchange_n(&header->bump, &expected, start, false,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+        ipc_free_span(start, unit - start);
+    }
+    
+    __atomic_store_n(&header->sweeping, 0, __ATOMIC_RELEASE);
+    return stolen;
+}
+
+// Allocate a record for a payload, merging free space once if the arena
+// looks full. Returns MIRIX_IPC_NIL when it really is.
+static uint32_t ipc_record_alloc(size_t data_size) {
+    size_t units = (sizeof(mirix_ipc_record_t) + data_size + MIRIX_IPC_RECORD_UNIT - 1) / MIRIX_IPC_RECORD_UNIT;
+    
+    int size_class = 0;
+    while (ipc_class_units[size_class] < units) {
+        size_class++;
+    }
+    
+    uint32_t offset = ipc_class_alloc(size_class);
+    if (offset == MIRIX_IPC_NIL && ipc_arena_sweep()) {
+        offset = ipc_class_alloc(size_class);
+    }
+    
+    return offset;
+}
+
+// Return a record to its class free list
+static void ipc_record_free(uint32_t offset) {
+    ipc_free_push(ipc_record(offset)->size_class, offset);
+}
+
+// Record kinds
+enum {
+    IPC_RECORD_MESSAGE = 0,     // Payload follows the header
+    IPC_RECORD_MULTICAST = 1,   // Body is an ipc_multicast_ref_t
+    IPC_RECORD_PAYLOAD = 2      // Body is an ipc_shared_payload_t, then the payload
+};
+
+// Body of a multicast descriptor
+typedef struct {
+    uint32_t payload;           // Offset of the shared payload record
+} ipc_multicast_ref_t;
+
+// Head of a shared payload record
+typedef struct {
+    uint32_t refcount;          // Descriptors (and the sender) still using it
+    uint32_t reserved;
+} ipc_shared_payload_t;
+
+// Map the named shared region, creating and sizing it if requested
+static void *ipc_map_shared_region(bool create) {
+    int oflag = create ? (O_CREAT | O_RDWR) : O_RDWR;
+    
+    ipc_state.shm_fd = shm_open(MIRIX_IPC_SHM_NAME, oflag, 0666);
+    if (ipc_state.shm_fd == -1) {
+        perror("shm_open");
+        return NULL;
+    }
+    
+    if (create && ftruncate(ipc_state.shm_fd, MIRIX_IPC_REGION_SIZE) == -1) {
+        perror("ftruncate");
+        close(ipc_state.shm_fd);
+        ipc_state.shm_fd = -1;
+        shm_unlink(MIRIX_IPC_SHM_NAME);
+        return NULL;
+    }
+    
+    void *memory = mmap(NULL, MIRIX_IPC_REGION_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, ipc_state.shm_fd, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap");
+        close(ipc_state.shm_fd);
+        ipc_state.shm_fd = -1;
+        if (create) {
+            shm_unlink(MIRIX_IPC_SHM_NAME);
+        }
+        return NULL;
+    }
+    
+    return memory;
+}
+
+// Release the region mapping without touching the names
+static void ipc_unmap_region(void) {
+    if (!ipc_state.shared_memory) {
+        return;
+    }
+    
+    if (ipc_state.mode == MIRIX_IPC_MODE_SHARED) {
+        munmap(ipc_state.shared_memory, ipc_state.shared_memory_size);
+    } else {
+        free(ipc_state.shared_memory);
+    }
+    ipc_state.shared_memory = NULL;
+    
+    if (ipc_state.shm_fd != -1) {
+        close(ipc_state.shm_fd);
+        ipc_state.shm_fd = -1;
+    }
+}
 
 // Initialize IPC system
 int ipc_system_init(void) {
+    return ipc_system_init_mode(MIRIX_IPC_MODE_PRIVATE);
+}
+
+// Install the per-send traffic hook (NULL removes it)
+void ipc_set_traffic_hook(ipc_traffic_fn hook) {
+    ipc_state.traffic_hook = hook;
+}
+
+// Report one queued send: straight to the hook in the kernel, otherwise
+// sampled into the region for the kernel to drain
+static void ipc_note_traffic(uint32_t sender_pid, uint32_t receiver_pid) {
+    if (ipc_state.traffic_hook) {
+        ipc_state.traffic_hook(sender_pid, receiver_pid);
+        return;
+    }
+
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    if (!header || sender_pid == receiver_pid ||
+        (__atomic_add_fetch(&header->traffic_sends, 1, __ATOMIC_RELAXED) & (MIRIX_IPC_TRAFFIC_SAMPLE - 1)) != 0) {
+        return;
+    }
+    uint32_t slot = __atomic_fetch_add(&header->traffic_tail, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->traffic[slot & (MIRIX_IPC_TRAFFIC_SLOTS - 1)],
+                     (uint64_t)sender_pid << 32 | receiver_pid, __ATOMIC_RELAXED);
+
+    // Exactly one sample crosses the threshold between two drains
+    if (__atomic_add_fetch(&header->traffic_pending, 1, __ATOMIC_RELAXED) == MIRIX_IPC_TRAFFIC_WAKE) {
+        uint32_t drainer = __atomic_load_n(&header->traffic_drainer, __ATOMIC_ACQUIRE);
+        if (drainer) {
+            kill((pid_t)drainer, header->traffic_signal);
+        }
+    }
+}
+
+// Register the calling process as the one senders wake
+int ipc_set_traffic_drainer(int signo) {
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    if (!ipc_state.initialized || !header || signo < 0) {
+        return -1;
+    }
+
+    if (signo == 0) {
+        __atomic_store_n(&header->traffic_drainer, 0, __ATOMIC_RELEASE);
+        return 0;
+    }
+    header->traffic_signal = signo;
+    __atomic_store_n(&header->traffic_drainer, (uint32_t)getpid(), __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Hand the sampled sends to fn; a slot is emptied as it is read, so
+// samples written meanwhile are seen by the next drain
+int ipc_drain_traffic(ipc_traffic_fn fn) {
+    mirix_ipc_region_t *header = ipc_state.message_queue.header;
+    if (!ipc_state.initialized || !header || !fn) {
+        return 0;
+    }
+
+    // Samples taken from here on count towards the next wakeup
+    __atomic_store_n(&header->traffic_pending, 0, __ATOMIC_RELAXED);
+
+    int drained = 0;
+    for (int i = 0; i < MIRIX_IPC_TRAFFIC_SLOTS; i++) {
+        uint64_t sample = __atomic_exchange_n(&header->traffic[i], 0, __ATOMIC_RELAXED);
+        if (sample) {
+            fn((uint32_t)(sample >> 32), (uint32_t)sample);
+            drained++;
+        }
+    }
+    return drained;
+}
+
+// Initialize IPC system with an explicit backing store
+int ipc_system_init_mode(mirix_ipc_mode_t mode) {
     if (ipc_state.initialized) {
         return 0;
     }
     
-    // Use malloc instead of shared memory for simplicity
-    ipc_state.shared_memory_size = 1024 * 1024; // 1MB
-    ipc_state.shared_memory = malloc(ipc_state.shared_memory_size);
-    if (!ipc_state.shared_memory) {
+    ipc_state.mode = mode;
+    ipc_state.owner_pid = getpid();
+    
+    void *memory;
+    if (mode == MIRIX_IPC_MODE_SHARED) {
+        // Mapped MAP_SHARED so forked children inherit it and exec'd
+        // programs can reach it through ipc_system_attach()
+        memory = ipc_map_shared_region(true);
+    } else {
+        ipc_state.shm_fd = -1;
+        memory = malloc(MIRIX_IPC_REGION_SIZE);
+    }
+    if (!memory) {
+        return -1;
+    }
+    
+    ipc_bind_region(memory, MIRIX_IPC_REGION_SIZE);
+    ipc_format_region();
+    
+    // Create semaphore for message synchronization; drop any stale one
+    // left behind by a previous kernel so it starts unlocked
+    sem_unlink(MIRIX_IPC_SEM_NAME);
+    ipc_state.message_sem = sem_open(MIRIX_IPC_SEM_NAME, O_CREAT, 0666, 1);
+    if (ipc_state.message_sem == SEM_FAILED) {
+        ipc_unmap_region();
+        if (mode == MIRIX_IPC_MODE_SHARED) {
+            shm_unlink(MIRIX_IPC_SHM_NAME);
+        }
         return -1;
     }
     
-    ipc_state.shm_fd = -1; // Not using shared memory
+    ipc_state.initialized = true;
+    return 0;
+}
+
+// Attach to the shared region created by the kernel (for exec'd programs)
+int ipc_system_attach(void) {
+    if (ipc_state.initialized) {
+        return 0;
+    }
     
-    // Initialize message queue
-    ipc_state.message_queue.messages = (mirix_message_t*)ipc_state.shared_memory;
-    ipc_state.message_queue.capacity = ipc_state.shared_memory_size / sizeof(mirix_message_t);
-    ipc_state.message_queue.head = 0;
-    ipc_state.message_queue.tail = 0;
-    ipc_state.message_queue.count = 0;
+    ipc_state.mode = MIRIX_IPC_MODE_SHARED;
+    ipc_state.owner_pid = 0;
     
-    // Create semaphore for message synchronization
-    ipc_state.message_sem = sem_open("/mirix_ipc_sem", O_CREAT, 0666, 1);
+    void *memory = ipc_map_shared_region(false);
+    if (!memory) {
+        return -1;
+    }
+    
+    ipc_bind_region(memory, MIRIX_IPC_REGION_SIZE);
+    if (ipc_state.message_queue.header->magic != MIRIX_IPC_REGION_MAGIC) {
+        ipc_unmap_region();
+        return -1;
+    }
+    
+    ipc_state.message_sem = sem_open(MIRIX_IPC_SEM_NAME, 0);
     if (ipc_state.message_sem == SEM_FAILED) {
-        free(ipc_state.shared_memory);
+        ipc_unmap_region();
         return -1;
     }
     
@@ -54,21 +473,384 @@ int ipc_system_init(void) {
 
 // Cleanup IPC system
 void ipc_system_cleanup(void) {
+    // Only the creating process removes the names; forked or attached
+    // processes just drop their own references
+    bool owner = ipc_state.owner_pid == getpid();
+    
     if (ipc_state.message_sem != SEM_FAILED) {
         sem_close(ipc_state.message_sem);
-        sem_unlink("/mirix_ipc_sem");
+        ipc_state.message_sem = SEM_FAILED;
+        if (owner) {
+            sem_unlink(MIRIX_IPC_SEM_NAME);
+        }
     }
     
-    if (ipc_state.shared_memory) {
-        free(ipc_state.shared_memory);
+    bool shared = ipc_state.mode == MIRIX_IPC_MODE_SHARED;
+    ipc_unmap_region();
+    if (shared && owner) {
+        shm_unlink(MIRIX_IPC_SHM_NAME);
     }
     
-    if (ipc_state.shm_fd != -1) {
-        close(ipc_state.shm_fd);
-        shm_unlink("/mirix_ipc");
+    ipc_state.initialized = false;
+}
+
+// Milliseconds left until a CLOCK_MONOTONIC deadline (in microseconds)
+static int ipc_remaining_ms(uint64_t deadline_us) {
+    uint64_t now = get_current_timestamp();
+    if (now >= deadline_us) {
+        return 0;
     }
+    return (int)((deadline_us - now + 999) / 1000);
+}
+
+// Hash a receiver pid into the mailbox index
+static uint32_t mailbox_hash(uint32_t pid) {
+    return (pid * 2654435761u) & (MIRIX_IPC_MAX_MAILBOXES - 1);
+}
+
+// Mailbox index slot states
+enum {
+    IPC_MAILBOX_FREE = 0,       // Never used; ends a probe sequence
+    IPC_MAILBOX_CLAIMED = 1,    // Being set up or torn down (under message_sem)
+    IPC_MAILBOX_READY = 2,
+    IPC_MAILBOX_TOMBSTONE = 3   // Released; probes continue past it, inserts reuse it
+};
+
+static uint32_t ipc_mailbox_pop(mirix_mailbox_t *mailbox);
+static void ipc_record_take(mirix_mailbox_t *mailbox, uint32_t offset,
+                            mirix_message_info_t *info, void *buf, size_t buf_size);
+
+// Find the mailbox for a pid. Lock-free; slots only change state under
+// message_sem, and lookups wait out the short CLAIMED window.
+static mirix_mailbox_t *mailbox_find(uint32_t pid) {
+    mirix_mailbox_t *mailboxes = ipc_state.message_queue.header->mailboxes;
+    uint32_t index = mailbox_hash(pid);
     
-    ipc_state.initialized = false;
+    for (uint32_t probe = 0; probe < MIRIX_IPC_MAX_MAILBOXES; probe++) {
+        mirix_mailbox_t *mailbox = &mailboxes[(index + probe) & (MIRIX_IPC_MAX_MAILBOXES - 1)];
+        uint32_t state = __atomic_load_n(&mailbox->state, __ATOMIC_ACQUIRE);
+        while (state == IPC_MAILBOX_CLAIMED) {
+            sched_yield();
+            state = __atomic_load_n(&mailbox->state, __ATOMIC_ACQUIRE);
+        }
+        
+        if (state == IPC_MAILBOX_FREE) {
+            return NULL;
+        }
+        if (state == IPC_MAILBOX_READY && mailbox->pid == pid) {
+            return mailbox;
+        }
+    }
+    
+    return NULL;
+}
+
+// Tear down a mailbox (caller holds message_sem). Senders pin a mailbox
+// while they push, so it is closed first and then waited on. Unless force
+// is set, a mailbox with queued messages or parked receivers is kept;
+// with force, queued messages are dropped (the owner has exited).
+static bool mailbox_release_locked(mirix_mailbox_t *mailbox, bool force) {
+    uint32_t state = IPC_MAILBOX_READY;
+    if (!__atomic_compare_exchange_n(&mailbox->state, &state, IPC_MAILBOX_CLAIMED,
+                                     false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    while (__atomic_load_n(&mailbox->senders, __ATOMIC_SEQ_CST) > 0) {
+        sched_yield();
+    }
+    
+    if (__atomic_load_n(&mailbox->waiters, __ATOMIC_ACQUIRE) > 0 ||
+        (!force && __atomic_load_n(&mailbox->count, __ATOMIC_ACQUIRE) > 0)) {
+        __atomic_store_n(&mailbox->state, IPC_MAILBOX_READY, __ATOMIC_RELEASE);
+        return false;
+    }
+    
+    uint32_t offset;
+    while ((offset = ipc_mailbox_pop(mailbox)) != MIRIX_IPC_NIL) {
+        // A dropped shared-buffer message still owns a segment reference
+        mirix_message_info_t info;
+        mirix_ipc_buffer_ref_t ref;
+        ipc_record_take(mailbox, offset, &info, &ref, sizeof(ref));
+        mirix_ipc_buffer_t buffer;
+        if ((info.flags & MIRIX_IPC_FLAG_BUFFER) &&
+            ipc_buffer_map(&ref, info.data_size, &buffer) == 0) {
+            ipc_buffer_release(&buffer);
+        }
+    }
+    ipc_record_free(mailbox->stub);
+    __atomic_store_n(&mailbox->state, IPC_MAILBOX_TOMBSTONE, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Release every empty mailbox nobody is waiting on (caller holds message_sem)
+static int mailbox_reclaim_idle_locked(void) {
+    mirix_mailbox_t *mailboxes = ipc_state.message_queue.header->mailboxes;
+    int released = 0;
+    for (uint32_t i = 0; i < MIRIX_IPC_MAX_MAILBOXES; i++) {
+        if (__atomic_load_n(&mailboxes[i].state, __ATOMIC_ACQUIRE) == IPC_MAILBOX_READY &&
+            mailbox_release_locked(&mailboxes[i], false)) {
+            released++;
+        }
+    }
+    return released;
+}
+
+// Find or create the mailbox for a pid (caller holds message_sem). New
+// mailboxes take the first tombstone or free slot on the probe path; when
+// the index is full, idle mailboxes are reclaimed first.
+static mirix_mailbox_t *mailbox_create_locked(uint32_t pid) {
+    mirix_mailbox_t *mailboxes = ipc_state.message_queue.header->mailboxes;
+    uint32_t index = mailbox_hash(pid);
+    
+    for (int attempt = 0; attempt < 2; attempt++) {
+        mirix_mailbox_t *mailbox = mailbox_find(pid);
+        if (mailbox) {
+            return mailbox;
+        }
+        
+        for (uint32_t probe = 0; probe < MIRIX_IPC_MAX_MAILBOXES; probe++) {
+            mailbox = &mailboxes[(index + probe) & (MIRIX_IPC_MAX_MAILBOXES - 1)];
+            uint32_t state = __atomic_load_n(&mailbox->state, __ATOMIC_ACQUIRE);
+            if (state != IPC_MAILBOX_FREE && state != IPC_MAILBOX_TOMBSTONE) {
+                continue;
+            }
+            
+            // The queue needs a sentinel record of its own
+            uint32_t stub = ipc_record_alloc(0);
+            if (stub == MIRIX_IPC_NIL) {
+                return NULL;
+            }
+            ipc_record(stub)->next = MIRIX_IPC_NIL;
+            
+            // senders is left alone: a sender that raced the previous
+            // owner's release may still be backing its pin out
+            __atomic_store_n(&mailbox->state, IPC_MAILBOX_CLAIMED, __ATOMIC_RELAXED);
+            mailbox->pid = pid;
+            mailbox->head = stub;
+            mailbox->tail = stub;
+            mailbox->stub = stub;
+            mailbox->handoff = MIRIX_IPC_NIL;
+            mailbox->stash_head = MIRIX_IPC_NIL;
+            mailbox->stash_tail = MIRIX_IPC_NIL;
+            mailbox->count = 0;
+            mailbox->seq = 0;
+            mailbox->waiters = 0;
+            __atomic_store_n(&mailbox->state, IPC_MAILBOX_READY, __ATOMIC_RELEASE);
+            return mailbox;
+        }
+        
+        if (mailbox_reclaim_idle_locked() == 0) {
+            break;
+        }
+    }
+    
+    return NULL; // Index full
+}
+
+// Sender side: find or create the receiver's mailbox and pin it so it
+// cannot be released under the push. Pairs with mailbox_release_locked:
+// either the sender sees CLAIMED and backs out, or the release sees the pin.
+static mirix_mailbox_t *ipc_mailbox_open(uint32_t pid) {
+    for (;;) {
+        mirix_mailbox_t *mailbox = mailbox_find(pid);
+        if (!mailbox) {
+            sem_wait(ipc_state.message_sem);
+            mailbox = mailbox_create_locked(pid);
+            sem_post(ipc_state.message_sem);
+            if (!mailbox) {
+                return NULL;
+            }
+        }
+        
+        __atomic_add_fetch(&mailbox->senders, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&mailbox->state, __ATOMIC_SEQ_CST) == IPC_MAILBOX_READY && mailbox->pid == pid) {
+            return mailbox;
+        }
+        __atomic_sub_fetch(&mailbox->senders, 1, __ATOMIC_RELEASE);
+        sched_yield();
+    }
+}
+
+static void ipc_mailbox_close(mirix_mailbox_t *mailbox) {
+    __atomic_sub_fetch(&mailbox->senders, 1, __ATOMIC_RELEASE);
+}
+
+// Build a message record (not yet visible to the receiver)
+static uint32_t ipc_record_create(uint32_t sender_pid, uint32_t receiver_pid,
+                                  const void *data, size_t data_size, uint32_t flags) {
+    // Take a record sized for the payload
+    uint32_t offset = ipc_record_alloc(data_size);
+    if (offset == MIRIX_IPC_NIL) {
+        return MIRIX_IPC_NIL; // Queue full
+    }
+    
+    // Create message
+    mirix_ipc_record_t *record = ipc_record(offset);
+    record->next = MIRIX_IPC_NIL;
+    record->kind = IPC_RECORD_MESSAGE;
+    record->sender_pid = sender_pid;
+    record->receiver_pid = receiver_pid;
+    record->timestamp = get_current_timestamp();
+    record->flags = flags;
+    record->call_id = 0;
+    record->data_size = (uint16_t)data_size;
+    memcpy(record + 1, data, data_size);
+    
+    return offset;
+}
+
+// Append a linked chain of records to a mailbox (multi-producer, wait-free:
+// one exchange on the tail, then link the previous tail to the chain)
+static void ipc_mailbox_push(mirix_mailbox_t *mailbox, uint32_t first, uint32_t last, uint32_t count) {
+    __atomic_store_n(&ipc_record(last)->next, MIRIX_IPC_NIL, __ATOMIC_RELAXED);
+    uint32_t prev = __atomic_exchange_n(&mailbox->tail, last, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&ipc_record(prev)->next, first, __ATOMIC_RELEASE);
+    
+    if (count > 0) {
+        __atomic_add_fetch(&mailbox->count, count, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&ipc_state.message_queue.header->count, count, __ATOMIC_RELAXED);
+    }
+}
+
+// Publish a send and wake a parked receiver. Pairs with the waiters/seq
+// handshake in ipc_receive_common, hence sequentially consistent.
+static void ipc_mailbox_notify(mirix_mailbox_t *mailbox) {
+    __atomic_add_fetch(&mailbox->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mailbox->waiters, __ATOMIC_SEQ_CST) > 0) {
+        ipc_futex_wake(&mailbox->seq, false);
+    }
+}
+
+// Deliver one record. A receiver parked on an empty mailbox gets it
+// through the handoff slot, skipping the queue links on both sides; the
+// slot is only used with nothing queued, so each sender's order holds.
+static void ipc_mailbox_deliver(mirix_mailbox_t *mailbox, uint32_t offset) {
+    uint32_t queued = __atomic_fetch_add(&mailbox->count, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&ipc_state.message_queue.header->count, 1, __ATOMIC_RELAXED);
+    
+    uint32_t empty = MIRIX_IPC_NIL;
+    if (queued == 0 && __atomic_load_n(&mailbox->waiters, __ATOMIC_SEQ_CST) > 0 &&
+        __atomic_compare_exchange_n(&mailbox->handoff, &empty, offset, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    ipc_mailbox_push(mailbox, offset, offset, 0);
+}
+
+// Queue one message for a receiver without taking any lock (unless its
+// mailbox has to be created). Returns the receiver's mailbox, or NULL if
+// the queue or mailbox index is full.
+static mirix_mailbox_t *ipc_enqueue(uint32_t sender_pid, uint32_t receiver_pid,
+                                    const void *data, size_t data_size, uint32_t flags,
+                                    uint32_t call_id) {
+    mirix_mailbox_t *mailbox = ipc_mailbox_open(receiver_pid);
+    if (!mailbox) {
+        return NULL;
+    }
+    
+    uint32_t offset = ipc_record_create(sender_pid, receiver_pid, data, data_size, flags);
+    if (offset == MIRIX_IPC_NIL) {
+        ipc_mailbox_close(mailbox);
+        return NULL;
+    }
+    ipc_record(offset)->call_id = call_id;
+    
+    ipc_mailbox_deliver(mailbox, offset);
+    ipc_mailbox_notify(mailbox);
+    ipc_mailbox_close(mailbox);
+    ipc_note_traffic(sender_pid, receiver_pid);
+    return mailbox;
+}
+
+// Take the oldest record from a mailbox queue (single consumer: caller
+// holds message_sem). Returns MIRIX_IPC_NIL if empty or if a sender is
+// between its tail exchange and link; that sender's notify follows.
+static uint32_t ipc_queue_pop(mirix_mailbox_t *mailbox) {
+    uint32_t head = mailbox->head;
+    uint32_t next = __atomic_load_n(&ipc_record(head)->next, __ATOMIC_ACQUIRE);
+    
+    if (head == mailbox->stub) {
+        if (next == MIRIX_IPC_NIL) {
+            return MIRIX_IPC_NIL;
+        }
+        mailbox->head = next;
+        head = next;
+        next = __atomic_load_n(&ipc_record(head)->next, __ATOMIC_ACQUIRE);
+    }
+    
+    if (next != MIRIX_IPC_NIL) {
+        mailbox->head = next;
+        return head;
+    }
+    
+    if (head != __atomic_load_n(&mailbox->tail, __ATOMIC_ACQUIRE)) {
+        return MIRIX_IPC_NIL;
+    }
+    
+    // head is the last record; park the stub behind it so it can be taken
+    ipc_mailbox_push(mailbox, mailbox->stub, mailbox->stub, 0);
+    next = __atomic_load_n(&ipc_record(head)->next, __ATOMIC_ACQUIRE);
+    if (next != MIRIX_IPC_NIL) {
+        mailbox->head = next;
+        return head;
+    }
+    
+    return MIRIX_IPC_NIL;
+}
+
+// Next record for the receiver: set-aside records first, then the handoff
+// slot, then the queue (caller holds message_sem)
+static uint32_t ipc_mailbox_pop(mirix_mailbox_t *mailbox) {
+    uint32_t offset = mailbox->stash_head;
+    if (offset != MIRIX_IPC_NIL) {
+        mailbox->stash_head = ipc_record(offset)->next;
+        if (mailbox->stash_head == MIRIX_IPC_NIL) {
+            mailbox->stash_tail = MIRIX_IPC_NIL;
+        }
+        return offset;
+    }
+    
+    if (__atomic_load_n(&mailbox->handoff, __ATOMIC_ACQUIRE) != MIRIX_IPC_NIL) {
+        return __atomic_exchange_n(&mailbox->handoff, MIRIX_IPC_NIL, __ATOMIC_ACQ_REL);
+    }
+    
+    return ipc_queue_pop(mailbox);
+}
+
+// Copy a dequeued record into info/buf and recycle it
+static void ipc_record_take(mirix_mailbox_t *mailbox, uint32_t offset,
+                            mirix_message_info_t *info, void *buf, size_t buf_size) {
+    mirix_ipc_record_t *record = ipc_record(offset);
+    
+    // Copy message
+    if (info) {
+        info->sender_pid = record->sender_pid;
+        info->receiver_pid = record->receiver_pid;
+        info->timestamp = record->timestamp;
+        info->flags = record->flags;
+        info->call_id = record->call_id;
+        info->data_size = record->data_size;
+    }
+    
+    size_t copy_size = record->data_size < buf_size ? record->data_size : buf_size;
+    if (record->kind == IPC_RECORD_MULTICAST) {
+        // Copy out of the shared payload; the last receiver frees it
+        uint32_t payload = ((ipc_multicast_ref_t*)(record + 1))->payload;
+        ipc_shared_payload_t *shared = (ipc_shared_payload_t*)(ipc_record(payload) + 1);
+        if (buf) {
+            memcpy(buf, shared + 1, copy_size);
+        }
+        if (__atomic_sub_fetch(&shared->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+            ipc_record_free(payload);
+        }
+    } else if (buf) {
+        memcpy(buf, record + 1, copy_size);
+    }
+    
+    __atomic_sub_fetch(&mailbox->count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&ipc_state.message_queue.header->count, 1, __ATOMIC_RELAXED);
+    ipc_record_free(offset);
 }
 
 // Send IPC message
@@ -78,99 +860,582 @@ int ipc_send_message(uint32_t sender_pid, uint32_t receiver_pid,
         return -1;
     }
     
-    sem_wait(ipc_state.message_sem);
+    // Larger payloads go through ipc_send_buffer
+    if (data_size > MIRIX_IPC_MAX_DATA_SIZE) {
+        return -1;
+    }
     
-    // Check if queue is full
-    if (ipc_state.message_queue.count >= ipc_state.message_queue.capacity) {
-        sem_post(ipc_state.message_sem);
-        return -1; // Queue full
+    if (!ipc_enqueue(sender_pid, receiver_pid, data, data_size, flags, 0)) {
+        return -1; // Queue full or no mailbox available
     }
     
-    // Create message
-    mirix_message_t *msg = &ipc_state.message_queue.messages[ipc_state.message_queue.tail];
-    msg->sender_pid = sender_pid;
-    msg->receiver_pid = receiver_pid;
-    msg->timestamp = get_current_timestamp();
-    msg->flags = flags;
-    msg->data_size = data_size;
-    
-    // Copy data if it fits
-    if (data_size <= MIRIX_IPC_MAX_DATA_SIZE) {
-        memcpy(msg->data, data, data_size);
-    } else {
-        // For large messages, we'd need a different approach
-        sem_post(ipc_state.message_sem);
+    return 0;
+}
+
+// Send several messages. Runs of messages for the same receiver are linked
+// up front and published with a single tail exchange and wakeup. Stops at
+// the first message that does not fit and returns how many were queued.
+int ipc_send_batch(uint32_t sender_pid, const mirix_ipc_send_entry_t *entries, size_t count) {
+    if (!ipc_state.initialized || !entries) {
         return -1;
     }
     
-    // Update queue
-    ipc_state.message_queue.tail = (ipc_state.message_queue.tail + 1) % ipc_state.message_queue.capacity;
-    ipc_state.message_queue.count++;
+    if (count > MIRIX_IPC_MAX_BATCH) {
+        count = MIRIX_IPC_MAX_BATCH;
+    }
     
-    sem_post(ipc_state.message_sem);
+    size_t sent = 0;
+    while (sent < count) {
+        uint32_t receiver_pid = entries[sent].receiver_pid;
+        mirix_mailbox_t *mailbox = ipc_mailbox_open(receiver_pid);
+        if (!mailbox) {
+            break;
+        }
+        
+        uint32_t first = MIRIX_IPC_NIL;
+        uint32_t last = MIRIX_IPC_NIL;
+        uint32_t run = 0;
+        bool full = false;
+        
+        for (; sent + run < count && entries[sent + run].receiver_pid == receiver_pid; run++) {
+            const mirix_ipc_send_entry_t *entry = &entries[sent + run];
+            uint32_t offset = MIRIX_IPC_NIL;
+            if (entry->data_size <= MIRIX_IPC_MAX_DATA_SIZE) {
+                offset = ipc_record_create(sender_pid, receiver_pid,
+                                           entry->data, entry->data_size, entry->flags);
+            }
+            if (offset == MIRIX_IPC_NIL) {
+                full = true;
+                break;
+            }
+            
+            if (last == MIRIX_IPC_NIL) {
+                first = offset;
+            } else {
+                ipc_record(last)->next = offset;
+            }
+            last = offset;
+        }
+        
+        if (run > 0) {
+            ipc_mailbox_push(mailbox, first, last, run);
+            ipc_mailbox_notify(mailbox);
+            ipc_note_traffic(sender_pid, receiver_pid);
+            sent += run;
+        }
+        ipc_mailbox_close(mailbox);
+        if (full) {
+            break;
+        }
+    }
     
-    printf("IPC message sent from %u to %u (size: %zu)\n", 
-           sender_pid, receiver_pid, data_size);
+    return (int)sent;
+}
+
+// Queue one message for several receivers. The payload is copied once into
+// a refcounted record and each receiver gets a one-unit descriptor, unless
+// the payload is small enough to fit in the descriptor itself.
+int ipc_multicast(uint32_t sender_pid, const uint32_t *receiver_pids, size_t receiver_count,
+                  const void *data, size_t data_size, uint32_t flags) {
+    if (!ipc_state.initialized || !receiver_pids || data_size > MIRIX_IPC_MAX_DATA_SIZE) {
+        return -1;
+    }
     
-    return 0;
+    bool inline_payload = sizeof(mirix_ipc_record_t) + data_size <= MIRIX_IPC_RECORD_UNIT;
+    uint32_t payload = MIRIX_IPC_NIL;
+    ipc_shared_payload_t *shared = NULL;
+    
+    if (!inline_payload) {
+        payload = ipc_record_alloc(sizeof(ipc_shared_payload_t) + data_size);
+        if (payload == MIRIX_IPC_NIL) {
+            return -1; // Queue full
+        }
+        
+        mirix_ipc_record_t *record = ipc_record(payload);
+        record->kind = IPC_RECORD_PAYLOAD;
+        record->sender_pid = sender_pid;
+        record->data_size = (uint16_t)data_size;
+        shared = (ipc_shared_payload_t*)(record + 1);
+        memcpy(shared + 1, data, data_size);
+        
+        // The sender holds a reference until every descriptor is queued
+        __atomic_store_n(&shared->refcount, 1, __ATOMIC_RELAXED);
+    }
+    
+    size_t sent = 0;
+    for (; sent < receiver_count; sent++) {
+        mirix_mailbox_t *mailbox = ipc_mailbox_open(receiver_pids[sent]);
+        if (!mailbox) {
+            break;
+        }
+        
+        uint32_t offset;
+        if (inline_payload) {
+            offset = ipc_record_create(sender_pid, receiver_pids[sent], data, data_size, flags);
+        } else {
+            offset = ipc_record_alloc(sizeof(ipc_multicast_ref_t));
+            if (offset != MIRIX_IPC_NIL) {
+                mirix_ipc_record_t *record = ipc_record(offset);
+                record->next = MIRIX_IPC_NIL;
+                record->kind = IPC_RECORD_MULTICAST;
+                record->sender_pid = sender_pid;
+                record->receiver_pid = receiver_pids[sent];
+                record->timestamp = get_current_timestamp();
+                record->flags = flags;
+                record->call_id = 0;
+                record->data_size = (uint16_t)data_size;
+                ((ipc_multicast_ref_t*)(record + 1))->payload = payload;
+                __atomic_add_fetch(&shared->refcount, 1, __ATOMIC_RELAXED);
+            }
+        }
+        if (offset == MIRIX_IPC_NIL) {
+            ipc_mailbox_close(mailbox);
+            break; // Queue full
+        }
+        
+        ipc_mailbox_push(mailbox, offset, offset, 1);
+        ipc_mailbox_notify(mailbox);
+        ipc_mailbox_close(mailbox);
+        ipc_note_traffic(sender_pid, receiver_pids[sent]);
+    }
+    
+    if (shared && __atomic_sub_fetch(&shared->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        ipc_record_free(payload);
+    }
+    
+    return (int)sent;
 }
 
 // Receive IPC message
 int ipc_receive_message(uint32_t receiver_pid, mirix_message_t *msg, bool block) {
-    if (!ipc_state.initialized || !msg) {
+    return ipc_receive_message_timeout(receiver_pid, msg, block ? -1 : 0);
+}
+
+// Receive IPC message, waiting up to timeout_ms (0 = poll, negative = forever)
+int ipc_receive_message_timeout(uint32_t receiver_pid, mirix_message_t *msg, int timeout_ms) {
+    if (!msg) {
+        return -1;
+    }
+    
+    mirix_message_info_t info;
+    if (ipc_receive_into(receiver_pid, &info, msg->data, sizeof(msg->data), timeout_ms) != 0) {
         return -1;
     }
     
+    msg->sender_pid = info.sender_pid;
+    msg->receiver_pid = info.receiver_pid;
+    msg->timestamp = info.timestamp;
+    msg->flags = info.flags;
+    msg->data_size = info.data_size;
+    return 0;
+}
+
+// Message queued just before the receive that follows it
+typedef struct {
+    uint32_t sender_pid;
+    uint32_t receiver_pid;
+    const void *data;
+    size_t data_size;
+    uint32_t flags;
+    uint32_t call_id;
+} ipc_send_op_t;
+
+// Selective receive: only records from sender_pid carrying all of flags
+// and, if call_id is set, answering that call
+typedef struct {
+    uint32_t sender_pid;
+    uint32_t flags;
+    uint32_t call_id;
+} ipc_match_t;
+
+static bool ipc_record_matches(const mirix_ipc_record_t *record, const ipc_match_t *match) {
+    return record->sender_pid == match->sender_pid && (record->flags & match->flags) == match->flags &&
+           (match->call_id == 0 || record->call_id == match->call_id);
+}
+
+// Set a record aside for later receives (caller holds message_sem)
+static void ipc_stash_append(mirix_mailbox_t *mailbox, uint32_t offset) {
+    ipc_record(offset)->next = MIRIX_IPC_NIL;
+    if (mailbox->stash_tail == MIRIX_IPC_NIL) {
+        mailbox->stash_head = offset;
+    } else {
+        ipc_record(mailbox->stash_tail)->next = offset;
+    }
+    mailbox->stash_tail = offset;
+}
+
+// Find the first record that matches. Records pulled off the queue ahead
+// of it are set aside in arrival order for later receives (caller holds
+// message_sem).
+static uint32_t ipc_find_locked(mirix_mailbox_t *mailbox, const ipc_match_t *match) {
+    uint32_t prev = MIRIX_IPC_NIL;
+    for (uint32_t offset = mailbox->stash_head; offset != MIRIX_IPC_NIL; offset = ipc_record(offset)->next) {
+        mirix_ipc_record_t *record = ipc_record(offset);
+        if (ipc_record_matches(record, match)) {
+            if (prev == MIRIX_IPC_NIL) {
+                mailbox->stash_head = record->next;
+            } else {
+                ipc_record(prev)->next = record->next;
+            }
+            if (mailbox->stash_tail == offset) {
+                mailbox->stash_tail = prev;
+            }
+            return offset;
+        }
+        prev = offset;
+    }
+    
+    uint32_t offset = __atomic_load_n(&mailbox->handoff, __ATOMIC_ACQUIRE);
+    if (offset != MIRIX_IPC_NIL) {
+        offset = __atomic_exchange_n(&mailbox->handoff, MIRIX_IPC_NIL, __ATOMIC_ACQ_REL);
+        if (ipc_record_matches(ipc_record(offset), match)) {
+            return offset;
+        }
+        ipc_stash_append(mailbox, offset);
+    }
+    
+    while ((offset = ipc_queue_pop(mailbox)) != MIRIX_IPC_NIL) {
+        if (ipc_record_matches(ipc_record(offset), match)) {
+            return offset;
+        }
+        ipc_stash_append(mailbox, offset);
+    }
+    
+    return MIRIX_IPC_NIL;
+}
+
+// Wait until the receiver's mailbox is non-empty, then drain up to count
+// messages. Returns the number received, or -1. Senders never take
+// message_sem; it only serializes receivers. An optional send is queued
+// first; with a match, only one matching record is taken.
+static int ipc_receive_common(uint32_t receiver_pid, const ipc_send_op_t *send, const ipc_match_t *match,
+                              mirix_ipc_recv_entry_t *entries, size_t count, int timeout_ms) {
+    uint64_t deadline = 0;
+    if (timeout_ms > 0) {
+        deadline = get_current_timestamp() + (uint64_t)timeout_ms * 1000;
+    }
+    
+    if (send && !ipc_enqueue(send->sender_pid, send->receiver_pid,
+                             send->data, send->data_size, send->flags, send->call_id)) {
+        errno = EAGAIN;
+        return -1; // Queue full
+    }
+    
     while (true) {
         sem_wait(ipc_state.message_sem);
         
-        // Check if there's a message for this receiver
-        int found_index = -1;
-        for (int i = 0; i < ipc_state.message_queue.count; i++) {
-            int index = (ipc_state.message_queue.head + i) % ipc_state.message_queue.capacity;
-            mirix_message_t *candidate = &ipc_state.message_queue.messages[index];
-            
-            if (candidate->receiver_pid == receiver_pid) {
-                found_index = index;
-                break;
+        // A blocking receiver creates its mailbox so it has a word to park on
+        mirix_mailbox_t *mailbox = timeout_ms != 0 ? mailbox_create_locked(receiver_pid) : mailbox_find(receiver_pid);
+        
+        // Sample seq before looking, so a send that lands after the check
+        // changes it and the futex wait below returns at once
+        uint32_t seq = mailbox ? __atomic_load_n(&mailbox->seq, __ATOMIC_SEQ_CST) : 0;
+        
+        size_t received = 0;
+        if (mailbox && match) {
+            uint32_t offset = ipc_find_locked(mailbox, match);
+            if (offset != MIRIX_IPC_NIL) {
+                ipc_record_take(mailbox, offset, &entries[0].info, entries[0].buf, entries[0].buf_size);
+                received = 1;
+            }
+        } else if (mailbox) {
+            uint32_t offset;
+            while (received < count && (offset = ipc_mailbox_pop(mailbox)) != MIRIX_IPC_NIL) {
+                mirix_ipc_recv_entry_t *entry = &entries[received++];
+                ipc_record_take(mailbox, offset, &entry->info, entry->buf, entry->buf_size);
             }
         }
         
-        if (found_index != -1) {
-            // Copy message
-            mirix_message_t *src_msg = &ipc_state.message_queue.messages[found_index];
-            memcpy(msg, src_msg, sizeof(mirix_message_t));
-            
-            // Remove message from queue
-            // Shift remaining messages
-            for (int i = found_index; i != ipc_state.message_queue.head; 
-                 i = (i - 1 + ipc_state.message_queue.capacity) % ipc_state.message_queue.capacity) {
-                int prev = (i - 1 + ipc_state.message_queue.capacity) % ipc_state.message_queue.capacity;
-                memcpy(&ipc_state.message_queue.messages[i], 
-                       &ipc_state.message_queue.messages[prev], 
-                       sizeof(mirix_message_t));
-            }
-            
-            ipc_state.message_queue.head = (ipc_state.message_queue.head + 1) % ipc_state.message_queue.capacity;
-            ipc_state.message_queue.count--;
-            
+        int wait_ms = timeout_ms < 0 ? -1 : (timeout_ms == 0 ? 0 : ipc_remaining_ms(deadline));
+        if (received > 0 || !mailbox || wait_ms == 0) {
             sem_post(ipc_state.message_sem);
-            
-            printf("IPC message received by %u (from %u, size: %zu)\n", 
-                   receiver_pid, msg->sender_pid, msg->data_size);
-            
-            return 0;
+            if (received > 0) {
+                return (int)received;
+            }
+            if (timeout_ms != 0) {
+                errno = mailbox ? ETIMEDOUT : ENOSPC;
+            }
+            return -1; // No message available
         }
         
+        // Park on the mailbox until a sender bumps seq
+        __atomic_add_fetch(&mailbox->waiters, 1, __ATOMIC_SEQ_CST);
         sem_post(ipc_state.message_sem);
         
-        if (!block) {
-            return -1; // No message available and non-blocking
+        ipc_futex_wait(&mailbox->seq, seq, wait_ms);
+        __atomic_sub_fetch(&mailbox->waiters, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// Receive straight from the queue slot into a caller buffer (single copy)
+int ipc_receive_into(uint32_t receiver_pid, mirix_message_info_t *info,
+                     void *buf, size_t buf_size, int timeout_ms) {
+    if (!ipc_state.initialized || (!buf && buf_size > 0)) {
+        return -1;
+    }
+    
+    mirix_ipc_recv_entry_t entry = { .buf = buf, .buf_size = buf_size };
+    if (ipc_receive_common(receiver_pid, NULL, NULL, &entry, 1, timeout_ms) != 1) {
+        return -1;
+    }
+    
+    if (info) {
+        *info = entry.info;
+    }
+    
+    return 0;
+}
+
+// Receive the next message from one sender; messages from others stay
+// queued, in order, for later receives
+int ipc_receive_from(uint32_t receiver_pid, uint32_t sender_pid, mirix_message_info_t *info,
+                     void *buf, size_t buf_size, int timeout_ms) {
+    if (!ipc_state.initialized || (!buf && buf_size > 0)) {
+        return -1;
+    }
+    
+    ipc_match_t match = { .sender_pid = sender_pid, .flags = 0 };
+    mirix_ipc_recv_entry_t entry = { .buf = buf, .buf_size = buf_size };
+    if (ipc_receive_common(receiver_pid, NULL, &match, &entry, 1, timeout_ms) != 1) {
+        return -1;
+    }
+    
+    if (info) {
+        *info = entry.info;
+    }
+    return 0;
+}
+
+// Drop a receiver's mailbox and anything still queued for it, e.g. once
+// the process has exited. Fails while a receiver is parked on it.
+int ipc_mailbox_release(uint32_t pid) {
+    if (!ipc_state.initialized) {
+        return -1;
+    }
+    
+    sem_wait(ipc_state.message_sem);
+    mirix_mailbox_t *mailbox = mailbox_find(pid);
+    int result = mailbox && mailbox_release_locked(mailbox, true) ? 0 : -1;
+    sem_post(ipc_state.message_sem);
+    return result;
+}
+
+// Receive up to count messages; waits like ipc_receive_message_timeout for
+// the first one and takes whatever else is already queued
+int ipc_receive_batch(uint32_t receiver_pid, mirix_ipc_recv_entry_t *entries, size_t count,
+                      int timeout_ms) {
+    if (!ipc_state.initialized || !entries || count == 0) {
+        return -1;
+    }
+    
+    if (count > MIRIX_IPC_MAX_BATCH) {
+        count = MIRIX_IPC_MAX_BATCH;
+    }
+    
+    return ipc_receive_common(receiver_pid, NULL, NULL, entries, count, timeout_ms);
+}
+
+// Send a request and wait for the target's reply. The request is queued
+// and the caller parks in one lock round; the reply is picked out of the
+// caller's mailbox by call id even if other messages are queued ahead of
+// it. A reply that arrives after its call gave up is left for ordinary
+// receives (it carries MIRIX_IPC_FLAG_REPLY).
+int ipc_call(uint32_t caller_pid, uint32_t target_pid,
+             const void *req, size_t req_size,
+             mirix_message_info_t *reply_info, void *reply, size_t reply_size,
+             int timeout_ms) {
+    if (!ipc_state.initialized || req_size > MIRIX_IPC_MAX_DATA_SIZE || target_pid == 0 ||
+        (!reply && reply_size > 0)) {
+        return -1;
+    }
+    
+    // Ids are unique across the region, so concurrent callers sharing a
+    // mailbox cannot take each other's replies; 0 means "not a call"
+    uint32_t call_id;
+    do {
+        call_id = __atomic_add_fetch(&ipc_state.message_queue.header->next_call_id, 1, __ATOMIC_RELAXED);
+    } while (call_id == 0);
+    
+    ipc_send_op_t send = {
+        .sender_pid = caller_pid,
+        .receiver_pid = target_pid,
+        .data = req,
+        .data_size = req_size,
+        .flags = MIRIX_IPC_FLAG_CALL,
+        .call_id = call_id
+    };
+    ipc_match_t match = { .sender_pid = target_pid, .flags = MIRIX_IPC_FLAG_REPLY, .call_id = call_id };
+    mirix_ipc_recv_entry_t entry = { .buf = reply, .buf_size = reply_size };
+    
+    // A call always waits for its reply (timeout 0 would only poll)
+    if (ipc_receive_common(caller_pid, &send, &match, &entry, 1, timeout_ms == 0 ? -1 : timeout_ms) != 1) {
+        return -1;
+    }
+    
+    if (reply_info) {
+        *reply_info = entry.info;
+    }
+    return 0;
+}
+
+// Server side of ipc_call: reply to the request described by reply_to
+// (NULL for none) and take the next request in the same lock round.
+// info may point at *reply_to; the reply is queued before it is reused.
+int ipc_reply_and_receive(uint32_t server_pid, const mirix_message_info_t *reply_to,
+                          const void *reply, size_t reply_size,
+                          mirix_message_info_t *info, void *buf, size_t buf_size,
+                          int timeout_ms) {
+    if (!ipc_state.initialized || reply_size > MIRIX_IPC_MAX_DATA_SIZE || (!buf && buf_size > 0)) {
+        return -1;
+    }
+    
+    ipc_send_op_t send = {
+        .sender_pid = server_pid,
+        .receiver_pid = reply_to ? reply_to->sender_pid : 0,
+        .data = reply,
+        .data_size = reply_size,
+        .flags = MIRIX_IPC_FLAG_REPLY,
+        .call_id = reply_to ? reply_to->call_id : 0
+    };
+    mirix_ipc_recv_entry_t entry = { .buf = buf, .buf_size = buf_size };
+    
+    if (ipc_receive_common(server_pid, reply_to ? &send : NULL, NULL, &entry, 1, timeout_ms) != 1) {
+        return -1;
+    }
+    
+    if (info) {
+        *info = entry.info;
+    }
+    return 0;
+}
+
+// Shared buffer segment header; payload follows at a cache-line boundary
+typedef struct {
+    uint32_t magic;
+    uint32_t refcount;
+    uint64_t size;
+} ipc_buffer_header_t;
+
+#define IPC_BUFFER_DATA_OFFSET 64
+
+// Map a named buffer segment into this process
+static int ipc_buffer_open(const char *name, bool create, size_t size, mirix_ipc_buffer_t *buffer) {
+    int fd = shm_open(name, create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0666);
+    if (fd == -1) {
+        return -1;
+    }
+    
+    size_t mapping_size = IPC_BUFFER_DATA_OFFSET + size;
+    if (create && ftruncate(fd, (off_t)mapping_size) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    
+    void *mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the segment alive
+    if (mapping == MAP_FAILED) {
+        if (create) {
+            shm_unlink(name);
         }
-        
-        // Block and wait for message
-        usleep(1000); // 1ms
+        return -1;
     }
+    
+    strncpy(buffer->name, name, sizeof(buffer->name) - 1);
+    buffer->name[sizeof(buffer->name) - 1] = '\0';
+    buffer->mapping = mapping;
+    buffer->mapping_size = mapping_size;
+    buffer->data = (uint8_t*)mapping + IPC_BUFFER_DATA_OFFSET;
+    buffer->size = size;
+    return 0;
+}
+
+// Create a shared buffer for the large-message path; the caller owns one reference
+int ipc_buffer_create(size_t size, mirix_ipc_buffer_t *buffer) {
+    static uint32_t buffer_serial;
+    
+    if (!buffer || size == 0) {
+        return -1;
+    }
+    
+    char name[MIRIX_IPC_BUFFER_NAME_MAX];
+    snprintf(name, sizeof(name), "/mirix_buf.%d.%u", (int)getpid(),
+             __atomic_add_fetch(&buffer_serial, 1, __ATOMIC_RELAXED));
+    
+    if (ipc_buffer_open(name, true, size, buffer) != 0) {
+        return -1;
+    }
+    
+    ipc_buffer_header_t *header = (ipc_buffer_header_t*)buffer->mapping;
+    header->size = size;
+    header->refcount = 1;
+    header->magic = MIRIX_IPC_BUFFER_MAGIC;
+    return 0;
+}
+
+// Hand a reference to a shared buffer to another process; only the small
+// reference record is copied through the queue
+int ipc_send_buffer(uint32_t sender_pid, uint32_t receiver_pid,
+                    const mirix_ipc_buffer_t *buffer, uint32_t flags) {
+    if (!buffer || !buffer->mapping) {
+        return -1;
+    }
+    
+    ipc_buffer_header_t *header = (ipc_buffer_header_t*)buffer->mapping;
+    mirix_ipc_buffer_ref_t ref;
+    memset(&ref, 0, sizeof(ref));
+    memcpy(ref.name, buffer->name, sizeof(ref.name));
+    ref.size = buffer->size;
+    
+    // The in-flight message owns a reference until the receiver maps it
+    __atomic_add_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL);
+    
+    if (ipc_send_message(sender_pid, receiver_pid, &ref, sizeof(ref), flags | MIRIX_IPC_FLAG_BUFFER) != 0) {
+        __atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Map the buffer named by a received MIRIX_IPC_FLAG_BUFFER payload; the
+// message's reference passes to the caller
+int ipc_buffer_map(const void *ref, size_t ref_size, mirix_ipc_buffer_t *buffer) {
+    if (!ref || ref_size < sizeof(mirix_ipc_buffer_ref_t) || !buffer) {
+        return -1;
+    }
+    
+    mirix_ipc_buffer_ref_t buffer_ref;
+    memcpy(&buffer_ref, ref, sizeof(buffer_ref));
+    buffer_ref.name[sizeof(buffer_ref.name) - 1] = '\0';
+    
+    if (ipc_buffer_open(buffer_ref.name, false, (size_t)buffer_ref.size, buffer) != 0) {
+        return -1;
+    }
+    
+    ipc_buffer_header_t *header = (ipc_buffer_header_t*)buffer->mapping;
+    if (header->magic != MIRIX_IPC_BUFFER_MAGIC || header->size != buffer_ref.size) {
+        munmap(buffer->mapping, buffer->mapping_size);
+        buffer->mapping = NULL;
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Drop a reference; the last holder removes the segment
+void ipc_buffer_release(mirix_ipc_buffer_t *buffer) {
+    if (!buffer || !buffer->mapping) {
+        return;
+    }
+    
+    ipc_buffer_header_t *header = (ipc_buffer_header_t*)buffer->mapping;
+    if (__atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        shm_unlink(buffer->name);
+    }
+    
+    munmap(buffer->mapping, buffer->mapping_size);
+    memset(buffer, 0, sizeof(*buffer));
 }
 
 // Process pending IPC messages
@@ -8,6 +8,49 @@
 // Maximum IPC message data size
 #define MIRIX_IPC_MAX_DATA_SIZE 4096
 
+// Mailbox index (must be a power of two)
+#define MIRIX_IPC_MAX_MAILBOXES 256
+
+// End-of-list marker for record links
+#define MIRIX_IPC_NIL UINT32_MAX
+
+// Shared IPC region
+#define MIRIX_IPC_SHM_NAME "/mirix_ipc"
+#define MIRIX_IPC_SEM_NAME "/mirix_ipc_sem"
+#define MIRIX_IPC_REGION_SIZE (1024 * 1024)
+#define MIRIX_IPC_REGION_MAGIC 0x4D495043 // 'MIPC'
+
+// Message records are carved from the region in cache-line units and
+// recycled through per-size-class free lists
+#define MIRIX_IPC_RECORD_UNIT 64
+#define MIRIX_IPC_SIZE_CLASSES 7
+
+// Message flags reserved by the IPC layer (low 16 bits are free for callers)
+#define MIRIX_IPC_FLAG_BUFFER 0x80000000u  // Payload is a mirix_ipc_buffer_ref_t
+#define MIRIX_IPC_FLAG_CALL   0x40000000u  // Request from ipc_call; sender awaits a reply
+#define MIRIX_IPC_FLAG_REPLY  0x20000000u  // Reply from ipc_reply_and_receive
+
+// Sends outside the kernel (no traffic hook) are sampled one in
+// TRAFFIC_SAMPLE into a lossy ring of (sender, receiver) pairs that the
+// kernel drains with ipc_drain_traffic (must be powers of two). The
+// sample that leaves TRAFFIC_WAKE undrained signals the drainer.
+#define MIRIX_IPC_TRAFFIC_SAMPLE 16
+#define MIRIX_IPC_TRAFFIC_SLOTS 256
+#define MIRIX_IPC_TRAFFIC_WAKE 64
+
+// Upper bound on messages moved per batch call
+#define MIRIX_IPC_MAX_BATCH 64
+
+// Shared buffers for the large-message path
+#define MIRIX_IPC_BUFFER_NAME_MAX 32
+#define MIRIX_IPC_BUFFER_MAGIC 0x4D425546 // 'MBUF'
+
+// Backing store for the message queue
+typedef enum {
+    MIRIX_IPC_MODE_PRIVATE = 0,   // Heap region, visible to this process only
+    MIRIX_IPC_MODE_SHARED = 1     // shm_open/mmap region, inherited or attached by children
+} mirix_ipc_mode_t;
+
 // IPC message structure
 typedef struct {
     uint32_t sender_pid;
@@ -18,25 +61,166 @@ typedef struct {
     uint8_t data[MIRIX_IPC_MAX_DATA_SIZE];
 } mirix_message_t;
 
-// Message queue structure
+// Header fields of a received message (data goes to a caller buffer)
+typedef struct {
+    uint32_t sender_pid;
+    uint32_t receiver_pid;
+    uint64_t timestamp;
+    uint32_t flags;
+    uint32_t call_id;    // ipc_call request: pass this info back to ipc_reply_and_receive
+    size_t data_size;    // Full payload size, even if the caller buffer was smaller
+} mirix_message_info_t;
+
+// One message of an ipc_send_batch call
+typedef struct {
+    uint32_t receiver_pid;
+    uint32_t flags;
+    const void *data;
+    size_t data_size;
+} mirix_ipc_send_entry_t;
+
+// One message of an ipc_receive_batch call; payload lands in buf
+typedef struct {
+    mirix_message_info_t info;
+    void *buf;
+    size_t buf_size;
+} mirix_ipc_recv_entry_t;
+
+// Refcounted shared segment for payloads above MIRIX_IPC_MAX_DATA_SIZE.
+// Only a mirix_ipc_buffer_ref_t travels through the queue; the receiver
+// maps the same pages instead of copying them.
+typedef struct {
+    char name[MIRIX_IPC_BUFFER_NAME_MAX];
+    void *data;
+    size_t size;
+    void *mapping;        // Segment base (header + payload)
+    size_t mapping_size;
+} mirix_ipc_buffer_t;
+
+// What the queue carries for a MIRIX_IPC_FLAG_BUFFER message
+typedef struct {
+    char name[MIRIX_IPC_BUFFER_NAME_MAX];
+    uint64_t size;
+} mirix_ipc_buffer_ref_t;
+
+// Queued message record; data_size bytes of payload follow the header.
+// Records are addressed by their offset in MIRIX_IPC_RECORD_UNIT units.
+typedef struct {
+    uint32_t next;          // Next record in mailbox or free list
+    uint32_t sender_pid;
+    uint32_t receiver_pid;
+    uint32_t flags;
+    uint64_t timestamp;
+    uint32_t call_id;       // Pairs an ipc_call request with its reply (0 = none)
+    uint16_t data_size;     // At most MIRIX_IPC_MAX_DATA_SIZE
+    uint8_t size_class;
+    uint8_t kind;           // Message, multicast descriptor or shared payload
+} mirix_ipc_record_t;
+
+// Per-receiver mailbox: intrusive MPSC queue of record offsets. Senders
+// append with an atomic exchange on tail; the receiver side owns head
+// and the stash under message_sem.
 typedef struct {
-    mirix_message_t *messages;
-    size_t capacity;
-    size_t head;
-    size_t tail;
-    size_t count;
+    uint32_t pid;
+    uint32_t state;        // Index slot state, claimed by CAS
+    uint32_t head;         // Receiver end
+    uint32_t tail;         // Sender end
+    uint32_t stub;         // Sentinel record of the queue
+    uint32_t handoff;      // Record passed straight to a parked receiver, or NIL
+    uint32_t stash_head;   // Records set aside while ipc_call looks for its reply
+    uint32_t stash_tail;
+    uint32_t count;
+    uint32_t seq;          // Bumped on every send; receivers park on it
+    uint32_t waiters;      // Receivers currently parked on seq
+    uint32_t senders;      // Senders pushing right now; release waits them out
+} mirix_mailbox_t;
+
+// Region header; everything in the region is addressed by index so it
+// can be mapped at a different address in each process
+typedef struct {
+    uint32_t magic;
+    uint32_t capacity;     // Record arena size in units
+    uint32_t count;
+    uint32_t bump;         // First never-allocated unit
+    uint32_t next_call_id; // Last ipc_call id handed out
+    uint32_t sweeping;     // Set while an allocator merges free records
+    uint64_t free_heads[MIRIX_IPC_SIZE_CLASSES];  // ABA tag << 32 | record offset
+    uint32_t traffic_sends;  // Unhooked sends, for sampling
+    uint32_t traffic_tail;   // Next sample slot; old samples are overwritten
+    uint32_t traffic_pending; // Samples since the last drain
+    uint32_t traffic_drainer; // Pid signalled at TRAFFIC_WAKE pending samples, 0 = none
+    int32_t traffic_signal;
+    uint64_t traffic[MIRIX_IPC_TRAFFIC_SLOTS]; // sender << 32 | receiver, 0 = empty
+    mirix_mailbox_t mailboxes[MIRIX_IPC_MAX_MAILBOXES]; // Hash index keyed by receiver pid
+} mirix_ipc_region_t;
+
+// Message queue structure (process-local view of the region)
+typedef struct {
+    mirix_ipc_region_t *header;
+    uint8_t *arena;                // Record storage, after the header
 } mirix_message_queue_t;
 
+// Sees every queued send (sender, receiver); the scheduler uses it to keep
+// chatty processes on cache-sharing vCPUs
+typedef void (*ipc_traffic_fn)(uint32_t sender_pid, uint32_t receiver_pid);
+
 // IPC API
 int ipc_system_init(void);
+int ipc_system_init_mode(mirix_ipc_mode_t mode);
+int ipc_system_attach(void);
 void ipc_system_cleanup(void);
+void ipc_set_traffic_hook(ipc_traffic_fn hook);
+
+// Pass the sampled sends of processes without a hook to fn and clear them;
+// returns the number of samples
+int ipc_drain_traffic(ipc_traffic_fn fn);
 
-int ipc_send_message(uint32_t sender_pid, uint32_t receiver_pid, 
+// Have senders signal the calling process with signo once TRAFFIC_WAKE
+// samples wait to be drained (signo 0 = no signal)
+int ipc_set_traffic_drainer(int signo);
+
+int ipc_send_message(uint32_t sender_pid, uint32_t receiver_pid,
                     const void *data, size_t data_size, uint32_t flags);
 int ipc_receive_message(uint32_t receiver_pid, mirix_message_t *msg, bool block);
-void ipc_process_messages(void);
+int ipc_receive_message_timeout(uint32_t receiver_pid, mirix_message_t *msg, int timeout_ms);
+int ipc_receive_into(uint32_t receiver_pid, mirix_message_info_t *info,
+                     void *buf, size_t buf_size, int timeout_ms);
+int ipc_receive_from(uint32_t receiver_pid, uint32_t sender_pid, mirix_message_info_t *info,
+                     void *buf, size_t buf_size, int timeout_ms);
+
+// Batched API: one lock round for up to MIRIX_IPC_MAX_BATCH messages;
+// both return the number of messages moved
+int ipc_send_batch(uint32_t sender_pid, const mirix_ipc_send_entry_t *entries, size_t count);
+int ipc_receive_batch(uint32_t receiver_pid, mirix_ipc_recv_entry_t *entries, size_t count,
+                      int timeout_ms);
 
-// Internal helper
-static uint64_t get_current_timestamp(void);
+// Multicast: the payload is stored once and each receiver gets a small
+// descriptor; returns the number of receivers the message was queued for
+int ipc_multicast(uint32_t sender_pid, const uint32_t *receiver_pids, size_t receiver_count,
+                  const void *data, size_t data_size, uint32_t flags);
+
+// Synchronous RPC. A reply is matched to its call by a per-call id, so a
+// late reply to a call that timed out is never taken for a newer one.
+// With the peer parked, request and reply bypass the queue entirely.
+int ipc_call(uint32_t caller_pid, uint32_t target_pid,
+             const void *req, size_t req_size,
+             mirix_message_info_t *reply_info, void *reply, size_t reply_size,
+             int timeout_ms);
+int ipc_reply_and_receive(uint32_t server_pid, const mirix_message_info_t *reply_to,
+                          const void *reply, size_t reply_size,
+                          mirix_message_info_t *info, void *buf, size_t buf_size,
+                          int timeout_ms);
+
+// Large-message path
+int ipc_buffer_create(size_t size, mirix_ipc_buffer_t *buffer);
+int ipc_send_buffer(uint32_t sender_pid, uint32_t receiver_pid,
+                    const mirix_ipc_buffer_t *buffer, uint32_t flags);
+int ipc_buffer_map(const void *ref, size_t ref_size, mirix_ipc_buffer_t *buffer);
+void ipc_buffer_release(mirix_ipc_buffer_t *buffer);
+
+// Release a receiver's mailbox index slot (its queued messages are dropped)
+int ipc_mailbox_release(uint32_t pid);
+
+void ipc_process_messages(void);
 
 #endif // MIRIX_IPC_H
@@ -0,0 +1,65 @@
+#ifndef MIRIX_IPC_FUTEX_H
+#define MIRIX_IPC_FUTEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// Wait/wake on a 32-bit word that may live in memory shared between
+// processes: IPC mailbox sequence words and the syscall ring doorbell and
+// completion tail, on both the kernel and the program side.
+
+#ifdef __APPLE__
+// Darwin's futex equivalent (used by libc++ as well)
+#define UL_COMPARE_AND_WAIT_SHARED 3
+#define ULF_WAKE_ALL 0x00000100
+extern int __ulock_wait(uint32_t operation, void *addr, uint64_t value, uint32_t timeout_us);
+extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
+#endif
+
+// Park until *word no longer holds expected or timeout_ms expires
+// (negative waits forever). Spurious returns are fine: callers re-check
+// whatever the word guards.
+static inline void ipc_futex_wait(uint32_t *word, uint32_t expected, int timeout_ms) {
+#if defined(__linux__)
+    struct timespec ts;
+    struct timespec *tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+    // Not FUTEX_PRIVATE: the word may live in a shared region
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, tsp, NULL, 0);
+#elif defined(__APPLE__)
+    uint32_t timeout_us = timeout_ms >= 0 ? (uint32_t)timeout_ms * 1000 : 0;
+    __ulock_wait(UL_COMPARE_AND_WAIT_SHARED, word, expected, timeout_us);
+#else
+    // No futex on this host; fall back to a short poll
+    (void)word;
+    (void)expected;
+    (void)timeout_ms;
+    usleep(1000);
+#endif
+}
+
+// Wake one waiter parked on word, or every waiter if all is set
+static inline void ipc_futex_wake(uint32_t *word, bool all) {
+#if defined(__linux__)
+    syscall(SYS_futex, word, FUTEX_WAKE, all ? INT_MAX : 1, NULL, NULL, 0);
+#elif defined(__APPLE__)
+    __ulock_wake(UL_COMPARE_AND_WAIT_SHARED | (all ? ULF_WAKE_ALL : 0), word, 0);
+#else
+    (void)word;
+    (void)all;
+#endif
+}
+
+#endif // MIRIX_IPC_FUTEX_H
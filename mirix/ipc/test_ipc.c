@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ipc.h"
+
+// IPC regression tests
+// Each test runs against a freshly formatted private region. Uses the
+// same semaphore name as the kernel, so do not run it while a kernel is up.
+
+#define TEST_ID_BASE 0x7e000000u
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+static void test_begin(const char *name) {
+    printf("%s\n", name);
+    ipc_system_init_mode(MIRIX_IPC_MODE_PRIVATE);
+}
+
+static void test_end(void) {
+    ipc_system_cleanup();
+}
+
+// Mailbox slots are reclaimed: far more distinct receivers than the
+// index holds, both with explicit release and with idle reclaim
+static void test_mailbox_reuse(void) {
+    const uint32_t receivers = MIRIX_IPC_MAX_MAILBOXES * 4;
+    uint32_t payload, received;
+    mirix_message_info_t info;
+
+    for (uint32_t i = 0; i < receivers; i++) {
+        uint32_t pid = TEST_ID_BASE + i;
+        payload = i;
+        TEST_CHECK(ipc_send_message(TEST_ID_BASE - 1, pid, &payload, sizeof(payload), 0) == 0,
+                   "send to receiver %u failed", i);
+        TEST_CHECK(ipc_receive_into(pid, &info, &received, sizeof(received), 0) == 0 && received == i,
+                   "receive for receiver %u failed", i);
+        if (i & 1) {
+            TEST_CHECK(ipc_mailbox_release(pid) == 0, "release of receiver %u failed", i);
+        }
+    }
+
+    // Releasing drops anything still queued for the exited receiver
+    payload = 1;
+    TEST_CHECK(ipc_send_message(TEST_ID_BASE - 1, TEST_ID_BASE, &payload, sizeof(payload), 0) == 0,
+               "send before release failed");
+    TEST_CHECK(ipc_mailbox_release(TEST_ID_BASE) == 0, "release with queued message failed");
+    TEST_CHECK(ipc_receive_into(TEST_ID_BASE, &info, &received, sizeof(received), 0) != 0,
+               "message survived release");
+}
+
+// Releasing a mailbox drops the segment reference of a queued shared
+// buffer, so the segment goes away with the sender's own reference
+static void test_buffer_release(void) {
+    const uint32_t receiver = TEST_ID_BASE;
+    mirix_ipc_buffer_t buffer;
+    TEST_CHECK(ipc_buffer_create(MIRIX_IPC_MAX_DATA_SIZE * 4, &buffer) == 0, "buffer not created");
+    char name[MIRIX_IPC_BUFFER_NAME_MAX];
+    memcpy(name, buffer.name, sizeof(name));
+
+    TEST_CHECK(ipc_send_buffer(TEST_ID_BASE - 1, receiver, &buffer, 0) == 0, "buffer send failed");
+    ipc_buffer_release(&buffer);
+    TEST_CHECK(ipc_mailbox_release(receiver) == 0, "release with queued buffer failed");
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd != -1) {
+        close(fd);
+        shm_unlink(name);
+    }
+    TEST_CHECK(fd == -1 && errno == ENOENT, "segment %s outlived its last reference", name);
+}
+
+// ipc_receive_from skips other senders without reordering them
+static void test_receive_from(void) {
+    const uint32_t self = TEST_ID_BASE, a = TEST_ID_BASE + 1, b = TEST_ID_BASE + 2;
+    uint32_t payload, received;
+    mirix_message_info_t info;
+
+    for (payload = 0; payload < 4; payload++) {
+        TEST_CHECK(ipc_send_message((payload & 1) ? b : a, self, &payload, sizeof(payload), 0) == 0,
+                   "send %u failed", payload);
+    }
+
+    TEST_CHECK(ipc_receive_from(self, b, &info, &received, sizeof(received), 0) == 0 &&
+               info.sender_pid == b && received == 1, "first message from b not picked out");
+    TEST_CHECK(ipc_receive_from(self, b, &info, &received, sizeof(received), 0) == 0 && received == 3,
+               "second message from b not picked out");
+    TEST_CHECK(ipc_receive_from(self, b, &info, &received, sizeof(received), 0) != 0,
+               "phantom message from b");
+    TEST_CHECK(ipc_receive_into(self, &info, &received, sizeof(received), 0) == 0 && received == 0,
+               "skipped message lost its place");
+    TEST_CHECK(ipc_receive_into(self, &info, &received, sizeof(received), 0) == 0 && received == 2,
+               "skipped messages reordered");
+}
+
+// Answers one ipc_call on TEST_ID_BASE + 1 with "fresh"
+static void *test_server_main(void *arg) {
+    const uint32_t self = TEST_ID_BASE + 1;
+    mirix_message_info_t info;
+    char request[16];
+    (void)arg;
+
+    if (ipc_reply_and_receive(self, NULL, NULL, 0, &info, request, sizeof(request), -1) == 0) {
+        ipc_reply_and_receive(self, &info, "fresh", 6, NULL, NULL, 0, 0);
+    }
+    return NULL;
+}
+
+// A reply to a call that timed out is not taken for the next call
+static void test_late_reply(void) {
+    const uint32_t caller = TEST_ID_BASE, server = TEST_ID_BASE + 1;
+    mirix_message_info_t info, request_info;
+    char reply[16];
+
+    TEST_CHECK(ipc_call(caller, server, "first", 6, NULL, reply, sizeof(reply), 10) != 0,
+               "call with no server did not time out");
+
+    // The server gets to the timed-out request only now
+    TEST_CHECK(ipc_reply_and_receive(server, NULL, NULL, 0, &request_info, reply, sizeof(reply), 0) == 0 &&
+               (request_info.flags & MIRIX_IPC_FLAG_CALL) && request_info.call_id != 0,
+               "request lost or missing its call id");
+    ipc_reply_and_receive(server, &request_info, "late", 5, NULL, NULL, 0, 0);
+
+    pthread_t thread;
+    TEST_CHECK(pthread_create(&thread, NULL, test_server_main, NULL) == 0, "server thread failed");
+    int result = ipc_call(caller, server, "second", 7, &info, reply, sizeof(reply), 1000);
+    pthread_join(thread, NULL);
+    TEST_CHECK(result == 0 && strcmp(reply, "fresh") == 0, "second call got '%s'", result == 0 ? reply : "");
+
+    // The late reply is still there for ordinary receives
+    TEST_CHECK(ipc_receive_into(caller, &info, reply, sizeof(reply), 0) == 0 &&
+               (info.flags & MIRIX_IPC_FLAG_REPLY) && strcmp(reply, "late") == 0,
+               "late reply not delivered as an ordinary message");
+}
+
+#define TEST_STREAM_MESSAGES 20000
+
+// Streams numbered messages to TEST_ID_BASE, from two senders
+static void *test_stream_main(void *arg) {
+    uint32_t sender = (uint32_t)(uintptr_t)arg;
+    for (uint32_t i = 0; i < TEST_STREAM_MESSAGES; ) {
+        if (ipc_send_message(sender, TEST_ID_BASE, &i, sizeof(i), 0) == 0) {
+            i++;
+        }
+    }
+    return NULL;
+}
+
+// A blocked receiver gets messages through the handoff slot and the
+// queue in turn; each sender's messages must still arrive in order
+static void test_stream_order(void) {
+    pthread_t threads[2];
+    uint32_t expected[2] = { 0, 0 };
+
+    for (uintptr_t i = 0; i < 2; i++) {
+        TEST_CHECK(pthread_create(&threads[i], NULL, test_stream_main, (void*)(TEST_ID_BASE + 1 + i)) == 0,
+                   "sender thread failed");
+    }
+
+    int misordered = 0;
+    for (int n = 0; n < 2 * TEST_STREAM_MESSAGES; n++) {
+        mirix_message_info_t info;
+        uint32_t value;
+        if (ipc_receive_into(TEST_ID_BASE, &info, &value, sizeof(value), 1000) != 0) {
+            break;
+        }
+        uint32_t *next = &expected[info.sender_pid - TEST_ID_BASE - 1];
+        misordered += value != *next;
+        *next = value + 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    TEST_CHECK(misordered == 0, "%d messages out of order", misordered);
+    TEST_CHECK(expected[0] == TEST_STREAM_MESSAGES && expected[1] == TEST_STREAM_MESSAGES,
+               "received %u and %u messages", expected[0], expected[1]);
+}
+
+// Queue payload_size messages to receiver until the arena is full
+static int test_fill(uint32_t receiver, size_t payload_size) {
+    static uint8_t payload[MIRIX_IPC_MAX_DATA_SIZE];
+    mirix_ipc_send_entry_t entry = { receiver, 0, payload, payload_size };
+    int queued = 0;
+    while (ipc_send_batch(TEST_ID_BASE - 1, &entry, 1) == 1) {
+        queued++;
+    }
+    return queued;
+}
+
+// Take everything queued for receiver
+static int test_drain(uint32_t receiver) {
+    static uint8_t buf[MIRIX_IPC_MAX_DATA_SIZE];
+    mirix_ipc_recv_entry_t entries[MIRIX_IPC_MAX_BATCH];
+    for (int i = 0; i < MIRIX_IPC_MAX_BATCH; i++) {
+        entries[i].buf = buf;
+        entries[i].buf_size = sizeof(buf);
+    }
+    int drained = 0, n;
+    while ((n = ipc_receive_batch(receiver, entries, MIRIX_IPC_MAX_BATCH, 0)) > 0) {
+        drained += n;
+    }
+    return drained;
+}
+
+// Space freed by one size class is usable by the others: a region filled
+// with small messages and drained used to refuse every larger one
+static void test_mixed_sizes(void) {
+    const uint32_t receiver = TEST_ID_BASE;
+    int small = test_fill(receiver, 16);
+    TEST_CHECK(small > 0 && test_drain(receiver) == small, "16-byte fill/drain failed");
+
+    int medium = test_fill(receiver, 256);
+    TEST_CHECK(medium >= small / 8, "only %d 256-byte messages fit after %d 16-byte ones", medium, small);
+    TEST_CHECK(test_drain(receiver) == medium, "256-byte drain failed");
+
+    int large = test_fill(receiver, MIRIX_IPC_MAX_DATA_SIZE);
+    TEST_CHECK(large >= small / 70, "only %d full-size messages fit", large);
+    TEST_CHECK(test_drain(receiver) == large, "full-size drain failed");
+
+    // And back: small messages get the whole arena again
+    int again = test_fill(receiver, 16);
+    TEST_CHECK(again >= small, "%d 16-byte messages fit on refill, %d at first", again, small);
+    TEST_CHECK(test_drain(receiver) == again, "16-byte drain failed");
+
+    // Interleaved sizes, partly drained as they go, must not leave the
+    // arena fragmented once everything is received
+    static uint8_t payload[MIRIX_IPC_MAX_DATA_SIZE];
+    uint8_t buf[MIRIX_IPC_MAX_DATA_SIZE];
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 5000; i++) {
+            mirix_ipc_send_entry_t entry = { receiver, 0, payload, (size_t)16 << (i % 9) };
+            if (ipc_send_batch(TEST_ID_BASE - 1, &entry, 1) != 1 || i % 3 == 0) {
+                ipc_receive_into(receiver, NULL, buf, sizeof(buf), 0);
+            }
+        }
+        test_drain(receiver);
+        int refill = test_fill(receiver, 256);
+        TEST_CHECK(refill >= medium, "round %d: %d 256-byte messages fit, %d before", round, refill, medium);
+        test_drain(receiver);
+    }
+}
+
+static uint32_t test_hook_pairs[8][2];
+static int test_hook_calls;
+
+static void test_traffic_hook(uint32_t sender_pid, uint32_t receiver_pid) {
+    if (test_hook_calls < 8) {
+        test_hook_pairs[test_hook_calls][0] = sender_pid;
+        test_hook_pairs[test_hook_calls][1] = receiver_pid;
+    }
+    test_hook_calls++;
+}
+
+// The traffic hook sees each receiver of a multicast, inline or shared
+static void test_multicast_hook(void) {
+    const uint32_t sender = TEST_ID_BASE;
+    const uint32_t receivers[3] = { TEST_ID_BASE + 1, TEST_ID_BASE + 2, TEST_ID_BASE + 3 };
+    static uint8_t payload[1024];
+
+    ipc_set_traffic_hook(test_traffic_hook);
+    for (int shared = 0; shared < 2; shared++) {
+        test_hook_calls = 0;
+        size_t size = shared ? sizeof(payload) : 8;
+        int queued = ipc_multicast(sender, receivers, 3, payload, size, 0);
+        TEST_CHECK(queued == 3, "multicast queued for %d receivers", queued);
+        TEST_CHECK(test_hook_calls == 3, "hook called %d times for 3 receivers", test_hook_calls);
+        for (int i = 0; i < 3; i++) {
+            TEST_CHECK(test_hook_pairs[i][0] == sender && test_hook_pairs[i][1] == receivers[i],
+                       "hook call %d saw %u -> %u", i, test_hook_pairs[i][0], test_hook_pairs[i][1]);
+        }
+    }
+    ipc_set_traffic_hook(NULL);
+}
+
+// Without a hook sends are sampled into the region and drained once
+static void test_traffic_drain(void) {
+    const uint32_t sender = TEST_ID_BASE;
+    const uint32_t receiver = TEST_ID_BASE + 1;
+    const int sends = MIRIX_IPC_TRAFFIC_SAMPLE * 4;
+
+    for (int i = 0; i < sends; i++) {
+        TEST_CHECK(ipc_send_message(sender, receiver, &i, sizeof(i), 0) == 0, "send %d failed", i);
+    }
+    test_hook_calls = 0;
+    int drained = ipc_drain_traffic(test_traffic_hook);
+    TEST_CHECK(drained == 4 && test_hook_calls == 4, "drained %d samples of %d sends", drained, sends);
+    for (int i = 0; i < 4; i++) {
+        TEST_CHECK(test_hook_pairs[i][0] == sender && test_hook_pairs[i][1] == receiver,
+                   "sample %d was %u -> %u", i, test_hook_pairs[i][0], test_hook_pairs[i][1]);
+    }
+    TEST_CHECK(ipc_drain_traffic(test_traffic_hook) == 0, "samples drained twice");
+    test_drain(receiver);
+}
+
+static volatile sig_atomic_t test_wakeups;
+
+static void test_wakeup_handler(int signo) {
+    (void)signo;
+    test_wakeups++;
+}
+
+// The sample that leaves MIRIX_IPC_TRAFFIC_WAKE undrained signals the
+// drainer once; after a drain the next one does again
+static void test_traffic_wakeup(void) {
+    const uint32_t sender = TEST_ID_BASE;
+    const uint32_t receiver = TEST_ID_BASE + 1;
+    const int sends = MIRIX_IPC_TRAFFIC_SAMPLE * MIRIX_IPC_TRAFFIC_WAKE;
+    int wakeups[3];
+
+    struct sigaction action, saved;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = test_wakeup_handler;
+    sigaction(SIGUSR1, &action, &saved);
+    test_wakeups = 0;
+
+    ipc_set_traffic_drainer(SIGUSR1);
+    for (int round = 0; round < 3; round++) {
+        if (round == 2) {
+            ipc_set_traffic_drainer(0);
+        }
+        // Twice the threshold without a drain still wakes only once
+        for (int i = 0; i < sends * 2; i++) {
+            ipc_send_message(sender, receiver, &i, sizeof(i), 0);
+        }
+        wakeups[round] = test_wakeups;
+        test_drain(receiver);
+        test_hook_calls = 0;
+        ipc_drain_traffic(test_traffic_hook);
+    }
+    sigaction(SIGUSR1, &saved, NULL);
+
+    TEST_CHECK(wakeups[0] == 1, "%d wakeups for the first %d samples", wakeups[0], MIRIX_IPC_TRAFFIC_WAKE * 2);
+    TEST_CHECK(wakeups[1] == 2, "%d wakeups after a drain", wakeups[1]);
+    TEST_CHECK(wakeups[2] == 2, "woken with no drainer registered");
+}
+
+int main(void) {
+    test_begin("mailbox reuse");
+    test_mailbox_reuse();
+    test_end();
+
+    test_begin("buffer release");
+    test_buffer_release();
+    test_end();
+
+    test_begin("selective receive");
+    test_receive_from();
+    test_end();
+
+    test_begin("mixed sizes");
+    test_mixed_sizes();
+    test_end();
+
+    test_begin("multicast traffic hook");
+    test_multicast_hook();
+    test_end();
+
+    test_begin("traffic drain");
+    test_traffic_drain();
+    test_end();
+
+    test_begin("traffic wakeup");
+    test_traffic_wakeup();
+    test_end();
+
+    test_begin("late reply");
+    test_late_reply();
+    test_end();
+
+    test_begin("stream order");
+    test_stream_order();
+    test_end();
+
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All IPC tests passed\n");
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
 #include <sys/wait.h>
 #include <sys/mman.h>
 #include <pthread.h>
@@ -10,10 +11,14 @@
 
 #include "kernel.h"
 #include "kernel_args.h"
+#include "scheduler.h"
+#include "uthread.h"
 #include "host/host_interface.h"
 #include "ipc/ipc.h"
 #include "syscall/syscall.h"
+#include "syscall/syscall_ring.h"
 #include "posix/posix.h"
+#include "posix/precise_sleep.h"
 #include "drivers/lazyfs.h"
 #include "modules/module.h"
 #include "modules/module.h"
@@ -49,6 +54,17 @@ static mirix_kernel_state_t kernel_state;
 // Store kernel arguments globally for userland access
 static mirix_kernel_args_t *kernel_args = NULL;
 
+// Programs raise this once enough IPC samples wait to be drained
+#define MIRIX_KERNEL_TRAFFIC_SIGNAL SIGUSR1
+
+// Program started from the main loop; its exit shuts the kernel down
+static struct {
+    pid_t pid;                 // -1 = none running
+    const char *label;
+    syscall_ring_t *ring;
+    bool reaper;               // SIGCHLD arrives through the host event loop
+} kernel_program = { .pid = -1 };
+
 // Kernel panic function
 void kernel_panic(const char *message) {
     printf("\n");
@@ -63,11 +79,30 @@ void kernel_panic(const char *message) {
     exit(0);
 }
 
+// Debug shell "json [PATH]" commands: dump statistics as JSON to PATH,
+// or to stdout when it is omitted
+static void kernel_debug_dump_json(const char *path, void (*dump)(FILE *out, bool json), const char *what) {
+    while (*path == ' ') {
+        path++;
+    }
+    FILE *out = *path ? fopen(path, "w") : stdout;
+    if (!out) {
+        printf("(debug)%% Cannot open %s\n", path);
+        return;
+    }
+
+    dump(out, true);
+    if (out != stdout) {
+        fclose(out);
+        printf("(debug)%% %s statistics written to %s\n", what, path);
+    }
+}
+
 // Debug shell implementation
 static void mirix_debug_shell(void) {
     printf("MIRIX Debug Shell\n");
     printf("(debug)%% Type 'exit' to return to kernel\n");
-    printf("(debug)%% Commands: help, mem, ps, fs, sys, kern, net, exit\n");
+    printf("(debug)%% Commands: help, mem, ps, fs, sys, kern, net, sched, syscalls, exit\n");
     
     char line[256];
     while (1) {
@@ -94,6 +129,10 @@ static void mirix_debug_shell(void) {
             printf("(debug)%%   sys     - Show system information\n");
             printf("(debug)%%   kern    - Show kernel state\n");
             printf("(debug)%%   net     - Show network status\n");
+            printf("(debug)%%   sched   - Show scheduler latency (sched json [FILE], sched reset,\n");
+            printf("(debug)%%             sched deadline PID RUNTIME DEADLINE PERIOD)\n");
+            printf("(debug)%%   syscalls - Show syscall counts and latency (syscalls json [FILE],\n");
+            printf("(debug)%%             syscalls reset)\n");
 #ifdef MACH_KERNEL_INTEGRATION
             printf("(debug)%%   mach    - Show Mach kernel statistics\n");
 #endif
@@ -121,7 +160,7 @@ static void mirix_debug_shell(void) {
             }
         } else if (strcmp(line, "sys") == 0) {
             printf("(debug)%% System information:\n");
-            printf("(debug)%%   Host interface: kqueue active\n");
+            printf("(debug)%%   Host interface: %s active\n", host_interface_backend_name());
             printf("(debug)%%   IPC system: Shared memory active\n");
             printf("(debug)%%   POSIX compliance: %s\n", sus_check_compliance() == 0 ? "SUSv3 Core" : "Incomplete");
             printf("(debug)%%   SUS version: %s\n", sus_version_string());
@@ -174,9 +213,41 @@ static void mirix_debug_shell(void) {
             printf("(debug)%%   Shared Memory: %s\n", sus_feature_test(_POSIX_SHARED_MEMORY_OBJECTS) == 200809L ? "YES" : "NO");
             printf("(debug)%%   Message Passing: %s\n", sus_feature_test(_POSIX_MESSAGE_PASSING) == 200112L ? "YES" : "NO");
             printf("(debug)%%   Timers: %s\n", sus_feature_test(_POSIX_TIMERS) == 200809L ? "YES" : "NO");
+        } else if (strcmp(line, "sched") == 0) {
+            printf("(debug)%% Scheduler statistics (%d vCPU%s):\n",
+                   scheduler_cpu_count(), scheduler_cpu_count() == 1 ? "" : "s");
+            scheduler_dump_stats(stdout, false);
+        } else if (strncmp(line, "sched json", 10) == 0 && (line[10] == '\0' || line[10] == ' ')) {
+            // One JSON object per vCPU and per process
+            kernel_debug_dump_json(line + 10, scheduler_dump_stats, "Scheduler");
+        } else if (strcmp(line, "sched reset") == 0) {
+            scheduler_reset_stats();
+            printf("(debug)%% Scheduler statistics reset\n");
+        } else if (strncmp(line, "sched deadline ", 15) == 0) {
+            // Times in microseconds; runtime 0 returns the process to its group
+            unsigned int pid;
+            unsigned long long runtime, deadline, period;
+            if (sscanf(line + 15, "%u %llu %llu %llu", &pid, &runtime, &deadline, &period) != 4) {
+                printf("(debug)%% Usage: sched deadline PID RUNTIME DEADLINE PERIOD (us)\n");
+            } else if (scheduler_set_deadline(pid, runtime, deadline, period) != 0) {
+                printf("(debug)%% PID %u not admitted\n", pid);
+            } else {
+                printf("(debug)%% PID %u: %llu us every %llu us, deadline %llu us\n", pid, runtime, period,
+                       deadline ? deadline : period);
+            }
+        } else if (strcmp(line, "syscalls") == 0) {
+            printf("(debug)%% Syscall statistics (%d vCPU%s):\n",
+                   scheduler_cpu_count(), scheduler_cpu_count() == 1 ? "" : "s");
+            syscall_dump_stats(stdout, false);
+        } else if (strncmp(line, "syscalls json", 13) == 0 && (line[13] == '\0' || line[13] == ' ')) {
+            // One JSON object per syscall and vCPU
+            kernel_debug_dump_json(line + 13, syscall_dump_stats, "Syscall");
+        } else if (strcmp(line, "syscalls reset") == 0) {
+            syscall_reset_stats();
+            printf("(debug)%% Syscall statistics reset\n");
         } else if (strcmp(line, "net") == 0) {
             printf("(debug)%% Network status:\n");
-            printf("(debug)%%   Host interface: kqueue active\n");
+            printf("(debug)%%   Host interface: %s active\n", host_interface_backend_name());
             printf("(debug)%%   IPC system: Shared memory active\n");
             printf("(debug)%%   No network interfaces configured\n");
         } else if (strlen(line) > 0) {
@@ -186,38 +257,165 @@ static void mirix_debug_shell(void) {
     }
 }
 
-static int kernel_launch_binary(const char *path, char *const argv[]) {
+static int kernel_launch_binary(const char *path, bool aout, char *const argv[], char *const envp[]) {
     if (!path) {
         errno = EINVAL;
         return -1;
     }
 
+    if (aout) {
+        return mirix_aout_launch(path, argv, envp);
+    }
+
+    return execve(path, argv, envp);
+}
+
+// Environment for a launched program: the kernel's own, with the syscall
+// ring named in ring_env (NULL = no ring). Built before fork, because the
+// child of a threaded process must not allocate.
+static char **kernel_program_environ(char *ring_env) {
+    extern char **environ;
+    size_t count = 0;
+    while (environ[count]) {
+        count++;
+    }
+
+    char **envp = malloc((count + 2) * sizeof(char *));
+    if (!envp) {
+        return NULL;
+    }
+
+    size_t prefix = strlen(MIRIX_SYSRING_ENV);
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (ring_env && strncmp(environ[i], MIRIX_SYSRING_ENV, prefix) == 0 && environ[i][prefix] == '=') {
+            continue;
+        }
+        envp[n++] = environ[i];
+    }
+    if (ring_env) {
+        envp[n++] = ring_env;
+    }
+    envp[n] = NULL;
+    return envp;
+}
+
+// The launched program is gone: drop what the kernel kept for it and
+// leave the main loop
+static void kernel_program_exited(int status) {
+    uint32_t pid = (uint32_t)kernel_program.pid;
+    kernel_program.pid = -1;
+    syscall_ring_destroy(kernel_program.ring);
+    kernel_program.ring = NULL;
+    scheduler_remove_process(pid);
+    ipc_mailbox_release(pid);
+
+    printf("%s program exited with status: %d\n", kernel_program.label, status);
+    printf("Init program terminated, shutting down kernel...\n");
+    kernel_state.status = MIRIX_KERNEL_SHUTTING_DOWN;
+    host_interface_wakeup();
+}
+
+// Enter a launched program in the process table, so its IPC traffic and
+// timeshare membership (by file name) reach the scheduler. It runs on the
+// host; without green threads its first dispatch parks it.
+static void kernel_register_program(pid_t pid, const char *path) {
+    mirix_process_t process;
+    memset(&process, 0, sizeof(process));
+    process.pid = (uint32_t)pid;
+    process.ppid = (uint32_t)getpid();
+    const char *name = strrchr(path, '/');
+    snprintf(process.name, sizeof(process.name), "%s", name ? name + 1 : path);
+    process.status = MIRIX_KERNEL_RUNNING;
+    process.priority = MIRIX_SCHED_DEFAULT_PRIORITY;
+    scheduler_add_process(&process);
+}
+
+// Programs send from their own address space, where the scheduler hook
+// is not installed; take their sampled traffic from the IPC region when
+// a sender signals that it is filling up
+static void kernel_drain_ipc_traffic(int signo, void *data) {
+    (void)signo;
+    (void)data;
+    ipc_drain_traffic(scheduler_note_ipc_sample);
+}
+
+// SIGCHLD from the host event loop. Only the launched program is reaped;
+// other children belong to whoever forked them.
+static void kernel_reap_program(int signo, void *data) {
+    (void)signo;
+    (void)data;
+
+    int status = 0;
+    if (kernel_program.pid > 0 && waitpid(kernel_program.pid, &status, WNOHANG) != 0) {
+        kernel_program_exited(status);
+    }
+}
+
+// Fork and exec a program without waiting for it. With the SIGCHLD
+// monitor in place the main loop runs while it does; otherwise this
+// falls back to waiting here.
+static void kernel_start_program(const char *label, const char *path) {
+    // Syscall rings are optional; the program falls back to direct calls
+    syscall_ring_t *ring = syscall_ring_create();
+    char ring_env[sizeof(MIRIX_SYSRING_ENV) + MIRIX_SYSRING_NAME_MAX + 1];
+    if (ring) {
+        snprintf(ring_env, sizeof(ring_env), "%s=%s", MIRIX_SYSRING_ENV, syscall_ring_name(ring));
+    }
+    char **envp = kernel_program_environ(ring ? ring_env : NULL);
+    if (!envp) {
+        syscall_ring_destroy(ring);
+        kernel_panic("Failed to build program environment");
+        return;
+    }
+
     mirix_aout_info_t info;
-    if (mirix_aout_probe(path, &info)) {
+    bool aout = mirix_aout_probe(path, &info);
+    if (aout) {
         printf("[a.out] %s text=%u data=%u bss=%u entry=0x%08x\n",
                path, info.text_size, info.data_size, info.bss_size,
                info.entry_point);
-        return mirix_aout_launch(path, argv);
     }
+    fflush(NULL);
 
-    return execv(path, argv);
-}
-
-static void kernel_run_program_and_wait(const char *label, const char *path) {
     pid_t pid = fork();
     if (pid == 0) {
+        // The kernel takes SIGCHLD and the traffic signal through its
+        // event loop (blocked or ignored); the program gets the defaults back
+        sigset_t monitored;
+        sigemptyset(&monitored);
+        sigaddset(&monitored, SIGCHLD);
+        sigaddset(&monitored, MIRIX_KERNEL_TRAFFIC_SIGNAL);
+        signal(SIGCHLD, SIG_DFL);
+        signal(MIRIX_KERNEL_TRAFFIC_SIGNAL, SIG_DFL);
+        sigprocmask(SIG_UNBLOCK, &monitored, NULL);
+
+        // Only async-signal-safe calls until exec: other kernel threads
+        // may have held the allocator or stdio locks at fork time
         char *child_args[] = {(char *)path, NULL};
-        kernel_launch_binary(path, child_args);
-        perror("kernel exec");
-        kernel_panic("Failed to execute binary");
+        kernel_launch_binary(path, aout, child_args, envp);
+        static const char exec_failed[] = "kernel exec: failed to execute binary\n";
+        ssize_t written = write(STDERR_FILENO, exec_failed, sizeof(exec_failed) - 1);
+        (void)written;
         _exit(127);
-    } else if (pid > 0) {
-        int status;
-        waitpid(pid, &status, 0);
-        printf("%s program exited with status: %d\n", label, status);
-        printf("Init program terminated, shutting down kernel...\n");
-        kernel_state.status = MIRIX_KERNEL_SHUTTING_DOWN;
+    }
+
+    free(envp);
+    if (pid > 0) {
+        kernel_program.pid = pid;
+        kernel_program.label = label;
+        kernel_program.ring = ring;
+        kernel_register_program(pid, path);
+        if (ring) {
+            syscall_ring_start(ring, (uint32_t)pid);
+        }
+        if (!kernel_program.reaper) {
+            int status;
+            waitpid(pid, &status, 0);
+            kernel_program_exited(status);
+        }
     } else {
+        syscall_ring_destroy(ring);
         kernel_panic("Failed to fork for init program");
     }
 }
@@ -245,7 +443,7 @@ static void execute_init_program(void) {
     }
 
     printf("Executing %s program: %s\n", label, program);
-    kernel_run_program_and_wait(label, program);
+    kernel_start_program(label, program);
 }
 
 // Main kernel entry point (legacy)
@@ -263,6 +461,12 @@ int mirix_kernel_main(int argc, char **argv) {
 
 // Main kernel entry point with arguments
 int mirix_kernel_main_with_args(mirix_kernel_args_t *args) {
+    // Everything below reads its configuration from args
+    if (!args) {
+        kernel_panic("[err] No kernel arguments");
+        return -1;
+    }
+    
     // Store kernel arguments globally
     kernel_args = args;
     
@@ -299,13 +503,28 @@ int mirix_kernel_main_with_args(mirix_kernel_args_t *args) {
     printf("[i] Mach userspace services ready\n");
 #endif
     
+    if (args->host_backend && host_interface_set_backend(args->host_backend) != 0) {
+        kernel_panic("[err] Host backend not available");
+        free_kernel_args(args);
+        return -1;
+    }
+    if (args->host_batch) {
+        host_interface_set_poll_batch(args->host_batch);
+    }
     if (host_interface_init() != 0) {
         kernel_panic("[err] Failed to initialize host interface");
         free_kernel_args(args);
         return -1;
     }
     
-    if (ipc_system_init() != 0) {
+    // Launched programs are reaped from the event loop. SIGCHLD gets
+    // blocked here, before any other thread exists to inherit an open mask.
+    kernel_program.reaper = host_interface_monitor_signal(SIGCHLD, kernel_reap_program, NULL) == 0;
+    bool traffic_wakeup = host_interface_monitor_signal(MIRIX_KERNEL_TRAFFIC_SIGNAL,
+                                                        kernel_drain_ipc_traffic, NULL) == 0;
+    
+    // Shared mode so programs started by the kernel can exchange messages
+    if (ipc_system_init_mode(MIRIX_IPC_MODE_SHARED) != 0) {
         kernel_panic("[err] Failed to initialize IPC system");
         free_kernel_args(args);
         return -1;
@@ -316,7 +535,50 @@ int mirix_kernel_main_with_args(mirix_kernel_args_t *args) {
         free_kernel_args(args);
         return -1;
     }
+    syscall_ring_set_poll((uint32_t)args->syscall_poll_us);
+    
+    // One run queue and vCPU thread per --mcpu
+    if (scheduler_init_cpus(args->cpu_count) != 0) {
+        kernel_panic("[err] Failed to initialize scheduler");
+        free_kernel_args(args);
+        return -1;
+    }
+    
+    // Pin vCPUs to host cores by cache and socket topology
+    if (args->pin_cpus) {
+        arch_topology_t *topology = malloc(sizeof(arch_topology_t));
+        if (topology && arch_runtime_get_topology(topology) == 0) {
+            scheduler_set_topology(topology);
+        }
+        free(topology);
+    }
+    ipc_set_traffic_hook(scheduler_note_ipc);
+    if (traffic_wakeup) {
+        ipc_set_traffic_drainer(MIRIX_KERNEL_TRAFFIC_SIGNAL);
+    }
+    
+    // Fair-share groups before any process is scheduled
+    if (args->timeshare_file && scheduler_load_timeshare(args->timeshare_file) != 0) {
+        kernel_panic("[err] Failed to load timeshare configuration");
+        free_kernel_args(args);
+        return -1;
+    }
     
+    // Green threads run on the vCPUs through the dispatch hook
+    if (uthread_runtime_init() != 0) {
+        kernel_panic("[err] Failed to initialize green-thread runtime");
+        free_kernel_args(args);
+        return -1;
+    }
+    
+    if (scheduler_start() != 0) {
+        kernel_panic("[err] Failed to start scheduler");
+        free_kernel_args(args);
+        return -1;
+    }
+    
+    // Spinning sleeps cost a host core each, so only on request
+    precise_sleep_set_enabled(args->precise_sleep);
     if (posix_init() != 0) {
         kernel_panic("[err] Failed to initialize POSIX compatibility layer");
         free_kernel_args(args);
@@ -333,7 +595,7 @@ int mirix_kernel_main_with_args(mirix_kernel_args_t *args) {
     bsd_proc_init();
     
     // Check for root filesystem
-    if (args && args->root_filesystem) {
+    if (args->root_filesystem) {
         printf("Mounting root filesystem: %s\n", args->root_filesystem);
         
         // Check if root filesystem directory exists
@@ -401,11 +663,14 @@ int mirix_kernel_main_with_args(mirix_kernel_args_t *args) {
     kernel_state.status = MIRIX_KERNEL_RUNNING;
     printf("MIRIX kernel ready\n");
     
-    if (args && args->verbose) {
+    if (args->verbose) {
         printf("Configuration: %d CPUs, %zu MB memory\n", 
                args->cpu_count, args->alloc_size / (1024 * 1024));
     }
     
+    // The host event loop runs on a spare core next to the vCPUs
+    scheduler_pin_service_thread();
+    
     // Main kernel loop
     kernel_main_loop();
     
@@ -431,7 +696,6 @@ static void kernel_main_loop(void) {
             if (stat(entry_program, &st) == 0) {
                 printf("Starting %s: %s\n", entry_label, entry_program);
                 execute_init_program();
-                return;
             } else {
                 printf("%s not found: %s\n", entry_label, entry_program);
                 printf("Falling back to debug shell...\n");
@@ -449,36 +713,19 @@ static void kernel_main_loop(void) {
         return;
     }
     
-    // Main kernel event loop (only reached if init program is running)
+    // Main kernel event loop while the program runs (its exit ends it).
+    // Tickless: sleep in the host backend until I/O, a timer, SIGCHLD or
+    // a wakeup; processes are scheduled on the vCPU threads.
     while (kernel_state.status == MIRIX_KERNEL_RUNNING) {
-        // Handle events
-        host_interface_poll_events();
-        
-        // Schedule processes
-        scheduler_tick();
-        
-        // Small delay to prevent CPU spinning
-        usleep(10000); // 10ms
+        if (host_interface_poll_events(-1) < 0) {
+            break;
+        }
     }
 }
 
-// System call handler - dispatches to appropriate handlers
+// System call handler - dispatches through the syscall table
 int mirix_syscall_handler(int syscall_num, void *args) {
-    switch (syscall_num) {
-        case MIRIX_SYSCALL_EXIT:
-            return syscall_exit((int)(long)args);
-        case MIRIX_SYSCALL_WRITE:
-            return syscall_write((mirix_write_args_t*)args);
-        case MIRIX_SYSCALL_READ:
-            return syscall_read((mirix_read_args_t*)args);
-        case MIRIX_SYSCALL_IPC_SEND:
-            return syscall_ipc_send((mirix_ipc_args_t*)args);
-        case MIRIX_SYSCALL_IPC_RECV:
-            return syscall_ipc_recv((mirix_ipc_args_t*)args);
-        default:
-            fprintf(stderr, "Unknown syscall: %d\n", syscall_num);
-            return -1;
-    }
+    return syscall_dispatch(syscall_num, args);
 }
 
 // Get kernel state
@@ -508,6 +755,11 @@ void mirix_kernel_shutdown(void) {
     lazyfs_cleanup();
     posix_cleanup();
     syscall_cleanup();
+    ipc_set_traffic_hook(NULL);
+    ipc_set_traffic_drainer(0);
+    scheduler_stop();
+    uthread_runtime_cleanup();
+    scheduler_cleanup();
     ipc_system_cleanup();
     host_interface_cleanup();
     shutdown_kernel_modules();
@@ -34,19 +34,32 @@ typedef struct {
     size_t memory_size;
 } mirix_kernel_state_t;
 
+// System call list: number, name and argument structure. The enum below
+// and the dispatch table in syscall/syscall.c are generated from it.
+// EXIT has no structure: its status travels in the argument pointer
+// itself, (void *)(long)status, as it always has.
+#define MIRIX_SYSCALLS(X) \
+    X(1,  EXIT,             exit,             void) \
+    X(2,  WRITE,            write,            mirix_write_args_t) \
+    X(3,  READ,             read,             mirix_read_args_t) \
+    X(4,  IPC_SEND,         ipc_send,         mirix_ipc_args_t) \
+    X(5,  IPC_RECV,         ipc_recv,         mirix_ipc_args_t) \
+    X(6,  FORK,             fork,             void) \
+    X(7,  EXEC,             exec,             mirix_exec_args_t) \
+    X(8,  WAIT,             wait,             mirix_wait_args_t) \
+    X(9,  TIMER_CREATE,     timer_create,     mirix_timer_t) \
+    X(10, TIMER_DELETE,     timer_delete,     mirix_timer_t) \
+    X(11, IPC_RECV_TIMEOUT, ipc_recv_timeout, mirix_ipc_args_t) \
+    X(12, IPC_SEND_BATCH,   ipc_send_batch,   mirix_ipc_batch_args_t) \
+    X(13, IPC_RECV_BATCH,   ipc_recv_batch,   mirix_ipc_batch_args_t)
+
 // System call numbers
+#define MIRIX_SYSCALL_ENUM(num, NAME, name, args) MIRIX_SYSCALL_##NAME = num,
 typedef enum {
-    MIRIX_SYSCALL_EXIT = 1,
-    MIRIX_SYSCALL_WRITE = 2,
-    MIRIX_SYSCALL_READ = 3,
-    MIRIX_SYSCALL_IPC_SEND = 4,
-    MIRIX_SYSCALL_IPC_RECV = 5,
-    MIRIX_SYSCALL_FORK = 6,
-    MIRIX_SYSCALL_EXEC = 7,
-    MIRIX_SYSCALL_WAIT = 8,
-    MIRIX_SYSCALL_TIMER_CREATE = 9,
-    MIRIX_SYSCALL_TIMER_DELETE = 10
+    MIRIX_SYSCALLS(MIRIX_SYSCALL_ENUM)
+    MIRIX_SYSCALL_MAX             // One past the highest number
 } mirix_syscall_t;
+#undef MIRIX_SYSCALL_ENUM
 
 // System call argument structures
 typedef struct {
@@ -66,8 +79,24 @@ typedef struct {
     const void *msg;
     size_t msg_size;
     int flags;
+    int timeout_ms;     // IPC_RECV_TIMEOUT only: 0 = poll, negative = forever
 } mirix_ipc_args_t;
 
+typedef struct {
+    const char *path;
+    char *const *argv;
+} mirix_exec_args_t;
+
+typedef struct {
+    int status;         // Filled in on return
+} mirix_wait_args_t;
+
+typedef struct {
+    void *entries;      // mirix_ipc_send_entry_t[] or mirix_ipc_recv_entry_t[]
+    size_t count;
+    int timeout_ms;     // IPC_RECV_BATCH only: wait for the first message
+} mirix_ipc_batch_args_t;
+
 // Timer structure
 typedef struct {
     uint32_t timer_id;
@@ -87,6 +116,8 @@ typedef struct {
     void *stack_base;
     size_t stack_size;
     uint64_t runtime_ticks;
+    int priority;           // 0 = highest, MIRIX_SCHED_PRIORITIES - 1 = lowest
+    void *user_threads;     // Green-thread run queue (uthread.c), NULL until the first one
 } mirix_process_t;
 
 // Kernel API functions
@@ -17,6 +17,11 @@ static mirix_kernel_args_t default_args = {
     .lazyfs_backing_file = "./lazyfs.img", // New default
     .verbose = false,
     .cpu_count = 1,
+    .pin_cpus = true,
+    .host_backend = NULL,
+    .host_batch = 0,
+    .syscall_poll_us = 0,
+    .precise_sleep = false,
     .help = false
 };
 
@@ -33,6 +38,11 @@ static void print_usage(const char *program_name) {
     printf("  -f, --lazyfs-file FILE LazyFS backing file (default: %s)\n", default_args.lazyfs_backing_file);
     printf("  -v, --verbose           Enable verbose output\n");
     printf("  -m, --mcpu COUNT       Number of CPUs (default: %d)\n", default_args.cpu_count);
+    printf("      --no-pin           Leave vCPU threads unpinned (default: pin by host topology)\n");
+    printf("      --host-backend NAME Host event backend: epoll, io_uring, kqueue or poll (default: best available)\n");
+    printf("      --host-batch COUNT Host events handled per wait, 1-4096 (default: 64)\n");
+    printf("      --syscall-poll USEC Syscall ring threads poll this long before sleeping (default: 0, doorbell only)\n");
+    printf("      --precise-sleep    Spin out host wakeup slack on sleeps under 10 ms (default: off)\n");
     printf("  -h, --help             Show this help message\n\n");
 }
 
@@ -103,6 +113,11 @@ mirix_kernel_args_t* parse_kernel_args(int argc, char *argv[]) {
         {"command",    required_argument, 0, 'C'},
         {"verbose",    no_argument,       0, 'v'},
         {"mcpu",      required_argument, 0, 'm'},
+        {"no-pin",     no_argument,       0, 'P'},
+        {"host-backend", required_argument, 0, 'B'},
+        {"host-batch", required_argument, 0, 'E'},
+        {"syscall-poll", required_argument, 0, 'S'},
+        {"precise-sleep", no_argument,    0, 'Z'},
         {"help",       no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
@@ -149,6 +164,36 @@ mirix_kernel_args_t* parse_kernel_args(int argc, char *argv[]) {
                 }
                 break;
                 
+            case 'P':
+                args->pin_cpus = false;
+                break;
+
+            case 'B':
+                args->host_backend = strdup(optarg);
+                break;
+
+            case 'E':
+                args->host_batch = atoi(optarg);
+                if (args->host_batch < 1 || args->host_batch > 4096) {
+                    printf("Error: Invalid host batch '%s', must be 1-4096\n", optarg);
+                    free(args);
+                    return NULL;
+                }
+                break;
+
+            case 'S':
+                args->syscall_poll_us = atoi(optarg);
+                if (args->syscall_poll_us < 0 || args->syscall_poll_us > 1000000) {
+                    printf("Error: Invalid syscall poll '%s', must be 0-1000000\n", optarg);
+                    free(args);
+                    return NULL;
+                }
+                break;
+
+            case 'Z':
+                args->precise_sleep = true;
+                break;
+                
             case 'h':
                 args->help = true;
                 print_usage(argv[0]);
@@ -205,6 +250,17 @@ void print_kernel_args(const mirix_kernel_args_t *args) {
     
     printf("Verbose mode:      %s\n", args->verbose ? "YES" : "NO");
     printf("CPU count:         %d\n", args->cpu_count);
+    printf("CPU pinning:       %s\n", args->pin_cpus ? "YES" : "NO");
+    if (args->host_backend) {
+        printf("Host backend:      %s\n", args->host_backend);
+    }
+    if (args->host_batch) {
+        printf("Host batch:        %d\n", args->host_batch);
+    }
+    if (args->syscall_poll_us) {
+        printf("Syscall poll:      %d us\n", args->syscall_poll_us);
+    }
+    printf("Precise sleep:     %s\n", args->precise_sleep ? "YES" : "NO");
     printf("\n");
 }
 
@@ -222,6 +278,9 @@ void free_kernel_args(mirix_kernel_args_t *args) {
     if (args->command_program) {
         free(args->command_program);
     }
+    if (args->host_backend) {
+        free(args->host_backend);
+    }
     if (args->root_filesystem && args->root_filesystem != default_args.root_filesystem) {
         free(args->root_filesystem);
     }
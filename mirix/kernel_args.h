@@ -15,6 +15,11 @@ typedef struct mirix_kernel_args {
     char *lazyfs_backing_file; // Path to the lazyfs backing file
     bool verbose;             // Verbose output
     int cpu_count;            // Number of CPUs
+    bool pin_cpus;            // Pin vCPU threads to host cores by topology
+    char *host_backend;       // Host event backend (NULL = best available)
+    int host_batch;           // Host events handled per wait (0 = default)
+    int syscall_poll_us;      // Syscall ring polling window (0 = doorbell only)
+    bool precise_sleep;       // Spin out the host wakeup slack of short sleeps
     bool help;                // Show help
 } mirix_kernel_args_t;
 
@@ -8,40 +8,15 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "libsyscall.h"
+#include "../syscall/syscall_ring.h"
 
 // System call library for MIRIX
 // Provides low-level system call interface
 
-// System call numbers for MIRIX
-typedef enum {
-    MIRIX_SYSCALL_READ = 0,
-    MIRIX_SYSCALL_WRITE = 1,
-    MIRIX_SYSCALL_OPEN = 2,
-    MIRIX_SYSCALL_CLOSE = 3,
-    MIRIX_SYSCALL_FORK = 4,
-    MIRIX_SYSCALL_EXEC = 5,
-    MIRIX_SYSCALL_WAIT = 6,
-    MIRIX_SYSCALL_EXIT = 7,
-    MIRIX_SYSCALL_KILL = 8,
-    MIRIX_SYSCALL_MMAP = 9,
-    MIRIX_SYSCALL_MUNMAP = 10,
-    MIRIX_SYSCALL_BRK = 11,
-    MIRIX_SYSCALL_IOCTL = 12,
-    MIRIX_SYSCALL_SOCKET = 13,
-    MIRIX_SYSCALL_BIND = 14,
-    MIRIX_SYSCALL_LISTEN = 15,
-    MIRIX_SYSCALL_ACCEPT = 16,
-    MIRIX_SYSCALL_CONNECT = 17,
-    MIRIX_SYSCALL_SEND = 18,
-    MIRIX_SYSCALL_RECV = 19,
-    MIRIX_SYSCALL_IPC_SEND = 20,
-    MIRIX_SYSCALL_IPC_RECV = 21,
-    MIRIX_SYSCALL_TIMER_CREATE = 22,
-    MIRIX_SYSCALL_TIMER_DELETE = 23
-} mirix_syscall_num_t;
-
 // System call wrapper functions
 ssize_t mirix_sys_read(int fd, void *buf, size_t count) {
     printf("mirix_sys_read: fd=%d, buf=%p, count=%zu\n", fd, buf, count);
@@ -208,38 +183,187 @@ int mirix_sys_ipc_send(uint32_t target_pid, const void *msg, size_t msg_size, in
     printf("mirix_sys_ipc_send: target_pid=%u, msg=%p, msg_size=%zu, flags=0x%x\n",
            target_pid, msg, msg_size, flags);
     
-    // This would interface with the IPC system
-    // For now, return success
-    printf("mirix_sys_ipc_send: success\n");
-    return 0;
+    // Reach the kernel's shared IPC region (no-op inside the kernel)
+    if (ipc_system_attach() != 0) {
+        printf("mirix_sys_ipc_send: IPC region unavailable\n");
+        return -1;
+    }
+    
+    int result = ipc_send_message(getpid(), target_pid, msg, msg_size, flags);
+    if (result == -1) {
+        printf("mirix_sys_ipc_send: failed\n");
+    } else {
+        printf("mirix_sys_ipc_send: success\n");
+    }
+    
+    return result;
 }
 
+// Poll for a message: sender_pid 0 takes the next one from anyone,
+// otherwise only a message from that pid (others stay queued). *msg_size
+// is the buffer size on entry and the bytes copied on return.
 int mirix_sys_ipc_recv(uint32_t sender_pid, void *msg, size_t *msg_size, int flags) {
-    printf("mirix_sys_ipc_recv: sender_pid=%u, msg=%p, msg_size=%p, flags=0x%x\n",
-           sender_pid, msg, msg_size, flags);
+    (void)flags;
+    
+    if (!msg_size || (!msg && *msg_size > 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+    
+    if (ipc_system_attach() != 0) {
+        return -1;
+    }
+    
+    // Straight from the queue record into the caller's buffer
+    mirix_message_info_t info;
+    int result = sender_pid != 0
+        ? ipc_receive_from(getpid(), sender_pid, &info, msg, *msg_size, 0)
+        : ipc_receive_into(getpid(), &info, msg, *msg_size, 0);
+    if (result != 0) {
+        return -1;
+    }
+    
+    if (info.data_size < *msg_size) {
+        *msg_size = info.data_size;
+    }
+    return 0;
+}
+
+// Batched IPC: no per-message logging, one lock round per call
+int mirix_sys_ipc_send_batch(const mirix_ipc_send_entry_t *entries, size_t count) {
+    if (!entries || ipc_system_attach() != 0) {
+        return -1;
+    }
     
-    // This would interface with the IPC system
-    // For now, return no message
-    printf("mirix_sys_ipc_recv: no message available\n");
+    return ipc_send_batch(getpid(), entries, count);
+}
+
+int mirix_sys_ipc_recv_batch(mirix_ipc_recv_entry_t *entries, size_t count, int timeout_ms) {
+    if (!entries || ipc_system_attach() != 0) {
+        return -1;
+    }
+    
+    return ipc_receive_batch(getpid(), entries, count, timeout_ms);
+}
+
+// Timer system calls. Timers have no direct path: they are created in
+// the kernel through the program's syscall ring, and expiries come back
+// as completions. Expiries reaped while waiting for a call's result are
+// queued for mirix_sys_timer_wait.
+#define LIBSYSCALL_PENDING_TIMERS 64
+
+static struct {
+    pthread_mutex_t lock;          // The ring takes one submitter and one reaper
+    uint64_t next_user_data;
+    int pending[LIBSYSCALL_PENDING_TIMERS]; // Expired timer ids, oldest first
+    unsigned pending_head;
+    unsigned pending_count;
+} libsyscall_ring = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Take one completion off the ring (caller holds the lock). Returns true
+// with *cqe filled, false on timeout.
+static bool libsyscall_ring_reap(mirix_sysring_cqe_t *cqe, int timeout_ms) {
+    mirix_sysring_cqe_t *next = syscall_ring_wait_cqe(timeout_ms);
+    if (!next) {
+        return false;
+    }
+    *cqe = *next;
+    syscall_ring_cqe_seen();
+    return true;
+}
+
+static void libsyscall_timer_expired(int timer_id) {
+    if (libsyscall_ring.pending_count == LIBSYSCALL_PENDING_TIMERS) {
+        return; // Nobody is waiting; drop it like a full completion queue would
+    }
+    unsigned slot = (libsyscall_ring.pending_head + libsyscall_ring.pending_count) % LIBSYSCALL_PENDING_TIMERS;
+    libsyscall_ring.pending[slot] = timer_id;
+    libsyscall_ring.pending_count++;
+}
+
+// Submit one request and wait for its result
+static int libsyscall_ring_call(const mirix_sysring_sqe_t *request) {
+    pthread_mutex_lock(&libsyscall_ring.lock);
+    mirix_sysring_sqe_t *sqe = syscall_ring_attach() == 0 ? syscall_ring_get_sqe() : NULL;
+    if (!sqe) {
+        pthread_mutex_unlock(&libsyscall_ring.lock);
+        errno = getenv(MIRIX_SYSRING_ENV) ? EAGAIN : ENOSYS;
+        return -1;
+    }
+    *sqe = *request;
+    sqe->user_data = ++libsyscall_ring.next_user_data;
+    uint64_t user_data = sqe->user_data;
+    syscall_ring_submit();
+
+    mirix_sysring_cqe_t cqe;
+    while (libsyscall_ring_reap(&cqe, -1)) {
+        if (cqe.flags & MIRIX_SYSRING_CQE_TIMER) {
+            libsyscall_timer_expired(cqe.res);
+        } else if (cqe.user_data == user_data) {
+            pthread_mutex_unlock(&libsyscall_ring.lock);
+            if (cqe.res < 0) {
+                errno = cqe.error;
+            }
+            return cqe.res;
+        }
+    }
+    pthread_mutex_unlock(&libsyscall_ring.lock);
+    errno = EIO;
     return -1;
 }
 
-// Timer system calls
 int mirix_sys_timer_create(uint64_t interval_ms, int flags) {
-    printf("mirix_sys_timer_create: interval_ms=%llu, flags=0x%x\n",
-           (unsigned long long)interval_ms, flags);
-    
-    // This would interface with the timer system
-    // For now, return a fake timer ID
-    printf("mirix_sys_timer_create: success, timer_id=1\n");
-    return 1;
+    mirix_sysring_sqe_t sqe = {
+        .opcode = MIRIX_SYSCALL_TIMER_CREATE,
+        .flags = (uint32_t)flags & MIRIX_SYSRING_TIMER_PERIODIC,
+        .arg = (int64_t)interval_ms
+    };
+    return libsyscall_ring_call(&sqe);
 }
 
 int mirix_sys_timer_delete(int timer_id) {
-    printf("mirix_sys_timer_delete: timer_id=%d\n", timer_id);
-    
-    // This would interface with the timer system
-    // For now, return success
-    printf("mirix_sys_timer_delete: success\n");
-    return 0;
+    mirix_sysring_sqe_t sqe = {
+        .opcode = MIRIX_SYSCALL_TIMER_DELETE,
+        .arg = timer_id
+    };
+    return libsyscall_ring_call(&sqe) < 0 ? -1 : 0;
+}
+
+// Wait for a timer to expire (negative timeout waits forever); returns
+// its id, or -1 with errno ETIMEDOUT
+int mirix_sys_timer_wait(int timeout_ms) {
+    pthread_mutex_lock(&libsyscall_ring.lock);
+    if (syscall_ring_attach() != 0) {
+        pthread_mutex_unlock(&libsyscall_ring.lock);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (libsyscall_ring.pending_count == 0) {
+        int wait_ms = timeout_ms;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long elapsed_ms = (now.tv_sec - start.tv_sec) * 1000L + (now.tv_nsec - start.tv_nsec) / 1000000L;
+            wait_ms = elapsed_ms < timeout_ms ? timeout_ms - (int)elapsed_ms : 0;
+        }
+        mirix_sysring_cqe_t cqe;
+        if (!libsyscall_ring_reap(&cqe, wait_ms)) {
+            pthread_mutex_unlock(&libsyscall_ring.lock);
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        // Results only come back to the call that waits for them
+        if (cqe.flags & MIRIX_SYSRING_CQE_TIMER) {
+            libsyscall_timer_expired(cqe.res);
+        }
+    }
+
+    int timer_id = libsyscall_ring.pending[libsyscall_ring.pending_head];
+    libsyscall_ring.pending_head = (libsyscall_ring.pending_head + 1) % LIBSYSCALL_PENDING_TIMERS;
+    libsyscall_ring.pending_count--;
+    pthread_mutex_unlock(&libsyscall_ring.lock);
+    return timer_id;
 }
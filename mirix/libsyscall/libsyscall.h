@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include <sys/types.h>
 
+#include "../ipc/ipc.h"
+
 // System call wrapper functions for MIRIX
 
 // File operations
@@ -28,9 +30,14 @@ int mirix_sys_munmap(void *addr, size_t length);
 // IPC operations
 int mirix_sys_ipc_send(uint32_t target_pid, const void *msg, size_t msg_size, int flags);
 int mirix_sys_ipc_recv(uint32_t sender_pid, void *msg, size_t *msg_size, int flags);
+int mirix_sys_ipc_send_batch(const mirix_ipc_send_entry_t *entries, size_t count);
+int mirix_sys_ipc_recv_batch(mirix_ipc_recv_entry_t *entries, size_t count, int timeout_ms);
 
-// Timer operations
+// Timer operations, served through the program's syscall ring (ENOSYS
+// without one). flags takes MIRIX_SYSRING_TIMER_PERIODIC; timer_wait
+// returns the id of the next timer to expire.
 int mirix_sys_timer_create(uint64_t interval_ms, int flags);
 int mirix_sys_timer_delete(int timer_id);
+int mirix_sys_timer_wait(int timeout_ms);
 
 #endif // MIRIX_LIBSYSCALL_H
@@ -0,0 +1,171 @@
+/*
+ * MIRIX Syscall Rings, program side
+ * Maps the ring the kernel created for this program and posts requests
+ * into it (see syscall/syscall_ring.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../syscall/syscall_ring.h"
+#include "../ipc/ipc_futex.h"
+
+#define SYSRING_SQ_MASK (MIRIX_SYSRING_SQ_ENTRIES - 1)
+#define SYSRING_CQ_MASK (MIRIX_SYSRING_CQ_ENTRIES - 1)
+
+// Program-side view of its ring
+static struct {
+    mirix_sysring_region_t *region;
+    uint32_t sq_tail;              // Prepared but unpublished entries end here
+} syscall_ring_user;
+
+static uint64_t syscall_ring_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Program side: map the ring named in MIRIX_SYSRING
+int syscall_ring_attach(void) {
+    if (syscall_ring_user.region) {
+        return 0;
+    }
+
+    const char *name = getenv(MIRIX_SYSRING_ENV);
+    if (!name) {
+        return -1;
+    }
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        perror("shm_open");
+        return -1;
+    }
+    void *mapping = mmap(NULL, sizeof(mirix_sysring_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    mirix_sysring_region_t *region = (mirix_sysring_region_t *)mapping;
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != MIRIX_SYSRING_MAGIC) {
+        munmap(mapping, sizeof(mirix_sysring_region_t));
+        return -1;
+    }
+    syscall_ring_user.region = region;
+    syscall_ring_user.sq_tail = region->sq_tail;
+    return 0;
+}
+
+void syscall_ring_detach(void) {
+    if (syscall_ring_user.region) {
+        munmap(syscall_ring_user.region, sizeof(mirix_sysring_region_t));
+        syscall_ring_user.region = NULL;
+    }
+}
+
+void *syscall_ring_buffer(size_t *size) {
+    if (!syscall_ring_user.region) {
+        return NULL;
+    }
+    if (size) {
+        *size = MIRIX_SYSRING_DATA_SIZE;
+    }
+    return syscall_ring_user.region->data;
+}
+
+// Next free submission entry, or NULL if the queue is full; it goes to
+// the kernel at the next syscall_ring_submit
+mirix_sysring_sqe_t *syscall_ring_get_sqe(void) {
+    mirix_sysring_region_t *region = syscall_ring_user.region;
+    if (!region) {
+        return NULL;
+    }
+    uint32_t tail = syscall_ring_user.sq_tail;
+    if (tail - __atomic_load_n(&region->sq_head, __ATOMIC_ACQUIRE) >= MIRIX_SYSRING_SQ_ENTRIES) {
+        return NULL;
+    }
+    syscall_ring_user.sq_tail = tail + 1;
+    mirix_sysring_sqe_t *sqe = &region->sqes[tail & SYSRING_SQ_MASK];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// Publish prepared entries; the doorbell is rung only if the kernel
+// thread has gone to sleep. Returns the number published.
+int syscall_ring_submit(void) {
+    mirix_sysring_region_t *region = syscall_ring_user.region;
+    if (!region) {
+        return -1;
+    }
+    uint32_t published = region->sq_tail;
+    uint32_t tail = syscall_ring_user.sq_tail;
+    __atomic_store_n(&region->sq_tail, tail, __ATOMIC_RELEASE);
+
+    // Pairs with the fence in syscall_ring_service
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&region->flags, __ATOMIC_RELAXED) & MIRIX_SYSRING_NEED_WAKEUP) {
+        __atomic_add_fetch(&region->doorbell, 1, __ATOMIC_RELEASE);
+        ipc_futex_wake(&region->doorbell, true);
+    }
+    return (int)(tail - published);
+}
+
+mirix_sysring_cqe_t *syscall_ring_peek_cqe(void) {
+    mirix_sysring_region_t *region = syscall_ring_user.region;
+    if (!region) {
+        return NULL;
+    }
+    uint32_t head = region->cq_head;
+    if (head == __atomic_load_n(&region->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &region->cqes[head & SYSRING_CQ_MASK];
+}
+
+// Wait for a completion (negative timeout waits forever)
+mirix_sysring_cqe_t *syscall_ring_wait_cqe(int timeout_ms) {
+    mirix_sysring_region_t *region = syscall_ring_user.region;
+    if (!region) {
+        return NULL;
+    }
+    uint64_t deadline = timeout_ms >= 0 ? syscall_ring_now_us() + (uint64_t)timeout_ms * 1000 : 0;
+
+    for (;;) {
+        mirix_sysring_cqe_t *cqe = syscall_ring_peek_cqe();
+        if (cqe) {
+            return cqe;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            uint64_t now = syscall_ring_now_us();
+            if (now >= deadline) {
+                return NULL;
+            }
+            wait_ms = (int)((deadline - now + 999) / 1000);
+        }
+
+        uint32_t tail = __atomic_load_n(&region->cq_tail, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&region->cq_waiters, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (tail == region->cq_head) {
+            ipc_futex_wait(&region->cq_tail, tail, wait_ms);
+        }
+        __atomic_sub_fetch(&region->cq_waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Release the completion returned by peek or wait
+void syscall_ring_cqe_seen(void) {
+    mirix_sysring_region_t *region = syscall_ring_user.region;
+    if (region) {
+        __atomic_store_n(&region->cq_head, region->cq_head + 1, __ATOMIC_RELEASE);
+    }
+}
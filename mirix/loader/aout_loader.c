@@ -53,12 +53,15 @@ bool mirix_aout_probe(const char *path, mirix_aout_info_t *info) {
     return true;
 }
 
-int mirix_aout_launch(const char *path, char *const argv[]) {
+int mirix_aout_launch(const char *path, char *const argv[], char *const envp[]) {
     if (!path) {
         errno = EINVAL;
         return -1;
     }
 
-    extern char **environ;
-    return execve(path, argv, environ);
+    if (!envp) {
+        extern char **environ;
+        envp = environ;
+    }
+    return execve(path, argv, envp);
 }
@@ -15,6 +15,7 @@ typedef struct {
 } mirix_aout_info_t;
 
 bool mirix_aout_probe(const char *path, mirix_aout_info_t *info);
-int mirix_aout_launch(const char *path, char *const argv[]);
+// envp NULL = the caller's environment
+int mirix_aout_launch(const char *path, char *const argv[], char *const envp[]);
 
 #endif // MIRIX_AOUT_LOADER_H
@@ -5,6 +5,7 @@
 
 #include "posix.h"
 #include "sus_simple.h"
+#include "precise_sleep.h"
 #include "mirix/syscall/syscall.h"
 #include <stdbool.h>
 #include <string.h>
@@ -54,6 +55,14 @@ int posix_init(void) {
     posix_state.initialized = true;
     
     printf("POSIX: POSIX compatibility layer initialized\n");
+    if (precise_sleep_enabled()) {
+        // Measure host wakeup latency now rather than on the first sleep
+        precise_sleep_init();
+        precise_sleep_stats_t sleep_stats;
+        precise_sleep_get_stats(&sleep_stats);
+        printf("POSIX: precise sleep margin %llu us (%s spin)\n", (unsigned long long)(sleep_stats.margin_ns / 1000),
+               sleep_stats.tsc ? "TSC" : "clock");
+    }
     return 0;
 }
 
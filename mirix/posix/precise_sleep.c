@@ -0,0 +1,217 @@
+/*
+ * MIRIX Precise Sleep
+ * Hybrid host sleep + TSC spin with a margin learned from wakeup latency
+ */
+
+#include "precise_sleep.h"
+#include <errno.h>
+#include <pthread.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+// Precise sleep state; the estimator fields are updated racily by
+// concurrent sleepers, which only costs a little smoothing
+static struct {
+    pthread_once_t once;
+    bool enabled;
+    bool tsc;                      // Invariant TSC usable for spinning
+    uint64_t tsc_per_ns_q32;       // TSC ticks per nanosecond, 32.32 fixed point
+    uint64_t latency_avg_ns;       // Smoothed host wakeup overshoot (atomic)
+    uint64_t latency_dev_ns;       // Smoothed mean deviation of it (atomic)
+    uint64_t margin_ns;            // avg + 4 * dev, clamped (atomic)
+    uint64_t sleeps;               // Counters (atomic)
+    uint64_t spin_ns_total;
+    uint64_t late;
+} precise_sleep_state = { .once = PTHREAD_ONCE_INIT, .enabled = false, .margin_ns = PRECISE_SLEEP_MAX_MARGIN_NS };
+
+static uint64_t precise_sleep_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void precise_sleep_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ volatile ("pause");
+#endif
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t precise_sleep_rdtsc(void) {
+    uint32_t low, high;
+    __asm__ volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// The TSC only measures time if it ticks at a constant rate in every
+// power state (CPUID 0x80000007 EDX bit 8)
+static bool precise_sleep_tsc_invariant(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+}
+#endif
+
+// Fold one observed wakeup overshoot into the margin
+static void precise_sleep_observe(uint64_t overshoot_ns) {
+    int64_t avg = (int64_t)__atomic_load_n(&precise_sleep_state.latency_avg_ns, __ATOMIC_RELAXED);
+    int64_t dev = (int64_t)__atomic_load_n(&precise_sleep_state.latency_dev_ns, __ATOMIC_RELAXED);
+    int64_t error = (int64_t)overshoot_ns - avg;
+
+    avg += error / 8;
+    dev += ((error < 0 ? -error : error) - dev) / 4;
+    uint64_t margin = (uint64_t)(avg + 4 * dev);
+    if (margin < PRECISE_SLEEP_MIN_MARGIN_NS) {
+        margin = PRECISE_SLEEP_MIN_MARGIN_NS;
+    } else if (margin > PRECISE_SLEEP_MAX_MARGIN_NS) {
+        margin = PRECISE_SLEEP_MAX_MARGIN_NS;
+    }
+
+    __atomic_store_n(&precise_sleep_state.latency_avg_ns, (uint64_t)avg, __ATOMIC_RELAXED);
+    __atomic_store_n(&precise_sleep_state.latency_dev_ns, (uint64_t)dev, __ATOMIC_RELAXED);
+    __atomic_store_n(&precise_sleep_state.margin_ns, margin, __ATOMIC_RELAXED);
+}
+
+static void precise_sleep_calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    // TSC rate against the monotonic clock over a few milliseconds
+    if (precise_sleep_tsc_invariant()) {
+        struct timespec pause = { 0, 5000000L };
+        uint64_t ns0 = precise_sleep_clock_ns();
+        uint64_t tsc0 = precise_sleep_rdtsc();
+        nanosleep(&pause, NULL);
+        uint64_t tsc1 = precise_sleep_rdtsc();
+        uint64_t ns1 = precise_sleep_clock_ns();
+        if (ns1 > ns0 && tsc1 > tsc0 && tsc1 - tsc0 < (1ULL << 32)) {
+            // A few milliseconds of ticks fit in 32 bits, so the shift cannot overflow
+            precise_sleep_state.tsc_per_ns_q32 = ((tsc1 - tsc0) << 32) / (ns1 - ns0);
+            precise_sleep_state.tsc = precise_sleep_state.tsc_per_ns_q32 != 0;
+        }
+    }
+#endif
+
+    // Seed the estimator from a few short host sleeps; sleeps made later
+    // keep it tracking the host
+    struct timespec sample = { 0, PRECISE_SLEEP_CALIBRATE_NS };
+    for (int i = 0; i < PRECISE_SLEEP_CALIBRATE_SAMPLES; i++) {
+        uint64_t start = precise_sleep_clock_ns();
+        nanosleep(&sample, NULL);
+        uint64_t slept = precise_sleep_clock_ns() - start;
+        uint64_t overshoot = slept > PRECISE_SLEEP_CALIBRATE_NS ? slept - PRECISE_SLEEP_CALIBRATE_NS : 0;
+        if (i == 0) {
+            precise_sleep_state.latency_avg_ns = overshoot;
+            precise_sleep_state.latency_dev_ns = overshoot / 2;
+        }
+        precise_sleep_observe(overshoot);
+    }
+}
+
+// Calibrate the TSC and the margin
+int precise_sleep_init(void) {
+    pthread_once(&precise_sleep_state.once, precise_sleep_calibrate);
+    return 0;
+}
+
+void precise_sleep_set_enabled(bool enabled) {
+    __atomic_store_n(&precise_sleep_state.enabled, enabled, __ATOMIC_RELAXED);
+}
+
+bool precise_sleep_enabled(void) {
+    return __atomic_load_n(&precise_sleep_state.enabled, __ATOMIC_RELAXED);
+}
+
+// Busy-wait from now_ns to deadline_ns
+static void precise_sleep_spin(uint64_t now_ns, uint64_t deadline_ns) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (precise_sleep_state.tsc) {
+        // Spins are at most PRECISE_SLEEP_MAX_MARGIN_NS, well inside 64 bits here
+        uint64_t end = precise_sleep_rdtsc() + (((deadline_ns - now_ns) * precise_sleep_state.tsc_per_ns_q32) >> 32);
+        while ((int64_t)(precise_sleep_rdtsc() - end) < 0) {
+            precise_sleep_relax();
+        }
+        // Calibration error can leave the TSC a few ticks early; the clock
+        // check below then costs one read
+    }
+#endif
+    (void)now_ns;
+    while (precise_sleep_clock_ns() < deadline_ns) {
+        precise_sleep_relax();
+    }
+}
+
+// Sleep until a CLOCK_MONOTONIC instant
+int precise_sleep_until(uint64_t deadline_ns) {
+    uint64_t now = precise_sleep_clock_ns();
+    bool precise = precise_sleep_enabled() &&
+                   (deadline_ns <= now || deadline_ns - now <= PRECISE_SLEEP_MAX_REQUEST_NS);
+    if (precise) {
+        precise_sleep_init();
+    }
+
+    while (now < deadline_ns) {
+        uint64_t margin = precise ? __atomic_load_n(&precise_sleep_state.margin_ns, __ATOMIC_RELAXED) : 0;
+        if (deadline_ns - now <= margin) {
+            precise_sleep_spin(now, deadline_ns);
+            __atomic_add_fetch(&precise_sleep_state.spin_ns_total, deadline_ns - now, __ATOMIC_RELAXED);
+            break;
+        }
+
+        uint64_t target = deadline_ns - margin;
+        uint64_t span = target - now;
+        struct timespec ts = { (time_t)(span / 1000000000ULL), (long)(span % 1000000000ULL) };
+        if (nanosleep(&ts, NULL) != 0 && errno == EINTR) {
+            return -1;
+        }
+
+        now = precise_sleep_clock_ns();
+        if (!precise) {
+            break;
+        }
+        precise_sleep_observe(now > target ? now - target : 0);
+        if (now > deadline_ns) {
+            __atomic_add_fetch(&precise_sleep_state.late, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (precise) {
+        __atomic_add_fetch(&precise_sleep_state.sleeps, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+// Sleep for a relative interval
+int precise_sleep(const struct timespec *req, struct timespec *rem) {
+    if (!req || req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000L) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint64_t deadline_ns = precise_sleep_clock_ns() + (uint64_t)req->tv_sec * 1000000000ULL + (uint64_t)req->tv_nsec;
+    if (precise_sleep_until(deadline_ns) == 0) {
+        return 0;
+    }
+
+    if (rem) {
+        uint64_t now = precise_sleep_clock_ns();
+        uint64_t left = now < deadline_ns ? deadline_ns - now : 0;
+        rem->tv_sec = (time_t)(left / 1000000000ULL);
+        rem->tv_nsec = (long)(left % 1000000000ULL);
+    }
+    errno = EINTR;
+    return -1;
+}
+
+void precise_sleep_get_stats(precise_sleep_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->sleeps = __atomic_load_n(&precise_sleep_state.sleeps, __ATOMIC_RELAXED);
+    stats->spin_ns_total = __atomic_load_n(&precise_sleep_state.spin_ns_total, __ATOMIC_RELAXED);
+    stats->late = __atomic_load_n(&precise_sleep_state.late, __ATOMIC_RELAXED);
+    stats->margin_ns = __atomic_load_n(&precise_sleep_state.margin_ns, __ATOMIC_RELAXED);
+    stats->tsc = precise_sleep_state.tsc;
+}
@@ -0,0 +1,53 @@
+#ifndef MIRIX_PRECISE_SLEEP_H
+#define MIRIX_PRECISE_SLEEP_H
+
+/*
+ * MIRIX Precise Sleep
+ * Sleeps on the host until a calibrated margin before the deadline, then
+ * spins on the TSC for the rest, so short delays do not pay the host's
+ * wakeup slack
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Bounds for the spin margin learned from host wakeup latency
+#define PRECISE_SLEEP_MIN_MARGIN_NS 2000
+#define PRECISE_SLEEP_MAX_MARGIN_NS 2000000
+
+// Longer requests sleep on the host alone: the spin only pays off for
+// pacing delays, where the wakeup slack is a large part of the wait
+#define PRECISE_SLEEP_MAX_REQUEST_NS 10000000
+
+// Boot-time calibration: host sleeps of this length, and how many
+#define PRECISE_SLEEP_CALIBRATE_NS 20000
+#define PRECISE_SLEEP_CALIBRATE_SAMPLES 32
+
+// Counters since boot
+typedef struct {
+    uint64_t sleeps;               // Precise sleeps completed
+    uint64_t spin_ns_total;        // Time spent spinning out the margin
+    uint64_t late;                 // Host woke up after the deadline itself
+    uint64_t margin_ns;            // Current margin
+    bool tsc;                      // Spinning on the TSC (else the monotonic clock)
+} precise_sleep_stats_t;
+
+// Calibrate the TSC and the margin; runs once, on first use at the latest
+int precise_sleep_init(void);
+
+// Precise mode is off by default (it burns CPU while spinning); off,
+// sleeps go straight to the host
+void precise_sleep_set_enabled(bool enabled);
+bool precise_sleep_enabled(void);
+
+// Sleep for req (relative). Returns -1 with errno EINTR and the time left
+// in rem if a signal cut the host sleep short.
+int precise_sleep(const struct timespec *req, struct timespec *rem);
+
+// Sleep until a CLOCK_MONOTONIC instant in nanoseconds
+int precise_sleep_until(uint64_t deadline_ns);
+
+void precise_sleep_get_stats(precise_sleep_stats_t *stats);
+
+#endif // MIRIX_PRECISE_SLEEP_H
@@ -4,6 +4,7 @@
  */
 
 #include "sus_simple.h"
+#include "precise_sleep.h"
 #include "mirix/syscall/syscall.h"
 #include <string.h>
 #include <errno.h>
@@ -165,10 +166,17 @@ int clock_nanosleep(clockid_t clock_id, const struct timespec *rqtp, struct time
         return -1;
     }
     
+    // With --precise-sleep: host sleep to a calibrated margin short of the
+    // deadline, then a TSC spin, so short pacing delays are not stretched
+    // by wakeup slack
+    if (precise_sleep_enabled()) {
+        return precise_sleep(rqtp, rmtp);
+    }
+    
     struct timespec remaining;
     int result = nanosleep_syscall(rqtp, &remaining);
     
-    if (rmtp) {
+    if (result != 0 && rmtp) {
         *rmtp = remaining;
     }
     
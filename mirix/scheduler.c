@@ -3,97 +3,1974 @@
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <ctype.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #include "kernel.h"
+#include "scheduler.h"
 
-// Simple round-robin scheduler
+// End-of-list / empty marker for slot indices
+#define SCHED_NIL UINT32_MAX
+
+// Process table is allocated in fixed chunks so entries never move while
+// other vCPUs hold pointers to them
+#define SCHED_CHUNK_SHIFT 8
+#define SCHED_CHUNK_SIZE (1u << SCHED_CHUNK_SHIFT)
+#define SCHED_MAX_CHUNKS (MIRIX_SCHED_MAX_PROCESSES / SCHED_CHUNK_SIZE)
+
+// Process name -> group rules from the timeshare file
+#define SCHED_MAX_MEMBERS 256
+
+// vCPUs at most this far apart (arch_topology_distance) share a cache
+#define SCHED_CACHE_DISTANCE 3
+
+// Deadline-class densities are fixed point with this many fractional bits
+#define SCHED_DL_SHIFT 20
+
+// Releases this close together start at one switch instead of preempting
+// each other one by one
+#define SCHED_DL_RELEASE_SLACK_NS 20000
+
+// Process table entry; run queue links are slot indices
+typedef struct {
+    mirix_process_t process;
+    uint32_t next;
+    uint32_t prev;
+    bool queued;
+    int cpu;                       // Run queue the entry belongs to
+    int cpu_hint;                  // Preferred CPU, -1 = none
+    bool pinned;                   // Never migrate off cpu_hint
+    int group;                     // Fair-share group
+    uint32_t ipc_peer;             // Pid it sends to most (heavy-hitter counter)
+    uint32_t ipc_score;
+    int ipc_home;                  // vCPU near ipc_peer it was moved to, -1 = none
+    uint64_t runnable_ns;          // When it last started waiting for a vCPU
+    uint64_t dl_runtime_ns;        // Deadline class parameters, period 0 = best effort
+    uint64_t dl_deadline_ns;
+    uint64_t dl_period_ns;
+    uint64_t dl_density;           // runtime / deadline << SCHED_DL_SHIFT
+    uint64_t dl_abs_deadline;      // Deadline of the current job
+    uint64_t dl_release;           // Start of the current job, or of the next once throttled
+    int64_t dl_budget;             // Runtime left in the current job
+    bool dl_throttled;             // Budget used up: parked until dl_release
+    bool dispatching;              // A vCPU is running it right now (entry CPU lock)
+    bool dying;                    // Removed while dispatching; that vCPU frees the slot
+    scheduler_latency_stats_t stats;
+} sched_entry_t;
+
+// Per-priority FIFO of runnable slots
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+} sched_queue_t;
+
+// Fair-share group, shared by all CPUs
+typedef struct {
+    char name[MIRIX_SCHED_GROUP_NAME_MAX];
+    uint32_t weight;
+    uint32_t cap_percent;          // Share of one vCPU, 0 = uncapped
+    uint64_t quota_ns;             // Runtime allowed per cap period, 0 = uncapped
+    uint64_t used_ns;              // Runtime charged this period (atomic)
+    uint64_t period_start_ns;      // Start of the current cap period (atomic)
+} sched_group_t;
+
+// A group's runnable processes on one CPU
+typedef struct {
+    sched_queue_t queues[MIRIX_SCHED_PRIORITIES];
+    uint64_t ready_bitmap;         // Bit n set = queues[n] non-empty
+    uint64_t vruntime;             // Runtime here, scaled by 1024 / weight
+} sched_group_rq_t;
+
+// Timeshare member rule
+typedef struct {
+    char name[64];
+    int group;
+} sched_member_t;
+
+// Per-CPU run queue
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work;           // Signalled when a process is queued here
+    sched_group_rq_t groups[MIRIX_SCHED_MAX_GROUPS];
+    uint32_t group_bitmap;         // Bit n set = groups[n] has queued processes
+    uint64_t min_vruntime;         // Floor for groups that become runnable
+    uint32_t nr_running;           // Queued processes
+    uint32_t current_process;      // Slot index or SCHED_NIL
+    uint64_t switched_ns;          // When current_process was picked
+    uint64_t tick_count;
+    scheduler_cpu_stats_t stats;   // Written by this vCPU under lock
+    bool idle;                     // Parked until work is queued or kicked
+    uint32_t dl_head;              // Runnable deadline tasks, earliest deadline first
+    uint32_t dl_throttled;         // Deadline tasks waiting for their next release
+    uint64_t dl_bw;                // Admitted density (table_lock and lock to write)
+    uint64_t dl_next_release;      // Earliest release on dl_throttled, UINT64_MAX = none
+    uint64_t resched_at_ns;        // When the dispatch backend must give the vCPU back (atomic)
+    bool need_resched;             // A deadline task preempts the current one (atomic)
+    arch_cpu_topology_t host;      // Host CPU it is pinned to (cpu -1 = unpinned)
+    int *near;                     // Other vCPUs, nearest first (steal/kick order)
+    pthread_t thread;
+    bool thread_started;
+} sched_cpu_t;
+
+// Priority round-robin SMP scheduler
 static struct {
-    mirix_process_t *processes;
+    pthread_mutex_t table_lock;    // Process table, pid index and free list
+    sched_entry_t *chunks[SCHED_MAX_CHUNKS];
     size_t max_processes;
-    size_t current_process;
+    size_t num_processes;
+    uint32_t free_head;            // Unused slots, linked through next
+    uint32_t *pid_index;           // Open-addressed pid -> slot, SCHED_NIL = empty
+    size_t pid_index_size;         // Power of two, twice max_processes
+    sched_cpu_t *cpus;
+    int cpu_count;
+    bool running;                  // vCPU threads keep going while set
+    uint32_t idle_cpus;            // Parked vCPUs
+    sched_group_t groups[MIRIX_SCHED_MAX_GROUPS];
+    int group_count;               // Groups never go away once added
+    sched_member_t members[SCHED_MAX_MEMBERS];
+    int member_count;
+    scheduler_dispatch_fn dispatch;
     uint64_t quantum_ticks;
-    uint64_t tick_count;
-} scheduler_state;
+    int service_cpus[MIRIX_SCHED_MAX_CPUS]; // Spare host CPUs for service threads
+    int service_cpu_count;
+} scheduler_state = { .table_lock = PTHREAD_MUTEX_INITIALIZER };
+
+// CPU the calling thread schedules for (vCPU threads set their own)
+static __thread int sched_this_cpu;
+
+// Sends seen by this thread, for IPC sampling
+static __thread uint32_t sched_ipc_sends;
+
+// Resolve a slot index
+static inline sched_entry_t *sched_entry(uint32_t slot) {
+    return &scheduler_state.chunks[slot >> SCHED_CHUNK_SHIFT][slot & (SCHED_CHUNK_SIZE - 1)];
+}
+
+// Hash a pid into the index
+static size_t sched_pid_hash(uint32_t pid) {
+    return (pid * 2654435761u) & (scheduler_state.pid_index_size - 1);
+}
+
+// Find the index position holding pid, or the empty position it would go in
+static size_t sched_pid_probe(uint32_t pid) {
+    size_t mask = scheduler_state.pid_index_size - 1;
+    size_t pos = sched_pid_hash(pid);
+
+    while (scheduler_state.pid_index[pos] != SCHED_NIL &&
+           sched_entry(scheduler_state.pid_index[pos])->process.pid != pid) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+// Remove an index position, shifting later probes back (no tombstones)
+static void sched_pid_erase(size_t pos) {
+    size_t mask = scheduler_state.pid_index_size - 1;
+    size_t hole = pos;
+
+    scheduler_state.pid_index[hole] = SCHED_NIL;
+    for (size_t next = (hole + 1) & mask; scheduler_state.pid_index[next] != SCHED_NIL; next = (next + 1) & mask) {
+        size_t home = sched_pid_hash(sched_entry(scheduler_state.pid_index[next])->process.pid);
+
+        // Move the entry back if its home is not cyclically in (hole, next]
+        bool in_range = (hole <= next) ? (home > hole && home <= next) : (home > hole || home <= next);
+        if (!in_range) {
+            scheduler_state.pid_index[hole] = scheduler_state.pid_index[next];
+            scheduler_state.pid_index[next] = SCHED_NIL;
+            hole = next;
+        }
+    }
+}
+
+// Look up a pid's slot (caller holds table_lock)
+static uint32_t sched_slot_of(uint32_t pid) {
+    if (!scheduler_state.pid_index || pid == 0) {
+        return SCHED_NIL;
+    }
+    return scheduler_state.pid_index[sched_pid_probe(pid)];
+}
+
+// Grow the table to max_processes and rebuild the pid index (caller holds table_lock)
+static int sched_resize(size_t max_processes) {
+    size_t old_max = scheduler_state.max_processes;
+
+    size_t index_size = max_processes * 2;
+    uint32_t *pid_index = malloc(index_size * sizeof(uint32_t));
+    if (!pid_index) {
+        return -1;
+    }
+
+    for (size_t chunk = old_max / SCHED_CHUNK_SIZE; chunk < max_processes / SCHED_CHUNK_SIZE; chunk++) {
+        scheduler_state.chunks[chunk] = calloc(SCHED_CHUNK_SIZE, sizeof(sched_entry_t));
+        if (!scheduler_state.chunks[chunk]) {
+            free(pid_index);
+            return -1;
+        }
+    }
+
+    // Thread the new slots onto the free list
+    for (size_t i = max_processes; i > old_max; i--) {
+        sched_entry((uint32_t)(i - 1))->next = scheduler_state.free_head;
+        scheduler_state.free_head = (uint32_t)(i - 1);
+    }
+    scheduler_state.max_processes = max_processes;
+
+    // Rebuild the pid index at the new size
+    free(scheduler_state.pid_index);
+    scheduler_state.pid_index = pid_index;
+    scheduler_state.pid_index_size = index_size;
+    memset(pid_index, 0xff, index_size * sizeof(uint32_t));
+    for (size_t i = 0; i < old_max; i++) {
+        if (sched_entry((uint32_t)i)->process.pid != 0 && !sched_entry((uint32_t)i)->dying) {
+            pid_index[sched_pid_probe(sched_entry((uint32_t)i)->process.pid)] = (uint32_t)i;
+        }
+    }
+
+    return 0;
+}
+
+// Monotonic clock for runtime accounting and cap periods
+static uint64_t sched_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Link a slot into a deadline list, by absolute deadline when sorted
+static void sched_dl_link(uint32_t *head, uint32_t slot, bool sorted) {
+    sched_entry_t *entry = sched_entry(slot);
+    uint32_t prev = SCHED_NIL;
+    uint32_t next = *head;
+
+    while (sorted && next != SCHED_NIL && sched_entry(next)->dl_abs_deadline <= entry->dl_abs_deadline) {
+        prev = next;
+        next = sched_entry(next)->next;
+    }
+    entry->prev = prev;
+    entry->next = next;
+    if (prev == SCHED_NIL) {
+        *head = slot;
+    } else {
+        sched_entry(prev)->next = slot;
+    }
+    if (next != SCHED_NIL) {
+        sched_entry(next)->prev = slot;
+    }
+}
+
+static void sched_dl_unlink(uint32_t *head, uint32_t slot) {
+    sched_entry_t *entry = sched_entry(slot);
+
+    if (entry->prev == SCHED_NIL) {
+        *head = entry->next;
+    } else {
+        sched_entry(entry->prev)->next = entry->next;
+    }
+    if (entry->next != SCHED_NIL) {
+        sched_entry(entry->next)->prev = entry->prev;
+    }
+    entry->next = SCHED_NIL;
+    entry->prev = SCHED_NIL;
+}
+
+// Recompute when the vCPU's dispatch must return: the next release of a
+// throttled task, or the running deadline task's budget running out
+// (caller holds cpu->lock)
+static void sched_dl_set_timer(sched_cpu_t *cpu) {
+    uint64_t at = UINT64_MAX;
+    for (uint32_t slot = cpu->dl_throttled; slot != SCHED_NIL; slot = sched_entry(slot)->next) {
+        if (sched_entry(slot)->dl_release < at) {
+            at = sched_entry(slot)->dl_release;
+        }
+    }
+    cpu->dl_next_release = at;
+
+    uint32_t current = cpu->current_process;
+    if (current != SCHED_NIL && sched_entry(current)->dl_period_ns) {
+        int64_t budget = sched_entry(current)->dl_budget;
+        uint64_t out_ns = cpu->switched_ns + (budget > 0 ? (uint64_t)budget : 0);
+        if (out_ns < at) {
+            at = out_ns;
+        }
+    }
+    __atomic_store_n(&cpu->resched_at_ns, at, __ATOMIC_RELEASE);
+}
+
+// Queue a deadline task. A task that used up its budget waits for its next
+// release; one waking up keeps its deadline only if the budget it has left
+// would not exceed its admitted density before then (the CBS wakeup rule),
+// otherwise it starts a fresh job. Preempts a best-effort or later-deadline
+// task running here. (caller holds cpu->lock)
+static void sched_dl_enqueue(sched_cpu_t *cpu, uint32_t slot, uint64_t now_ns) {
+    sched_entry_t *entry = sched_entry(slot);
+    entry->queued = true;
+
+    if (entry->dl_budget <= 0 && entry->dl_release > now_ns) {
+        entry->dl_throttled = true;
+        sched_dl_link(&cpu->dl_throttled, slot, false);
+        sched_dl_set_timer(cpu);
+        return;
+    }
+
+    if (entry->dl_budget <= 0 || entry->dl_abs_deadline <= now_ns ||
+        ((uint64_t)entry->dl_budget << SCHED_DL_SHIFT) / (entry->dl_abs_deadline - now_ns) > entry->dl_density) {
+        entry->dl_release = now_ns;
+        entry->dl_abs_deadline = now_ns + entry->dl_deadline_ns;
+        entry->dl_budget = (int64_t)entry->dl_runtime_ns;
+    }
+    entry->dl_throttled = false;
+    sched_dl_link(&cpu->dl_head, slot, true);
+    __atomic_add_fetch(&cpu->nr_running, 1, __ATOMIC_SEQ_CST);
+
+    uint32_t current = cpu->current_process;
+    if (current != SCHED_NIL && current != slot &&
+        (!sched_entry(current)->dl_period_ns || sched_entry(current)->dl_abs_deadline > entry->dl_abs_deadline)) {
+        __atomic_store_n(&cpu->need_resched, true, __ATOMIC_RELEASE);
+    }
+}
+
+// Append a slot to its group's priority queue on a CPU, or to the deadline
+// queue if it has deadline parameters (caller holds cpu->lock)
+static void sched_enqueue(sched_cpu_t *cpu, uint32_t slot) {
+    sched_entry_t *entry = sched_entry(slot);
+    if (entry->dl_period_ns) {
+        sched_dl_enqueue(cpu, slot, sched_clock_ns());
+        return;
+    }
+
+    int priority = entry->process.priority;
+    sched_group_rq_t *grq = &cpu->groups[entry->group];
+    sched_queue_t *queue = &grq->queues[priority];
+
+    // A group waking up starts level with the others instead of cashing in
+    // the time it spent idle
+    if (grq->ready_bitmap == 0) {
+        if (grq->vruntime < cpu->min_vruntime) {
+            grq->vruntime = cpu->min_vruntime;
+        }
+        cpu->group_bitmap |= 1u << entry->group;
+    }
+
+    entry->next = SCHED_NIL;
+    entry->prev = queue->tail;
+    if (queue->tail == SCHED_NIL) {
+        queue->head = slot;
+    } else {
+        sched_entry(queue->tail)->next = slot;
+    }
+    queue->tail = slot;
+    entry->queued = true;
+    grq->ready_bitmap |= 1ULL << priority;
+    // Pairs with sched_idle(): either the idle CPU sees this count or we see it idle
+    __atomic_add_fetch(&cpu->nr_running, 1, __ATOMIC_SEQ_CST);
+}
+
+// Unlink a slot from its run queue (caller holds cpu->lock)
+static void sched_dequeue(sched_cpu_t *cpu, uint32_t slot) {
+    sched_entry_t *entry = sched_entry(slot);
+    if (entry->dl_period_ns) {
+        if (entry->dl_throttled) {
+            sched_dl_unlink(&cpu->dl_throttled, slot);
+            entry->dl_throttled = false;
+            sched_dl_set_timer(cpu);
+        } else {
+            sched_dl_unlink(&cpu->dl_head, slot);
+            __atomic_sub_fetch(&cpu->nr_running, 1, __ATOMIC_RELAXED);
+        }
+        entry->queued = false;
+        return;
+    }
+
+    int priority = entry->process.priority;
+    sched_group_rq_t *grq = &cpu->groups[entry->group];
+    sched_queue_t *queue = &grq->queues[priority];
+
+    if (entry->prev == SCHED_NIL) {
+        queue->head = entry->next;
+    } else {
+        sched_entry(entry->prev)->next = entry->next;
+    }
+    if (entry->next == SCHED_NIL) {
+        queue->tail = entry->prev;
+    } else {
+        sched_entry(entry->next)->prev = entry->prev;
+    }
+    entry->next = SCHED_NIL;
+    entry->prev = SCHED_NIL;
+    entry->queued = false;
+    __atomic_sub_fetch(&cpu->nr_running, 1, __ATOMIC_RELAXED);
+
+    if (queue->head == SCHED_NIL) {
+        grq->ready_bitmap &= ~(1ULL << priority);
+        if (grq->ready_bitmap == 0) {
+            cpu->group_bitmap &= ~(1u << entry->group);
+        }
+    }
+}
+
+// Whether a capped group used up its quota for the current period. When
+// it has, *until_ns is lowered to the end of that period.
+static bool sched_group_throttled(int group, uint64_t now_ns, uint64_t *until_ns) {
+    sched_group_t *g = &scheduler_state.groups[group];
+    uint64_t quota_ns = __atomic_load_n(&g->quota_ns, __ATOMIC_RELAXED);
+    if (quota_ns == 0) {
+        return false;
+    }
+
+    uint64_t period_ns = MIRIX_SCHED_CAP_PERIOD_US * 1000ULL;
+    uint64_t start = __atomic_load_n(&g->period_start_ns, __ATOMIC_ACQUIRE);
+    if (now_ns - start >= period_ns) {
+        // New period: whichever CPU gets here first resets the budget
+        if (__atomic_compare_exchange_n(&g->period_start_ns, &start, now_ns, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&g->used_ns, 0, __ATOMIC_RELEASE);
+        }
+        return false;
+    }
+
+    if (__atomic_load_n(&g->used_ns, __ATOMIC_ACQUIRE) < quota_ns) {
+        return false;
+    }
+    if (until_ns && start + period_ns < *until_ns) {
+        *until_ns = start + period_ns;
+    }
+    return true;
+}
+
+// Group on a CPU with the least weighted runtime that is not throttled, or
+// -1 (caller holds cpu->lock)
+static int sched_pick_group(sched_cpu_t *cpu, uint64_t now_ns, uint64_t *until_ns) {
+    int best = -1;
+
+    for (uint32_t bitmap = cpu->group_bitmap; bitmap; bitmap &= bitmap - 1) {
+        int group = __builtin_ctz(bitmap);
+        if (sched_group_throttled(group, now_ns, until_ns)) {
+            continue;
+        }
+        if (best < 0 || cpu->groups[group].vruntime < cpu->groups[best].vruntime) {
+            best = group;
+        }
+    }
+    return best;
+}
+
+// Histogram bucket for a latency sample
+static int sched_hist_bucket(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    int bucket = us < 2 ? 0 : 63 - __builtin_clzll(us);
+    return bucket < MIRIX_SCHED_HIST_BUCKETS ? bucket : MIRIX_SCHED_HIST_BUCKETS - 1;
+}
+
+static void sched_record_wait(scheduler_latency_stats_t *stats, uint64_t wait_ns) {
+    stats->dispatches++;
+    stats->wait_ns_total += wait_ns;
+    if (wait_ns > stats->wait_ns_max) {
+        stats->wait_ns_max = wait_ns;
+    }
+    stats->wait_hist[sched_hist_bucket(wait_ns)]++;
+}
+
+static void sched_record_run(scheduler_latency_stats_t *stats, uint64_t run_ns) {
+    stats->run_ns_total += run_ns;
+    if (run_ns > stats->run_ns_max) {
+        stats->run_ns_max = run_ns;
+    }
+    stats->run_hist[sched_hist_bucket(run_ns)]++;
+}
+
+// Charge a process's time slice to it, its group's vruntime on this CPU
+// and its group's cap; deadline tasks run outside the groups
+// (caller holds cpu->lock)
+static void sched_charge(sched_cpu_t *cpu, uint32_t slot, uint64_t ran_ns) {
+    sched_entry_t *entry = sched_entry(slot);
+    sched_group_t *g = &scheduler_state.groups[entry->group];
+
+    sched_record_run(&entry->stats, ran_ns);
+    sched_record_run(&cpu->stats.latency, ran_ns);
+
+    entry->process.runtime_ticks += ran_ns / 1000;
+    if (entry->dl_period_ns) {
+        return;
+    }
+    cpu->groups[entry->group].vruntime += ran_ns * MIRIX_SCHED_DEFAULT_WEIGHT /
+                                          __atomic_load_n(&g->weight, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&g->quota_ns, __ATOMIC_RELAXED) != 0) {
+        __atomic_add_fetch(&g->used_ns, ran_ns, __ATOMIC_ACQ_REL);
+    }
+}
+
+// Take a deadline task's time slice out of its budget. Once the budget is
+// gone the job is over (late if past its deadline) and the task waits for
+// its next period. (caller holds cpu->lock)
+static void sched_dl_charge(sched_cpu_t *cpu, uint32_t slot, uint64_t ran_ns, uint64_t now_ns) {
+    sched_entry_t *entry = sched_entry(slot);
+    entry->dl_budget -= (int64_t)ran_ns;
+    if (entry->dl_budget > 0) {
+        return;
+    }
+
+    if (now_ns > entry->dl_abs_deadline) {
+        entry->stats.deadline_misses++;
+        cpu->stats.latency.deadline_misses++;
+    }
+    entry->dl_release += entry->dl_period_ns;
+    if (entry->queued) {
+        sched_dequeue(cpu, slot);
+        sched_dl_enqueue(cpu, slot, now_ns);
+    }
+}
+
+// Start the next job of every throttled task whose release has come
+// (caller holds cpu->lock)
+static void sched_dl_replenish(sched_cpu_t *cpu, uint64_t now_ns) {
+    uint64_t due_ns = now_ns + SCHED_DL_RELEASE_SLACK_NS;
+    if (cpu->dl_next_release > due_ns) {
+        return;
+    }
+
+    uint32_t slot = cpu->dl_throttled;
+    while (slot != SCHED_NIL) {
+        sched_entry_t *entry = sched_entry(slot);
+        uint32_t next = entry->next;
+        if (entry->dl_release <= due_ns) {
+            sched_dl_unlink(&cpu->dl_throttled, slot);
+            entry->dl_throttled = false;
+            entry->dl_abs_deadline = entry->dl_release + entry->dl_deadline_ns;
+            entry->dl_budget = (int64_t)entry->dl_runtime_ns;
+            entry->runnable_ns = now_ns;
+            sched_dl_link(&cpu->dl_head, slot, true);
+            __atomic_add_fetch(&cpu->nr_running, 1, __ATOMIC_SEQ_CST);
+        }
+        slot = next;
+    }
+    sched_dl_set_timer(cpu);
+}
+
+// Lock the run queue an entry belongs to; retries if it migrates meanwhile
+static sched_cpu_t *sched_lock_entry_cpu(sched_entry_t *entry) {
+    while (true) {
+        int cpu = __atomic_load_n(&entry->cpu, __ATOMIC_ACQUIRE);
+        pthread_mutex_lock(&scheduler_state.cpus[cpu].lock);
+        if (entry->cpu == cpu) {
+            return &scheduler_state.cpus[cpu];
+        }
+        pthread_mutex_unlock(&scheduler_state.cpus[cpu].lock);
+    }
+}
+
+// Topology distance between two vCPUs (0 when placement is unknown)
+static int sched_cpu_distance(int a, int b) {
+    if (a == b) {
+        return 0;
+    }
+    const arch_cpu_topology_t *ha = &scheduler_state.cpus[a].host;
+    const arch_cpu_topology_t *hb = &scheduler_state.cpus[b].host;
+    if (ha->cpu < 0 || hb->cpu < 0) {
+        return 0;
+    }
+    return arch_topology_distance(ha, hb);
+}
+
+// Nth other vCPU to try from cpu_id: nearest first once a topology is
+// set, otherwise round-robin
+static inline int sched_near(int cpu_id, int n) {
+    const int *near = scheduler_state.cpus[cpu_id].near;
+    return near ? near[n - 1] : (cpu_id + n) % scheduler_state.cpu_count;
+}
+
+// Pick a run queue for a new or re-homed entry: its hint, else the least loaded
+static int sched_place(const sched_entry_t *entry) {
+    if (entry->cpu_hint >= 0 && entry->cpu_hint < scheduler_state.cpu_count) {
+        return entry->cpu_hint;
+    }
+
+    int best = 0;
+    uint32_t best_load = UINT32_MAX;
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        uint32_t load = __atomic_load_n(&scheduler_state.cpus[i].nr_running, __ATOMIC_RELAXED);
+        if (load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+// Pull one queued process from another CPU onto this one. Takes the
+// highest-priority entry that is neither running there nor pinned. Nearer
+// CPUs are robbed first; a process kept next to its IPC peer is only taken
+// across caches when its queue is backed up (second pass).
+static bool sched_steal(int self) {
+    sched_cpu_t *me = &scheduler_state.cpus[self];
+
+    for (int pass = 0; pass < 2; pass++) {
+        for (int n = 1; n < scheduler_state.cpu_count; n++) {
+            int victim_id = sched_near(self, n);
+            sched_cpu_t *victim = &scheduler_state.cpus[victim_id];
+            uint32_t backlog = __atomic_load_n(&victim->nr_running, __ATOMIC_RELAXED);
+            if (backlog < 2 || (pass == 1 && backlog < 3)) {
+                continue;
+            }
+
+            // Lock both queues in index order
+            sched_cpu_t *first = self < victim_id ? me : victim;
+            sched_cpu_t *second = self < victim_id ? victim : me;
+            pthread_mutex_lock(&first->lock);
+            pthread_mutex_lock(&second->lock);
+
+            uint32_t stolen = SCHED_NIL;
+            for (uint32_t groups = victim->group_bitmap; groups && stolen == SCHED_NIL; groups &= groups - 1) {
+                sched_group_rq_t *grq = &victim->groups[__builtin_ctz(groups)];
+                uint64_t bitmap = grq->ready_bitmap;
+                while (bitmap && stolen == SCHED_NIL) {
+                    int priority = __builtin_ctzll(bitmap);
+                    bitmap &= bitmap - 1;
+                    for (uint32_t slot = grq->queues[priority].tail; slot != SCHED_NIL; slot = sched_entry(slot)->prev) {
+                        sched_entry_t *entry = sched_entry(slot);
+                        if (slot == victim->current_process || entry->pinned) {
+                            continue;
+                        }
+                        if (pass == 0 && entry->ipc_home >= 0 &&
+                            sched_cpu_distance(self, entry->ipc_home) > SCHED_CACHE_DISTANCE) {
+                            continue;
+                        }
+                        stolen = slot;
+                        break;
+                    }
+                }
+            }
+
+            if (stolen != SCHED_NIL) {
+                sched_dequeue(victim, stolen);
+                __atomic_store_n(&sched_entry(stolen)->cpu, self, __ATOMIC_RELEASE);
+                sched_enqueue(me, stolen);
+                me->stats.steals++;
+            }
+
+            pthread_mutex_unlock(&second->lock);
+            pthread_mutex_unlock(&first->lock);
+
+            if (stolen != SCHED_NIL) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// Work was queued on busy_id: if it has more than it can run, wake one
+// parked vCPU to steal the surplus. Call without any run queue lock held.
+static void sched_kick_idle(int busy_id) {
+    if (__atomic_load_n(&scheduler_state.idle_cpus, __ATOMIC_SEQ_CST) == 0 ||
+        __atomic_load_n(&scheduler_state.cpus[busy_id].nr_running, __ATOMIC_RELAXED) < 2) {
+        return;
+    }
+
+    for (int n = 1; n < scheduler_state.cpu_count; n++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[sched_near(busy_id, n)];
+        if (!__atomic_load_n(&cpu->idle, __ATOMIC_SEQ_CST)) {
+            continue;
+        }
+
+        pthread_mutex_lock(&cpu->lock);
+        bool kicked = cpu->idle;
+        if (kicked) {
+            __atomic_store_n(&cpu->idle, false, __ATOMIC_SEQ_CST);
+            pthread_cond_signal(&cpu->work);
+        }
+        pthread_mutex_unlock(&cpu->lock);
+        if (kicked) {
+            return;
+        }
+    }
+}
+
+// Park an idle vCPU until work is queued on it or it is kicked to steal.
+// No timeout: the CPU advertises itself idle before its last steal attempt,
+// so any later enqueue elsewhere finds it and kicks it. The one deadline
+// is throttle_until_ns (0 = none), when a capped group's budget refills.
+static void sched_idle(int cpu_id, uint64_t throttle_until_ns) {
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    struct timespec deadline = {
+        (time_t)(throttle_until_ns / 1000000000ULL), (long)(throttle_until_ns % 1000000000ULL)
+    };
+
+    pthread_mutex_lock(&cpu->lock);
+    __atomic_store_n(&cpu->idle, true, __ATOMIC_SEQ_CST);
+    cpu->stats.idle_parks++;
+    pthread_mutex_unlock(&cpu->lock);
+    __atomic_add_fetch(&scheduler_state.idle_cpus, 1, __ATOMIC_SEQ_CST);
+
+    bool stole = sched_steal(cpu_id);
+
+    pthread_mutex_lock(&cpu->lock);
+    while (!stole && cpu->idle && __atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE)) {
+        uint64_t now_ns = sched_clock_ns();
+        if (cpu->dl_head != SCHED_NIL || sched_pick_group(cpu, now_ns, NULL) >= 0 ||
+            (throttle_until_ns != 0 && now_ns >= throttle_until_ns)) {
+            break;
+        }
+        if (throttle_until_ns != 0) {
+            pthread_cond_timedwait(&cpu->work, &cpu->lock, &deadline);
+        } else {
+            pthread_cond_wait(&cpu->work, &cpu->lock);
+        }
+    }
+    __atomic_store_n(&cpu->idle, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&cpu->lock);
+    __atomic_sub_fetch(&scheduler_state.idle_cpus, 1, __ATOMIC_SEQ_CST);
+}
+
+// Quantum expired on a CPU: charge the current process and rotate it
+// behind its peers (a deadline task keeps its place until its budget is
+// gone). The earliest-deadline task runs first; otherwise pick the group
+// with the least weighted runtime and take the head of its highest
+// non-empty priority. Returns the new current slot, marked dispatching if
+// the caller is about to dispatch it; if only throttled groups or deadline
+// tasks are left, *throttle_until_ns is set to when the first of them may
+// run again.
+static uint32_t sched_cpu_switch(int cpu_id, bool dispatch, uint64_t *throttle_until_ns) {
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    uint64_t now_ns = sched_clock_ns();
+
+    pthread_mutex_lock(&cpu->lock);
+    __atomic_store_n(&cpu->need_resched, false, __ATOMIC_RELAXED);
+    sched_dl_replenish(cpu, now_ns);
+
+    uint32_t previous = cpu->current_process;
+    uint32_t current = previous;
+    if (current != SCHED_NIL) {
+        sched_entry_t *entry = sched_entry(current);
+        uint64_t ran_ns = now_ns - cpu->switched_ns;
+        sched_charge(cpu, current, ran_ns);
+        cpu->current_process = SCHED_NIL;
+        if (!entry->queued) {
+            // Stopped itself (or was stopped) while on the vCPU
+            entry->stats.voluntary_switches++;
+            cpu->stats.latency.voluntary_switches++;
+        } else {
+            if (!entry->dl_period_ns) {
+                sched_dequeue(cpu, current);
+                sched_enqueue(cpu, current);
+            }
+            entry->runnable_ns = now_ns;
+        }
+        if (entry->dl_period_ns) {
+            sched_dl_charge(cpu, current, ran_ns, now_ns);
+        }
+    }
+    sched_dl_set_timer(cpu);
+
+    if (cpu->group_bitmap == 0 && cpu->dl_head == SCHED_NIL) {
+        uint64_t release_ns = cpu->dl_next_release;
+        pthread_mutex_unlock(&cpu->lock);
+
+        // Idle: look for work on busier CPUs
+        if (!sched_steal(cpu_id)) {
+            if (throttle_until_ns && release_ns != UINT64_MAX) {
+                *throttle_until_ns = release_ns;
+            }
+            return SCHED_NIL;
+        }
+        pthread_mutex_lock(&cpu->lock);
+    }
+
+    uint32_t depth = __atomic_load_n(&cpu->nr_running, __ATOMIC_RELAXED);
+    cpu->stats.switches++;
+    cpu->stats.depth_total += depth;
+    if (depth > cpu->stats.max_nr_running) {
+        cpu->stats.max_nr_running = depth;
+    }
+
+    uint64_t until_ns = cpu->dl_next_release;
+    current = cpu->dl_head;
+    if (current == SCHED_NIL) {
+        int group = sched_pick_group(cpu, now_ns, &until_ns);
+        if (group >= 0) {
+            sched_group_rq_t *grq = &cpu->groups[group];
+            current = grq->queues[__builtin_ctzll(grq->ready_bitmap)].head;
+            if (grq->vruntime > cpu->min_vruntime) {
+                cpu->min_vruntime = grq->vruntime;
+            }
+        }
+    }
+    if (current != SCHED_NIL) {
+        cpu->current_process = current;
+        cpu->switched_ns = now_ns;
+
+        sched_entry_t *entry = sched_entry(current);
+        entry->dispatching = dispatch;
+        uint64_t wait_ns = now_ns > entry->runnable_ns ? now_ns - entry->runnable_ns : 0;
+        sched_record_wait(&entry->stats, wait_ns);
+        sched_record_wait(&cpu->stats.latency, wait_ns);
+        if (previous != SCHED_NIL && previous != current && sched_entry(previous)->queued) {
+            sched_entry(previous)->stats.involuntary_switches++;
+            cpu->stats.latency.involuntary_switches++;
+        }
+        sched_dl_set_timer(cpu);
+    } else {
+        if (throttle_until_ns && until_ns != UINT64_MAX) {
+            *throttle_until_ns = until_ns;
+        }
+    }
+    pthread_mutex_unlock(&cpu->lock);
+
+    return current;
+}
+
+// Return an unused slot to the free list (table_lock held)
+static void sched_free_slot(uint32_t slot) {
+    sched_entry_t *entry = sched_entry(slot);
+    memset(entry, 0, sizeof(sched_entry_t));
+    entry->next = scheduler_state.free_head;
+    scheduler_state.free_head = slot;
+}
+
+// The vCPU got the process back from dispatch; if it was removed
+// meanwhile, the slot is only now safe to reuse
+static void sched_dispatch_done(uint32_t slot) {
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    entry->dispatching = false;
+    bool dying = entry->dying;
+    pthread_mutex_unlock(&cpu->lock);
+
+    if (dying) {
+        pthread_mutex_lock(&scheduler_state.table_lock);
+        sched_free_slot(slot);
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+    }
+}
+
+// Bind the calling thread to a set of host CPUs
+static int sched_pin_thread(const int *host_cpus, int count) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < count; i++) {
+        CPU_SET(host_cpus[i], &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)host_cpus;
+    (void)count;
+    return -1;
+#endif
+}
+
+// vCPU host thread: run one quantum at a time on this CPU's queue
+static void *sched_cpu_main(void *arg) {
+    int cpu_id = (int)(intptr_t)arg;
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    sched_this_cpu = cpu_id;
+    if (cpu->host.cpu >= 0) {
+        int host_cpu = cpu->host.cpu;
+        sched_pin_thread(&host_cpu, 1);
+    }
+
+    while (__atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE)) {
+        uint64_t throttle_until_ns = 0;
+        uint32_t slot = sched_cpu_switch(cpu_id, true, &throttle_until_ns);
+
+        if (slot == SCHED_NIL) {
+            // Nothing runnable here or elsewhere: sleep until work is queued
+            sched_idle(cpu_id, throttle_until_ns);
+            continue;
+        }
+
+        if (scheduler_state.dispatch) {
+            scheduler_state.dispatch(&sched_entry(slot)->process, cpu_id);
+        } else {
+            // No execution backend: the process holds the vCPU for a quantum
+            scheduler_hold_cpu(cpu_id);
+        }
+        sched_dispatch_done(slot);
+        cpu->tick_count += scheduler_state.quantum_ticks;
+    }
+
+    return NULL;
+}
+
+// Initialize scheduler
+int scheduler_init(void) {
+    return scheduler_init_cpus(1);
+}
+
+// Initialize scheduler with cpu_count run queues
+int scheduler_init_cpus(int cpu_count) {
+    printf("Initializing scheduler...\n");
+
+    if (cpu_count < 1 || cpu_count > MIRIX_SCHED_MAX_CPUS) {
+        return -1;
+    }
+
+    scheduler_state.cpus = calloc((size_t)cpu_count, sizeof(sched_cpu_t));
+    if (!scheduler_state.cpus) {
+        return -1;
+    }
+    scheduler_state.cpu_count = cpu_count;
+
+    // Idle waits for a throttled group time out on the monotonic clock
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+
+    for (int i = 0; i < cpu_count; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        pthread_mutex_init(&cpu->lock, NULL);
+        pthread_cond_init(&cpu->work, &cond_attr);
+        for (int g = 0; g < MIRIX_SCHED_MAX_GROUPS; g++) {
+            for (int p = 0; p < MIRIX_SCHED_PRIORITIES; p++) {
+                cpu->groups[g].queues[p].head = SCHED_NIL;
+                cpu->groups[g].queues[p].tail = SCHED_NIL;
+            }
+        }
+        cpu->current_process = SCHED_NIL;
+        cpu->dl_head = SCHED_NIL;
+        cpu->dl_throttled = SCHED_NIL;
+        cpu->dl_next_release = UINT64_MAX;
+        cpu->resched_at_ns = UINT64_MAX;
+        cpu->host.cpu = -1;
+    }
+    pthread_condattr_destroy(&cond_attr);
+    scheduler_state.service_cpu_count = 0;
+
+    // Everything without a timeshare rule shares the default group
+    memset(scheduler_state.groups, 0, sizeof(scheduler_state.groups));
+    strcpy(scheduler_state.groups[0].name, "default");
+    scheduler_state.groups[0].weight = MIRIX_SCHED_DEFAULT_WEIGHT;
+    scheduler_state.group_count = 1;
+    scheduler_state.member_count = 0;
+
+    scheduler_state.free_head = SCHED_NIL;
+    if (sched_resize(MIRIX_SCHED_INITIAL_PROCESSES) != 0) {
+        scheduler_cleanup();
+        return -1;
+    }
+    scheduler_state.num_processes = 0;
+    scheduler_state.quantum_ticks = 1000; // 1ms quantum
+
+    printf("Scheduler initialized (%d CPU%s)\n", cpu_count, cpu_count == 1 ? "" : "s");
+    return 0;
+}
+
+// Start one vCPU host thread per run queue
+int scheduler_start(void) {
+    if (!scheduler_state.cpus || __atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    __atomic_store_n(&scheduler_state.running, true, __ATOMIC_RELEASE);
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        if (pthread_create(&cpu->thread, NULL, sched_cpu_main, (void*)(intptr_t)i) != 0) {
+            scheduler_stop();
+            return -1;
+        }
+        cpu->thread_started = true;
+    }
+
+    return 0;
+}
+
+// Stop and join the vCPU threads
+void scheduler_stop(void) {
+    if (!scheduler_state.cpus) {
+        return;
+    }
+
+    __atomic_store_n(&scheduler_state.running, false, __ATOMIC_RELEASE);
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        pthread_mutex_lock(&cpu->lock);
+        pthread_cond_broadcast(&cpu->work);
+        pthread_mutex_unlock(&cpu->lock);
+    }
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        if (cpu->thread_started) {
+            pthread_join(cpu->thread, NULL);
+            cpu->thread_started = false;
+        }
+    }
+}
+
+// Install the function vCPUs call to run a process for one quantum
+void scheduler_set_dispatch(scheduler_dispatch_fn dispatch) {
+    scheduler_state.dispatch = dispatch;
+}
+
+// Whether the process on a vCPU must give it back before its quantum ends
+bool scheduler_need_resched(int cpu_id) {
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    if (__atomic_load_n(&cpu->need_resched, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+    uint64_t at = __atomic_load_n(&cpu->resched_at_ns, __ATOMIC_ACQUIRE);
+    return at != UINT64_MAX && sched_clock_ns() >= at;
+}
+
+// Let the process on a vCPU hold it for a quantum without running anything,
+// returning early when a deadline task needs the vCPU
+void scheduler_hold_cpu(int cpu_id) {
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    uint64_t until_ns = sched_clock_ns() + MIRIX_SCHED_QUANTUM_US * 1000ULL;
+
+    pthread_mutex_lock(&cpu->lock);
+    uint64_t at = __atomic_load_n(&cpu->resched_at_ns, __ATOMIC_ACQUIRE);
+    if (at < until_ns) {
+        until_ns = at;
+    }
+    struct timespec deadline = { (time_t)(until_ns / 1000000000ULL), (long)(until_ns % 1000000000ULL) };
+    while (!__atomic_load_n(&cpu->need_resched, __ATOMIC_ACQUIRE) &&
+           __atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE) && sched_clock_ns() < until_ns) {
+        pthread_cond_timedwait(&cpu->work, &cpu->lock, &deadline);
+    }
+    pthread_mutex_unlock(&cpu->lock);
+}
+
+// Scheduler tick for callers driving a CPU by hand (no vCPU threads)
+void scheduler_tick(void) {
+    if (!scheduler_state.cpus || __atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    sched_cpu_t *cpu = &scheduler_state.cpus[sched_this_cpu];
+    cpu->tick_count++;
+
+    if (cpu->tick_count % scheduler_state.quantum_ticks == 0) {
+        // Time to switch to next process
+        sched_cpu_switch(sched_this_cpu, false, NULL);
+    }
+}
+
+// Add new process to scheduler
+int scheduler_add_process(const mirix_process_t *process) {
+    if (!process || process->pid == 0 || !scheduler_state.cpus) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    if (sched_slot_of(process->pid) != SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1; // Already registered
+    }
+
+    if (scheduler_state.free_head == SCHED_NIL) {
+        size_t grown = scheduler_state.max_processes * 2;
+        if (grown > MIRIX_SCHED_MAX_PROCESSES || sched_resize(grown) != 0) {
+            pthread_mutex_unlock(&scheduler_state.table_lock);
+            return -1; // No free slots
+        }
+    }
+
+    uint32_t slot = scheduler_state.free_head;
+    sched_entry_t *entry = sched_entry(slot);
+    scheduler_state.free_head = entry->next;
+
+    memcpy(&entry->process, process, sizeof(mirix_process_t));
+    if (entry->process.priority < 0 || entry->process.priority >= MIRIX_SCHED_PRIORITIES) {
+        entry->process.priority = MIRIX_SCHED_DEFAULT_PRIORITY;
+    }
+    entry->queued = false;
+    entry->cpu_hint = -1;
+    entry->pinned = false;
+    entry->group = 0;
+    entry->ipc_peer = 0;
+    entry->ipc_score = 0;
+    entry->ipc_home = -1;
+    entry->dl_period_ns = 0;
+    entry->dl_throttled = false;
+    for (int i = 0; i < scheduler_state.member_count; i++) {
+        if (strcmp(scheduler_state.members[i].name, entry->process.name) == 0) {
+            entry->group = scheduler_state.members[i].group;
+            break;
+        }
+    }
+    int cpu_id = sched_place(entry);
+    entry->cpu = cpu_id;
+    scheduler_state.pid_index[sched_pid_probe(process->pid)] = slot;
+    scheduler_state.num_processes++;
+
+    if (entry->process.status == MIRIX_KERNEL_RUNNING) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+        pthread_mutex_lock(&cpu->lock);
+        entry->runnable_ns = sched_clock_ns();
+        sched_enqueue(cpu, slot);
+        pthread_cond_signal(&cpu->work);
+        pthread_mutex_unlock(&cpu->lock);
+    }
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    sched_kick_idle(cpu_id);
+
+    printf("Process added to scheduler: PID %u\n", process->pid);
+    return 0;
+}
+
+// Remove process from scheduler
+int scheduler_remove_process(uint32_t pid) {
+    if (!scheduler_state.cpus || pid == 0) {
+        return -1;
+    }
 
-// Initialize scheduler
-int scheduler_init(void) {
-    printf("Initializing scheduler...\n");
-    
-    scheduler_state.max_processes = 256;
-    scheduler_state.processes = calloc(scheduler_state.max_processes, sizeof(mirix_process_t));
-    if (!scheduler_state.processes) {
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    size_t pos = sched_pid_probe(pid);
+    uint32_t slot = scheduler_state.pid_index[pos];
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1; // Process not found
+    }
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    if (entry->queued) {
+        sched_dequeue(cpu, slot);
+    }
+    if (cpu->current_process == slot) {
+        cpu->current_process = SCHED_NIL;
+    }
+    if (entry->dl_period_ns) {
+        cpu->dl_bw -= entry->dl_density;
+    }
+    // A vCPU still inside dispatch for it frees the slot when it returns
+    bool dispatching = entry->dispatching;
+    entry->dying = dispatching;
+    pthread_mutex_unlock(&cpu->lock);
+
+    sched_pid_erase(pos);
+    if (!dispatching) {
+        sched_free_slot(slot);
+    }
+    scheduler_state.num_processes--;
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+
+    printf("Process removed from scheduler: PID %u\n", pid);
+    return 0;
+}
+
+// Change a process's status; only MIRIX_KERNEL_RUNNING processes are queued
+int scheduler_set_status(uint32_t pid, mirix_kernel_status_t status) {
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
         return -1;
     }
-    
-    scheduler_state.current_process = 0;
-    scheduler_state.quantum_ticks = 1000; // 1ms quantum
-    scheduler_state.tick_count = 0;
-    
-    printf("Scheduler initialized\n");
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    entry->process.status = status;
+
+    bool woken = status == MIRIX_KERNEL_RUNNING && !entry->queued;
+    if (woken) {
+        entry->runnable_ns = sched_clock_ns();
+        sched_enqueue(cpu, slot);
+        pthread_cond_signal(&cpu->work);
+    } else if (status != MIRIX_KERNEL_RUNNING && entry->queued) {
+        sched_dequeue(cpu, slot);
+    }
+
+    pthread_mutex_unlock(&cpu->lock);
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    if (woken) {
+        sched_kick_idle((int)(cpu - scheduler_state.cpus));
+    }
     return 0;
 }
 
-// Scheduler tick - called from kernel main loop
-void scheduler_tick(void) {
-    scheduler_state.tick_count++;
-    
-    // Simple round-robin scheduling
-    if (scheduler_state.tick_count % scheduler_state.quantum_ticks == 0) {
-        // Time to switch to next process
-        scheduler_state.current_process = (scheduler_state.current_process + 1) % scheduler_state.max_processes;
-        
-        // Find next runnable process
-        while (scheduler_state.processes[scheduler_state.current_process].status != MIRIX_KERNEL_RUNNING) {
-            scheduler_state.current_process = (scheduler_state.current_process + 1) % scheduler_state.max_processes;
-            
-            // If we've looped back to the start, break to avoid infinite loop
-            if (scheduler_state.current_process == 0) {
-                break;
+// Move a process to another priority level
+int scheduler_set_priority(uint32_t pid, int priority) {
+    if (priority < 0 || priority >= MIRIX_SCHED_PRIORITIES) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    bool queued = entry->queued;
+    if (queued) {
+        sched_dequeue(cpu, slot);
+    }
+    entry->process.priority = priority;
+    if (queued) {
+        sched_enqueue(cpu, slot);
+    }
+
+    pthread_mutex_unlock(&cpu->lock);
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return 0;
+}
+
+// Move a process to another fair-share group
+int scheduler_set_group(uint32_t pid, int group) {
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL || group < 0 || group >= scheduler_state.group_count) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    bool queued = entry->queued;
+    if (queued) {
+        sched_dequeue(cpu, slot);
+    }
+    entry->group = group;
+    if (queued) {
+        sched_enqueue(cpu, slot);
+    }
+
+    pthread_mutex_unlock(&cpu->lock);
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return 0;
+}
+
+// Add a fair-share group, or update the weight and cap of an existing one.
+// Returns the group id.
+int scheduler_add_group(const char *name, uint32_t weight, uint32_t cap_percent) {
+    if (!name || !*name || strlen(name) >= MIRIX_SCHED_GROUP_NAME_MAX ||
+        weight < MIRIX_SCHED_MIN_WEIGHT || weight > MIRIX_SCHED_MAX_WEIGHT) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    int group = 0;
+    while (group < scheduler_state.group_count && strcmp(scheduler_state.groups[group].name, name) != 0) {
+        group++;
+    }
+    if (group == MIRIX_SCHED_MAX_GROUPS) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    // vCPUs read weight and quota without the table lock
+    sched_group_t *g = &scheduler_state.groups[group];
+    if (group == scheduler_state.group_count) {
+        strcpy(g->name, name);
+    }
+    __atomic_store_n(&g->weight, weight, __ATOMIC_RELAXED);
+    g->cap_percent = cap_percent;
+    __atomic_store_n(&g->quota_ns, (uint64_t)cap_percent * MIRIX_SCHED_CAP_PERIOD_US * 1000ULL / 100, __ATOMIC_RELAXED);
+    if (group == scheduler_state.group_count) {
+        // Publish only once the group is filled in
+        __atomic_store_n(&scheduler_state.group_count, group + 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return group;
+}
+
+// Look up a group id by name
+int scheduler_find_group(const char *name) {
+    int count = __atomic_load_n(&scheduler_state.group_count, __ATOMIC_ACQUIRE);
+    for (int group = 0; name && group < count; group++) {
+        if (strcmp(scheduler_state.groups[group].name, name) == 0) {
+            return group;
+        }
+    }
+    return -1;
+}
+
+// Split a timeshare line into whitespace-separated words; returns the count
+static int sched_split_words(char *line, char **words, int max_words) {
+    int count = 0;
+    char *p = line;
+
+    while (count < max_words) {
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0' || *p == '#') {
+            break;
+        }
+        words[count++] = p;
+        while (*p && !isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p) {
+            *p++ = '\0';
+        }
+    }
+    return count;
+}
+
+// Parse an unsigned decimal that must make up the whole word
+static bool sched_parse_uint(const char *word, uint32_t max, uint32_t *value) {
+    char *end;
+    unsigned long parsed = strtoul(word, &end, 10);
+    if (*word == '-' || *end != '\0' || end == word || parsed > max) {
+        return false;
+    }
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+// Load fair-share groups from a timeshare file (see scheduler.h for the
+// format). Existing processes keep their group; rules apply to processes
+// added afterwards.
+int scheduler_load_timeshare(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+
+    char line[512];
+    int line_no = 0;
+    int result = 0;
+    while (result == 0 && fgets(line, sizeof(line), file)) {
+        line_no++;
+
+        char *words[5];
+        int count = sched_split_words(line, words, 5);
+        if (count == 0) {
+            continue;
+        }
+
+        if (strcmp(words[0], "group") == 0 && (count == 3 || count == 4)) {
+            uint32_t weight;
+            uint32_t cap = 0;
+            if (!sched_parse_uint(words[2], MIRIX_SCHED_MAX_WEIGHT, &weight) ||
+                (count == 4 && !sched_parse_uint(words[3], 100 * MIRIX_SCHED_MAX_CPUS, &cap)) ||
+                scheduler_add_group(words[1], weight, cap) < 0) {
+                result = -1;
+            }
+        } else if (strcmp(words[0], "member") == 0 && count == 3) {
+            int group = scheduler_find_group(words[1]);
+            pthread_mutex_lock(&scheduler_state.table_lock);
+            if (group < 0 || strlen(words[2]) >= sizeof(scheduler_state.members[0].name) ||
+                scheduler_state.member_count == SCHED_MAX_MEMBERS) {
+                result = -1;
+            } else {
+                sched_member_t *member = &scheduler_state.members[scheduler_state.member_count++];
+                strcpy(member->name, words[2]);
+                member->group = group;
             }
+            pthread_mutex_unlock(&scheduler_state.table_lock);
+        } else {
+            result = -1;
         }
+
+        if (result != 0) {
+            fprintf(stderr, "%s:%d: invalid timeshare entry\n", path, line_no);
+        }
+    }
+
+    fclose(file);
+    if (result == 0) {
+        printf("Timeshare: %d group%s from %s\n", scheduler_state.group_count,
+               scheduler_state.group_count == 1 ? "" : "s", path);
     }
+    return result;
 }
 
-// Add new process to scheduler
-int scheduler_add_process(const mirix_process_t *process) {
-    if (!process) {
+// Move an entry to another run queue now unless it is running or in the
+// deadline class; a running process moves at its next switch. The caller holds table_lock, so
+// set_status cannot requeue the entry while it is between the queues.
+static bool sched_migrate(uint32_t slot, int target_id) {
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    // Deadline tasks stay on the vCPU that admitted their bandwidth
+    if (entry->cpu == target_id || cpu->current_process == slot || entry->dl_period_ns) {
+        pthread_mutex_unlock(&cpu->lock);
+        return false;
+    }
+
+    bool queued = entry->queued;
+    if (queued) {
+        sched_dequeue(cpu, slot);
+    }
+    pthread_mutex_unlock(&cpu->lock);
+
+    sched_cpu_t *target = &scheduler_state.cpus[target_id];
+    pthread_mutex_lock(&target->lock);
+    __atomic_store_n(&entry->cpu, target_id, __ATOMIC_RELEASE);
+    if (queued) {
+        sched_enqueue(target, slot);
+        pthread_cond_signal(&target->work);
+    }
+    pthread_mutex_unlock(&target->lock);
+    return true;
+}
+
+// Set a process's CPU affinity hint (-1 clears it). A pinned process stays
+// on that CPU; otherwise it starts there but idle CPUs may steal it.
+int scheduler_set_affinity(uint32_t pid, int cpu_hint, bool pinned) {
+    if (cpu_hint >= scheduler_state.cpu_count || (pinned && cpu_hint < 0)) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    entry->cpu_hint = cpu_hint < 0 ? -1 : cpu_hint;
+    entry->pinned = pinned;
+    pthread_mutex_unlock(&cpu->lock);
+
+    if (cpu_hint >= 0) {
+        sched_migrate(slot, cpu_hint);
+    }
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return 0;
+}
+
+// Whether a vCPU has room for density more of deadline tasks
+static bool sched_dl_fits(int cpu_id, uint64_t density, uint64_t limit) {
+    return scheduler_state.cpus[cpu_id].dl_bw + density <= limit;
+}
+
+// Admit a process to the deadline class (see scheduler.h). Tasks are
+// partitioned: each stays on one vCPU, tried first where it is, then the
+// vCPU with the least deadline load, and EDF on each vCPU meets every
+// deadline as long as its densities sum to at most one vCPU.
+int scheduler_set_deadline(uint32_t pid, uint64_t runtime_us, uint64_t deadline_us, uint64_t period_us) {
+    if (deadline_us == 0) {
+        deadline_us = period_us;
+    }
+    if (!scheduler_state.cpus ||
+        (runtime_us != 0 && (runtime_us < MIRIX_SCHED_DL_MIN_RUNTIME_US || runtime_us > deadline_us ||
+                             deadline_us > period_us || period_us > MIRIX_SCHED_DL_MAX_PERIOD_US))) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    // dl_bw only changes under table_lock, so other vCPUs' loads can be
+    // read without their locks
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    int from_id = (int)(cpu - scheduler_state.cpus);
+    uint64_t density = runtime_us ? (runtime_us << SCHED_DL_SHIFT) / deadline_us : 0;
+    uint64_t limit = ((uint64_t)MIRIX_SCHED_DL_MAX_PERCENT << SCHED_DL_SHIFT) / 100;
+    if (entry->dl_period_ns) {
+        cpu->dl_bw -= entry->dl_density;
+    }
+
+    // A running process cannot leave its vCPU before its next switch
+    bool stuck = entry->pinned || cpu->current_process == slot;
+    int target_id = -1;
+    if (density == 0 || sched_dl_fits(from_id, density, limit)) {
+        target_id = from_id;
+    } else if (!stuck) {
+        for (int i = 0; i < scheduler_state.cpu_count; i++) {
+            if (sched_dl_fits(i, density, limit) &&
+                (target_id < 0 || scheduler_state.cpus[i].dl_bw < scheduler_state.cpus[target_id].dl_bw)) {
+                target_id = i;
+            }
+        }
+    }
+    if (target_id < 0) {
+        if (entry->dl_period_ns) {
+            cpu->dl_bw += entry->dl_density;
+        }
+        pthread_mutex_unlock(&cpu->lock);
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1; // Not schedulable
+    }
+
+    bool queued = entry->queued;
+    if (queued) {
+        sched_dequeue(cpu, slot);
+    }
+    if (target_id != from_id) {
+        pthread_mutex_unlock(&cpu->lock);
+        cpu = &scheduler_state.cpus[target_id];
+        pthread_mutex_lock(&cpu->lock);
+        __atomic_store_n(&entry->cpu, target_id, __ATOMIC_RELEASE);
+    }
+    entry->dl_runtime_ns = runtime_us * 1000;
+    entry->dl_deadline_ns = deadline_us * 1000;
+    entry->dl_period_ns = runtime_us ? period_us * 1000 : 0;
+    entry->dl_density = density;
+    entry->dl_abs_deadline = 0;
+    entry->dl_release = 0;
+    entry->dl_budget = 0;
+    cpu->dl_bw += density;
+    if (queued) {
+        sched_enqueue(cpu, slot);
+        pthread_cond_signal(&cpu->work);
+    }
+    pthread_mutex_unlock(&cpu->lock);
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return 0;
+}
+
+// Placement order: NUMA node, package, then every core's first hardware
+// thread before any SMT sibling, keeping cores that share an L3/L2 together
+static int sched_host_order(const void *a, const void *b) {
+    const arch_cpu_topology_t *x = a;
+    const arch_cpu_topology_t *y = b;
+    int32_t keys_x[] = { x->numa_node, x->package_id, (int32_t)x->smt_index, x->l3_id, x->l2_id, x->core_id, x->cpu };
+    int32_t keys_y[] = { y->numa_node, y->package_id, (int32_t)y->smt_index, y->l3_id, y->l2_id, y->core_id, y->cpu };
+    for (size_t i = 0; i < sizeof(keys_x) / sizeof(keys_x[0]); i++) {
+        if (keys_x[i] != keys_y[i]) {
+            return keys_x[i] < keys_y[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static int sched_near_cpu;
+
+// Steal order: nearer vCPUs first, round-robin from the owner among equals
+static int sched_near_order(const void *a, const void *b) {
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    int dx = sched_cpu_distance(sched_near_cpu, x);
+    int dy = sched_cpu_distance(sched_near_cpu, y);
+    if (dx != dy) {
+        return dx - dy;
+    }
+    int n = scheduler_state.cpu_count;
+    return (x - sched_near_cpu + n) % n - (y - sched_near_cpu + n) % n;
+}
+
+// Assign host CPUs to the vCPUs from the host topology
+int scheduler_set_topology(const arch_topology_t *topology) {
+    if (!topology || !scheduler_state.cpus || __atomic_load_n(&scheduler_state.running, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+
+    int n = scheduler_state.cpu_count;
+    arch_cpu_topology_t *order = malloc(sizeof(arch_cpu_topology_t) * (topology->num_cpus ? topology->num_cpus : 1));
+    if (!order) {
+        return -1;
+    }
+
+    // Only CPUs this process may run on (taskset, cgroup cpusets)
+    int usable = 0;
+#ifdef __linux__
+    cpu_set_t allowed;
+    bool have_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+#endif
+    for (uint32_t i = 0; i < topology->num_cpus; i++) {
+#ifdef __linux__
+        if (have_allowed && (topology->cpus[i].cpu >= CPU_SETSIZE || !CPU_ISSET(topology->cpus[i].cpu, &allowed))) {
+            continue;
+        }
+#endif
+        order[usable++] = topology->cpus[i];
+    }
+
+    if (usable < n) {
+        // Overcommitted: pinning would stack vCPUs on one host CPU
+        printf("Scheduler: %d vCPUs on %d host CPUs, leaving placement to the host\n", n, usable);
+        free(order);
+        return 0;
+    }
+
+    qsort(order, (size_t)usable, sizeof(arch_cpu_topology_t), sched_host_order);
+    for (int i = 0; i < n; i++) {
+        scheduler_state.cpus[i].host = order[i];
+    }
+
+    // Service threads get the spare CPUs of the first vCPU's package
+    scheduler_state.service_cpu_count = 0;
+    for (int i = n; i < usable && scheduler_state.service_cpu_count < MIRIX_SCHED_MAX_CPUS; i++) {
+        if (order[i].package_id == order[0].package_id) {
+            scheduler_state.service_cpus[scheduler_state.service_cpu_count++] = order[i].cpu;
+        }
+    }
+    free(order);
+
+    for (int i = 0; i < n; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        free(cpu->near);
+        cpu->near = NULL;
+        if (n < 2) {
+            continue;
+        }
+        cpu->near = malloc(sizeof(int) * (size_t)(n - 1));
+        if (!cpu->near) {
+            continue; // Falls back to round-robin
+        }
+        for (int k = 1; k < n; k++) {
+            cpu->near[k - 1] = (i + k) % n;
+        }
+        sched_near_cpu = i;
+        qsort(cpu->near, (size_t)(n - 1), sizeof(int), sched_near_order);
+    }
+
+    printf("Scheduler: %d vCPUs pinned across %u package%s (%u cores, %u CPUs)\n", n,
+           topology->num_packages, topology->num_packages == 1 ? "" : "s",
+           topology->num_cores, topology->num_cpus);
+    return 0;
+}
+
+// Pin a service thread (host event loop and the like) next to the vCPUs
+int scheduler_pin_service_thread(void) {
+    if (scheduler_state.service_cpu_count == 0) {
         return -1;
     }
-    
-    // Find empty slot
-    for (size_t i = 0; i < scheduler_state.max_processes; i++) {
-        if (scheduler_state.processes[i].pid == 0) {
-            memcpy(&scheduler_state.processes[i], process, sizeof(mirix_process_t));
-            printf("Process added to scheduler: PID %u\n", process->pid);
-            return 0;
+    return sched_pin_thread(scheduler_state.service_cpus, scheduler_state.service_cpu_count);
+}
+
+// Least loaded vCPU sharing a cache with near_id, other than near_id when
+// possible so the two ends of an IPC pair run side by side
+static int sched_place_near(int near_id) {
+    int best = near_id;
+    uint32_t best_load = UINT32_MAX;
+    for (int n = 1; n < scheduler_state.cpu_count; n++) {
+        int id = sched_near(near_id, n);
+        if (sched_cpu_distance(near_id, id) > SCHED_CACHE_DISTANCE) {
+            break;
+        }
+        uint32_t load = __atomic_load_n(&scheduler_state.cpus[id].nr_running, __ATOMIC_RELAXED);
+        if (load < best_load) {
+            best = id;
+            best_load = load;
         }
     }
-    
-    return -1; // No free slots
+    return best;
 }
 
-// Remove process from scheduler
-int scheduler_remove_process(uint32_t pid) {
-    for (size_t i = 0; i < scheduler_state.max_processes; i++) {
-        if (scheduler_state.processes[i].pid == pid) {
-            memset(&scheduler_state.processes[i], 0, sizeof(mirix_process_t));
-            printf("Process removed from scheduler: PID %u\n", pid);
-            return 0;
+// Count one send out of every MIRIX_SCHED_IPC_SAMPLE
+void scheduler_note_ipc(uint32_t sender_pid, uint32_t receiver_pid) {
+    if ((++sched_ipc_sends & (MIRIX_SCHED_IPC_SAMPLE - 1)) != 0) {
+        return;
+    }
+    scheduler_note_ipc_sample(sender_pid, receiver_pid);
+}
+
+// Count a sampled send and co-locate processes that mostly talk to one peer
+void scheduler_note_ipc_sample(uint32_t sender_pid, uint32_t receiver_pid) {
+    if (!scheduler_state.cpus || scheduler_state.cpu_count < 2 || sender_pid == receiver_pid) {
+        return;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+    uint32_t slot = sched_slot_of(sender_pid);
+    uint32_t peer_slot = sched_slot_of(receiver_pid);
+    if (slot == SCHED_NIL || peer_slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return;
+    }
+
+    // Single-counter heavy hitter: the score only grows while one peer
+    // gets most of the sends
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    if (entry->ipc_peer == receiver_pid) {
+        if (entry->ipc_score < MIRIX_SCHED_IPC_MAX_SCORE) {
+            entry->ipc_score++;
+        }
+    } else if (entry->ipc_score == 0) {
+        entry->ipc_peer = receiver_pid;
+        entry->ipc_score = 1;
+    } else {
+        entry->ipc_score--;
+    }
+
+    bool affine = entry->ipc_peer == receiver_pid && entry->ipc_score >= MIRIX_SCHED_IPC_AFFINE_SCORE;
+    if (!affine) {
+        entry->ipc_home = -1;
+    }
+    int cpu_id = entry->cpu;
+    bool movable = affine && !entry->pinned && entry->cpu_hint < 0;
+    pthread_mutex_unlock(&cpu->lock);
+
+    int peer_cpu = __atomic_load_n(&sched_entry(peer_slot)->cpu, __ATOMIC_ACQUIRE);
+    if (movable && sched_cpu_distance(cpu_id, peer_cpu) > SCHED_CACHE_DISTANCE) {
+        int target_id = sched_place_near(peer_cpu);
+        if (sched_migrate(slot, target_id)) {
+            cpu = sched_lock_entry_cpu(entry);
+            entry->ipc_home = target_id;
+            pthread_mutex_unlock(&cpu->lock);
+
+            sched_cpu_t *target = &scheduler_state.cpus[target_id];
+            pthread_mutex_lock(&target->lock);
+            target->stats.ipc_moves++;
+            pthread_mutex_unlock(&target->lock);
         }
+    } else if (affine) {
+        cpu = sched_lock_entry_cpu(entry);
+        entry->ipc_home = entry->cpu;
+        pthread_mutex_unlock(&cpu->lock);
     }
-    
-    return -1; // Process not found
+
+    pthread_mutex_unlock(&scheduler_state.table_lock);
 }
 
-// Get current process
+// Get the process running on the calling thread's CPU
 mirix_process_t* scheduler_get_current_process(void) {
-    return &scheduler_state.processes[scheduler_state.current_process];
+    if (!scheduler_state.cpus) {
+        return NULL;
+    }
+
+    uint32_t slot = __atomic_load_n(&scheduler_state.cpus[sched_this_cpu].current_process, __ATOMIC_RELAXED);
+    return slot == SCHED_NIL ? NULL : &sched_entry(slot)->process;
+}
+
+// Find a registered process by pid
+mirix_process_t* scheduler_find_process(uint32_t pid) {
+    pthread_mutex_lock(&scheduler_state.table_lock);
+    uint32_t slot = sched_slot_of(pid);
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+
+    return slot == SCHED_NIL ? NULL : &sched_entry(slot)->process;
+}
+
+// Copy one vCPU's counters
+int scheduler_get_cpu_stats(int cpu_id, scheduler_cpu_stats_t *stats) {
+    if (!stats || !scheduler_state.cpus || cpu_id < 0 || cpu_id >= scheduler_state.cpu_count) {
+        return -1;
+    }
+
+    sched_cpu_t *cpu = &scheduler_state.cpus[cpu_id];
+    pthread_mutex_lock(&cpu->lock);
+    *stats = cpu->stats;
+    stats->nr_running = cpu->nr_running;
+    stats->host_cpu = cpu->host.cpu;
+    stats->dl_bandwidth_percent = (uint32_t)((cpu->dl_bw * 100) >> SCHED_DL_SHIFT);
+    pthread_mutex_unlock(&cpu->lock);
+    return 0;
+}
+
+// Copy one process's counters
+int scheduler_get_process_stats(uint32_t pid, scheduler_latency_stats_t *stats) {
+    if (!stats || !scheduler_state.cpus) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+    uint32_t slot = sched_slot_of(pid);
+    if (slot == SCHED_NIL) {
+        pthread_mutex_unlock(&scheduler_state.table_lock);
+        return -1;
+    }
+
+    sched_entry_t *entry = sched_entry(slot);
+    sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+    *stats = entry->stats;
+    pthread_mutex_unlock(&cpu->lock);
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+    return 0;
+}
+
+// Zero every vCPU and process counter
+void scheduler_reset_stats(void) {
+    if (!scheduler_state.cpus) {
+        return;
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+    for (uint32_t slot = 0; slot < scheduler_state.max_processes; slot++) {
+        sched_entry_t *entry = sched_entry(slot);
+        if (entry->process.pid != 0 && !entry->dying) {
+            sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+            memset(&entry->stats, 0, sizeof(entry->stats));
+            pthread_mutex_unlock(&cpu->lock);
+        }
+    }
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        sched_cpu_t *cpu = &scheduler_state.cpus[i];
+        pthread_mutex_lock(&cpu->lock);
+        memset(&cpu->stats, 0, sizeof(cpu->stats));
+        pthread_mutex_unlock(&cpu->lock);
+    }
+}
+
+// Upper bound of the histogram bucket a percentile falls in, in microseconds
+static uint64_t sched_hist_percentile_us(const uint64_t *hist, uint64_t count, unsigned percent) {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < MIRIX_SCHED_HIST_BUCKETS; bucket++) {
+        seen += hist[bucket];
+        if (seen >= rank) {
+            return 2ULL << bucket;
+        }
+    }
+    return 2ULL << (MIRIX_SCHED_HIST_BUCKETS - 1);
+}
+
+static void sched_dump_hist_json(FILE *out, const char *key, const uint64_t *hist) {
+    fprintf(out, ",\"%s\":[", key);
+    for (int bucket = 0; bucket < MIRIX_SCHED_HIST_BUCKETS; bucket++) {
+        fprintf(out, "%s%llu", bucket ? "," : "", (unsigned long long)hist[bucket]);
+    }
+    fprintf(out, "]");
+}
+
+static void sched_dump_latency_json(FILE *out, const scheduler_latency_stats_t *stats) {
+    fprintf(out, ",\"dispatches\":%llu,\"voluntary\":%llu,\"involuntary\":%llu,"
+            "\"wait_ns_total\":%llu,\"wait_ns_max\":%llu,\"run_ns_total\":%llu,\"run_ns_max\":%llu,"
+            "\"deadline_misses\":%llu",
+            (unsigned long long)stats->dispatches, (unsigned long long)stats->voluntary_switches,
+            (unsigned long long)stats->involuntary_switches, (unsigned long long)stats->wait_ns_total,
+            (unsigned long long)stats->wait_ns_max, (unsigned long long)stats->run_ns_total,
+            (unsigned long long)stats->run_ns_max, (unsigned long long)stats->deadline_misses);
+    sched_dump_hist_json(out, "wait_hist_us", stats->wait_hist);
+    sched_dump_hist_json(out, "run_hist_us", stats->run_hist);
+}
+
+static void sched_dump_latency_text(FILE *out, const scheduler_latency_stats_t *stats) {
+    uint64_t n = stats->dispatches;
+    fprintf(out, " %9llu %7llu %7llu  wait avg %6llu p99<%6llu max %7llu  run avg %6llu p99<%6llu\n",
+            (unsigned long long)n, (unsigned long long)stats->voluntary_switches,
+            (unsigned long long)stats->involuntary_switches,
+            (unsigned long long)(n ? stats->wait_ns_total / n / 1000 : 0),
+            (unsigned long long)sched_hist_percentile_us(stats->wait_hist, n, 99),
+            (unsigned long long)(stats->wait_ns_max / 1000),
+            (unsigned long long)(n ? stats->run_ns_total / n / 1000 : 0),
+            (unsigned long long)sched_hist_percentile_us(stats->run_hist, n, 99));
+}
+
+// Print vCPU then per-process counters (times in microseconds in the table)
+void scheduler_dump_stats(FILE *out, bool json) {
+    if (!out || !scheduler_state.cpus) {
+        return;
+    }
+
+    if (!json) {
+        fprintf(out, "%-8s %9s %7s %7s  %s\n", "", "dispatch", "vol", "invol", "latency (us)");
+    }
+
+    for (int i = 0; i < scheduler_state.cpu_count; i++) {
+        scheduler_cpu_stats_t stats;
+        scheduler_get_cpu_stats(i, &stats);
+        uint64_t depth_avg_x100 = stats.switches ? stats.depth_total * 100 / stats.switches : 0;
+
+        if (json) {
+            fprintf(out, "{\"cpu\":%d,\"host_cpu\":%d,\"nr_running\":%u,\"max_nr_running\":%u,\"switches\":%llu,"
+                    "\"depth_total\":%llu,\"steals\":%llu,\"idle_parks\":%llu,\"ipc_moves\":%llu,\"dl_bw_percent\":%u",
+                    i, stats.host_cpu, stats.nr_running, stats.max_nr_running, (unsigned long long)stats.switches,
+                    (unsigned long long)stats.depth_total, (unsigned long long)stats.steals,
+                    (unsigned long long)stats.idle_parks, (unsigned long long)stats.ipc_moves,
+                    stats.dl_bandwidth_percent);
+            sched_dump_latency_json(out, &stats.latency);
+            fprintf(out, "}\n");
+        } else {
+            fprintf(out, "cpu%-5d", i);
+            sched_dump_latency_text(out, &stats.latency);
+            fprintf(out, "%-8s queue %u (avg %llu.%02llu, max %u)  steals %llu  idle parks %llu  ipc moves %llu\n", "",
+                    stats.nr_running, (unsigned long long)(depth_avg_x100 / 100),
+                    (unsigned long long)(depth_avg_x100 % 100), stats.max_nr_running,
+                    (unsigned long long)stats.steals, (unsigned long long)stats.idle_parks,
+                    (unsigned long long)stats.ipc_moves);
+            if (stats.host_cpu >= 0) {
+                fprintf(out, "%-8s host cpu %d\n", "", stats.host_cpu);
+            }
+            if (stats.dl_bandwidth_percent || stats.latency.deadline_misses) {
+                fprintf(out, "%-8s deadline load %u%%  misses %llu\n", "", stats.dl_bandwidth_percent,
+                        (unsigned long long)stats.latency.deadline_misses);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&scheduler_state.table_lock);
+    for (uint32_t slot = 0; slot < scheduler_state.max_processes; slot++) {
+        sched_entry_t *entry = sched_entry(slot);
+        if (entry->process.pid == 0 || entry->dying) {
+            continue;
+        }
+
+        sched_cpu_t *cpu = sched_lock_entry_cpu(entry);
+        scheduler_latency_stats_t stats = entry->stats;
+        int cpu_id = entry->cpu;
+        int group = entry->group;
+        uint64_t dl_us[3] = { entry->dl_runtime_ns / 1000, entry->dl_deadline_ns / 1000, entry->dl_period_ns / 1000 };
+        pthread_mutex_unlock(&cpu->lock);
+
+        if (json) {
+            fprintf(out, "{\"pid\":%u,\"name\":\"", entry->process.pid);
+            for (const char *c = entry->process.name; *c; c++) {
+                if (*c == '"' || *c == '\\') {
+                    fputc('\\', out);
+                }
+                fputc((unsigned char)*c < 0x20 ? '?' : *c, out);
+            }
+            fprintf(out, "\",\"cpu\":%d,\"group\":\"%s\"", cpu_id, scheduler_state.groups[group].name);
+            if (dl_us[2]) {
+                fprintf(out, ",\"dl_runtime_us\":%llu,\"dl_deadline_us\":%llu,\"dl_period_us\":%llu",
+                        (unsigned long long)dl_us[0], (unsigned long long)dl_us[1], (unsigned long long)dl_us[2]);
+            }
+            sched_dump_latency_json(out, &stats);
+            fprintf(out, "}\n");
+        } else {
+            fprintf(out, "pid %-4u", entry->process.pid);
+            sched_dump_latency_text(out, &stats);
+            if (dl_us[2]) {
+                fprintf(out, "%-8s deadline %llu/%llu/%llu us  misses %llu\n", "", (unsigned long long)dl_us[0],
+                        (unsigned long long)dl_us[1], (unsigned long long)dl_us[2],
+                        (unsigned long long)stats.deadline_misses);
+            }
+        }
+    }
+    pthread_mutex_unlock(&scheduler_state.table_lock);
+}
+
+// Number of run queues / vCPUs
+int scheduler_cpu_count(void) {
+    return scheduler_state.cpu_count;
+}
+
+int scheduler_this_cpu(void) {
+    return sched_this_cpu;
 }
 
 // Cleanup scheduler
 void scheduler_cleanup(void) {
-    if (scheduler_state.processes) {
-        free(scheduler_state.processes);
-        scheduler_state.processes = NULL;
+    scheduler_stop();
+
+    for (size_t chunk = 0; chunk < SCHED_MAX_CHUNKS; chunk++) {
+        free(scheduler_state.chunks[chunk]);
+        scheduler_state.chunks[chunk] = NULL;
+    }
+    free(scheduler_state.pid_index);
+    scheduler_state.pid_index = NULL;
+    scheduler_state.max_processes = 0;
+    scheduler_state.num_processes = 0;
+    scheduler_state.free_head = SCHED_NIL;
+
+    if (scheduler_state.cpus) {
+        for (int i = 0; i < scheduler_state.cpu_count; i++) {
+            pthread_mutex_destroy(&scheduler_state.cpus[i].lock);
+            pthread_cond_destroy(&scheduler_state.cpus[i].work);
+            free(scheduler_state.cpus[i].near);
+        }
+        free(scheduler_state.cpus);
+        scheduler_state.cpus = NULL;
     }
+    scheduler_state.cpu_count = 0;
 }
@@ -0,0 +1,151 @@
+#ifndef MIRIX_SCHEDULER_H
+#define MIRIX_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "kernel.h"
+#include "arch/_archruntime/arch_topology.h"
+
+// Priority levels (0 = highest); one bit per level in the ready bitmap
+#define MIRIX_SCHED_PRIORITIES 64
+#define MIRIX_SCHED_DEFAULT_PRIORITY 32
+
+// Process table starts small and doubles up to this limit
+#define MIRIX_SCHED_INITIAL_PROCESSES 256
+#define MIRIX_SCHED_MAX_PROCESSES 65536
+
+// Virtual CPUs (matches the --mcpu limit)
+#define MIRIX_SCHED_MAX_CPUS 256
+
+// Time slice a vCPU gives the process it picked
+#define MIRIX_SCHED_QUANTUM_US 1000
+
+// Fair-share groups: each CPU runs the group with the least runtime scaled
+// by 1024 / weight. Group 0 ("default", weight 1024, uncapped) holds every
+// process without a timeshare rule.
+#define MIRIX_SCHED_MAX_GROUPS 32
+#define MIRIX_SCHED_GROUP_NAME_MAX 32
+#define MIRIX_SCHED_DEFAULT_WEIGHT 1024
+#define MIRIX_SCHED_MIN_WEIGHT 1
+#define MIRIX_SCHED_MAX_WEIGHT 1048576
+
+// Capped groups get cap% of one vCPU per period, summed over all vCPUs
+#define MIRIX_SCHED_CAP_PERIOD_US 100000
+
+// Deadline class: earliest-deadline-first per vCPU, ahead of every
+// fair-share group. Each task is admitted to one vCPU only while the
+// densities (runtime / deadline) there sum to at most DL_MAX_PERCENT of it,
+// which leaves the rest for best-effort work and makes EDF's guarantee hold.
+#define MIRIX_SCHED_DL_MAX_PERCENT 95
+#define MIRIX_SCHED_DL_MIN_RUNTIME_US 10
+#define MIRIX_SCHED_DL_MAX_PERIOD_US 10000000
+
+// IPC co-scheduling: one send in SAMPLE is counted; a process whose sends
+// to one peer outweigh all others by AFFINE_SCORE samples is moved to a
+// vCPU sharing an L3 with that peer
+#define MIRIX_SCHED_IPC_SAMPLE 16
+#define MIRIX_SCHED_IPC_AFFINE_SCORE 8
+#define MIRIX_SCHED_IPC_MAX_SCORE 64
+
+// Latency histograms are log2 microseconds: bucket 0 counts samples under
+// 2 us, bucket n counts [2^n, 2^(n+1)) us and the last bucket everything above
+#define MIRIX_SCHED_HIST_BUCKETS 20
+
+// Wait/run latency, kept per process and per vCPU
+typedef struct {
+    uint64_t dispatches;
+    uint64_t voluntary_switches;   // Stopped running before its quantum ran out
+    uint64_t involuntary_switches; // Preempted while still runnable
+    uint64_t wait_ns_total;        // Runnable but queued
+    uint64_t wait_ns_max;
+    uint64_t run_ns_total;         // On the vCPU, per dispatch
+    uint64_t run_ns_max;
+    uint64_t wait_hist[MIRIX_SCHED_HIST_BUCKETS];
+    uint64_t run_hist[MIRIX_SCHED_HIST_BUCKETS];
+    uint64_t deadline_misses;      // Deadline class: jobs still unfinished at their deadline
+} scheduler_latency_stats_t;
+
+// Per-vCPU counters
+typedef struct {
+    scheduler_latency_stats_t latency;
+    uint64_t steals;               // Processes pulled from other CPUs
+    uint64_t idle_parks;           // Times the vCPU went to sleep with nothing to run
+    uint64_t ipc_moves;            // Processes moved here to share a cache with an IPC peer
+    int host_cpu;                  // Host CPU the vCPU thread is pinned to, -1 = none
+    uint32_t dl_bandwidth_percent; // Admitted deadline-class density
+    uint32_t nr_running;           // Queue depth now
+    uint32_t max_nr_running;       // Deepest queue seen at a switch
+    uint64_t depth_total;          // Queue depth summed over switches (mean = / switches)
+    uint64_t switches;
+} scheduler_cpu_stats_t;
+
+// Runs a process for one quantum on a vCPU thread
+typedef void (*scheduler_dispatch_fn)(mirix_process_t *process, int cpu);
+
+// Scheduler API
+int scheduler_init(void);
+int scheduler_init_cpus(int cpu_count);
+int scheduler_start(void);
+void scheduler_stop(void);
+void scheduler_cleanup(void);
+void scheduler_tick(void);
+void scheduler_set_dispatch(scheduler_dispatch_fn dispatch);
+int scheduler_cpu_count(void);
+
+// vCPU the calling thread runs for (0 outside vCPU threads)
+int scheduler_this_cpu(void);
+
+// Dispatch backends call these from a vCPU thread: need_resched turns true
+// when a deadline task is waiting for the vCPU, and hold_cpu sleeps out a
+// quantum unless that happens first
+bool scheduler_need_resched(int cpu);
+void scheduler_hold_cpu(int cpu);
+
+int scheduler_add_process(const mirix_process_t *process);
+int scheduler_remove_process(uint32_t pid);
+int scheduler_set_status(uint32_t pid, mirix_kernel_status_t status);
+int scheduler_set_priority(uint32_t pid, int priority);
+int scheduler_set_affinity(uint32_t pid, int cpu_hint, bool pinned);
+
+// Move a process into the deadline class: runtime_us of CPU every
+// period_us, finished within deadline_us of each release (0 = period).
+// Returns -1 if no vCPU can admit it; runtime_us 0 returns it to its group.
+int scheduler_set_deadline(uint32_t pid, uint64_t runtime_us, uint64_t deadline_us, uint64_t period_us);
+
+// Host placement. Call between scheduler_init_cpus and scheduler_start:
+// vCPU threads are pinned to distinct physical cores of one package before
+// SMT siblings, then the next package, and steal from the nearest vCPUs
+// first. Without it every vCPU counts as sharing one cache.
+int scheduler_set_topology(const arch_topology_t *topology);
+
+// Pin the calling service thread to host CPUs the vCPUs leave free
+int scheduler_pin_service_thread(void);
+
+// IPC traffic hook (see ipc_set_traffic_hook); the _sample variant takes
+// sends that were already sampled, such as those from ipc_drain_traffic
+void scheduler_note_ipc(uint32_t sender_pid, uint32_t receiver_pid);
+void scheduler_note_ipc_sample(uint32_t sender_pid, uint32_t receiver_pid);
+
+// Timeshare groups. The --timeshare file holds one entry per line ('#'
+// starts a comment):
+//   group NAME WEIGHT [CAP]   weight 1-1048576, optional cap in % of one vCPU
+//   member GROUP PROCESS      processes named PROCESS start in GROUP
+int scheduler_load_timeshare(const char *path);
+int scheduler_add_group(const char *name, uint32_t weight, uint32_t cap_percent);
+int scheduler_find_group(const char *name);
+int scheduler_set_group(uint32_t pid, int group);
+
+// Statistics; the dump prints a table, or one JSON object per line
+int scheduler_get_cpu_stats(int cpu, scheduler_cpu_stats_t *stats);
+int scheduler_get_process_stats(uint32_t pid, scheduler_latency_stats_t *stats);
+void scheduler_reset_stats(void);
+void scheduler_dump_stats(FILE *out, bool json);
+
+// Valid until the process is removed
+mirix_process_t* scheduler_get_current_process(void);
+mirix_process_t* scheduler_find_process(uint32_t pid);
+
+#endif // MIRIX_SCHEDULER_H
@@ -5,13 +5,46 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <time.h>
 
 #include "syscall.h"
+#include "../scheduler.h"
 
-// Syscall system state
+// Typed handlers, one per MIRIX_SYSCALLS entry
+#define SYSCALL_HANDLER_DECL(num, NAME, name, args) static int syscall_##name##_handler(args *a);
+MIRIX_SYSCALLS(SYSCALL_HANDLER_DECL)
+#undef SYSCALL_HANDLER_DECL
+
+// Table entries decode the untyped argument pointer for their handler
+#define SYSCALL_ENTRY_FN(num, NAME, name, args) \
+    static int syscall_##name##_entry(void *a) { return syscall_##name##_handler((args *)a); }
+MIRIX_SYSCALLS(SYSCALL_ENTRY_FN)
+#undef SYSCALL_ENTRY_FN
+
+typedef struct {
+    const char *name;
+    int (*entry)(void *args);
+} syscall_entry_t;
+
+static const syscall_entry_t syscall_table[MIRIX_SYSCALL_MAX] = {
+#define SYSCALL_TABLE_ENTRY(num, NAME, name, args) [num] = { #name, syscall_##name##_entry },
+    MIRIX_SYSCALLS(SYSCALL_TABLE_ENTRY)
+#undef SYSCALL_TABLE_ENTRY
+};
+
+// Counters of one vCPU. Rows start on their own cache line, so vCPUs
+// counting calls never write a line another vCPU is writing.
+#define SYSCALL_CACHE_LINE 64
+
+typedef struct {
+    syscall_stats_t syscalls[MIRIX_SYSCALL_MAX];
+} __attribute__((aligned(SYSCALL_CACHE_LINE))) syscall_cpu_stats_t;
+
+// Syscall system state. Each vCPU charges its own row of counters; threads
+// outside the vCPUs share row 0, so updates are relaxed atomics.
 static struct {
     bool initialized;
-    void (*syscall_table[256])(void *args);
+    syscall_cpu_stats_t stats[MIRIX_SCHED_MAX_CPUS];
 } syscall_state;
 
 // Initialize syscall interface
@@ -20,21 +53,7 @@ int syscall_init(void) {
         return 0;
     }
     
-    // Clear syscall table
-    memset(syscall_state.syscall_table, 0, sizeof(syscall_state.syscall_table));
-    
-    // Register syscall handlers
-    syscall_state.syscall_table[MIRIX_SYSCALL_EXIT] = syscall_exit_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_WRITE] = syscall_write_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_READ] = syscall_read_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_IPC_SEND] = syscall_ipc_send_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_IPC_RECV] = syscall_ipc_recv_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_FORK] = syscall_fork_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_EXEC] = syscall_exec_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_WAIT] = syscall_wait_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_TIMER_CREATE] = syscall_timer_create_impl;
-    syscall_state.syscall_table[MIRIX_SYSCALL_TIMER_DELETE] = syscall_timer_delete_impl;
-    
+    syscall_reset_stats();
     syscall_state.initialized = true;
     return 0;
 }
@@ -44,9 +63,186 @@ void syscall_cleanup(void) {
     syscall_state.initialized = false;
 }
 
+uint64_t syscall_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static bool syscall_valid(int syscall_num) {
+    return syscall_num > 0 && syscall_num < MIRIX_SYSCALL_MAX && syscall_table[syscall_num].entry;
+}
+
+static syscall_stats_t *syscall_this_stats(int syscall_num) {
+    int cpu = scheduler_this_cpu();
+    if (cpu < 0 || cpu >= MIRIX_SCHED_MAX_CPUS) {
+        cpu = 0;
+    }
+    return &syscall_state.stats[cpu].syscalls[syscall_num];
+}
+
+static int syscall_hist_bucket(uint64_t ns) {
+    uint64_t units = ns >> 6;
+    int bucket = units < 2 ? 0 : 63 - __builtin_clzll(units);
+    return bucket < MIRIX_SYSCALL_HIST_BUCKETS ? bucket : MIRIX_SYSCALL_HIST_BUCKETS - 1;
+}
+
+static void syscall_record(syscall_stats_t *stats, uint64_t ns, int result) {
+    if (result < 0) {
+        __atomic_add_fetch(&stats->errors, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&stats->ns_total, ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->hist[syscall_hist_bucket(ns)], 1, __ATOMIC_RELAXED);
+    // Racy against other threads on row 0; a lost maximum is harmless
+    if (ns > __atomic_load_n(&stats->ns_max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&stats->ns_max, ns, __ATOMIC_RELAXED);
+    }
+}
+
+// Run a syscall through the table. Calls are counted on entry so exit,
+// which does not return, still shows up.
+int syscall_dispatch(int syscall_num, void *args) {
+    if (!syscall_valid(syscall_num)) {
+        fprintf(stderr, "Unknown syscall: %d\n", syscall_num);
+        return -1;
+    }
+
+    syscall_stats_t *stats = syscall_this_stats(syscall_num);
+    __atomic_add_fetch(&stats->calls, 1, __ATOMIC_RELAXED);
+    uint64_t start = syscall_clock_ns();
+    int result = syscall_table[syscall_num].entry(args);
+    syscall_record(stats, syscall_clock_ns() - start, result);
+    return result;
+}
+
+// Charge a call served outside syscall_dispatch
+void syscall_account(int syscall_num, uint64_t ns, int result) {
+    if (!syscall_valid(syscall_num)) {
+        return;
+    }
+    syscall_stats_t *stats = syscall_this_stats(syscall_num);
+    __atomic_add_fetch(&stats->calls, 1, __ATOMIC_RELAXED);
+    syscall_record(stats, ns, result);
+}
+
+const char *syscall_name(int syscall_num) {
+    return syscall_valid(syscall_num) ? syscall_table[syscall_num].name : NULL;
+}
+
+int syscall_get_stats(int syscall_num, int cpu, syscall_stats_t *stats) {
+    if (!stats || !syscall_valid(syscall_num) || cpu < -1 || cpu >= MIRIX_SCHED_MAX_CPUS) {
+        return -1;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    int first = cpu < 0 ? 0 : cpu;
+    int last = cpu < 0 ? MIRIX_SCHED_MAX_CPUS - 1 : cpu;
+    for (int i = first; i <= last; i++) {
+        const syscall_stats_t *row = &syscall_state.stats[i].syscalls[syscall_num];
+        stats->calls += __atomic_load_n(&row->calls, __ATOMIC_RELAXED);
+        stats->errors += __atomic_load_n(&row->errors, __ATOMIC_RELAXED);
+        stats->ns_total += __atomic_load_n(&row->ns_total, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&row->ns_max, __ATOMIC_RELAXED);
+        if (max > stats->ns_max) {
+            stats->ns_max = max;
+        }
+        for (int bucket = 0; bucket < MIRIX_SYSCALL_HIST_BUCKETS; bucket++) {
+            stats->hist[bucket] += __atomic_load_n(&row->hist[bucket], __ATOMIC_RELAXED);
+        }
+    }
+    return 0;
+}
+
+void syscall_reset_stats(void) {
+    memset(syscall_state.stats, 0, sizeof(syscall_state.stats));
+}
+
+// Upper bound of the bucket holding the percent-th percentile
+static uint64_t syscall_hist_percentile_ns(const uint64_t *hist, uint64_t count, unsigned percent) {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < MIRIX_SYSCALL_HIST_BUCKETS; bucket++) {
+        seen += hist[bucket];
+        if (seen >= rank) {
+            return 128ULL << bucket;
+        }
+    }
+    return 128ULL << (MIRIX_SYSCALL_HIST_BUCKETS - 1);
+}
+
+static void syscall_dump_row(FILE *out, const char *name, int cpu, const syscall_stats_t *stats, bool json) {
+    uint64_t completed = 0;
+    for (int bucket = 0; bucket < MIRIX_SYSCALL_HIST_BUCKETS; bucket++) {
+        completed += stats->hist[bucket];
+    }
+
+    if (json) {
+        fprintf(out, "{\"syscall\":\"%s\",\"cpu\":%d,\"calls\":%llu,\"errors\":%llu,\"ns_total\":%llu,\"ns_max\":%llu,\"hist\":[",
+                name, cpu, (unsigned long long)stats->calls, (unsigned long long)stats->errors,
+                (unsigned long long)stats->ns_total, (unsigned long long)stats->ns_max);
+        for (int bucket = 0; bucket < MIRIX_SYSCALL_HIST_BUCKETS; bucket++) {
+            fprintf(out, "%s%llu", bucket ? "," : "", (unsigned long long)stats->hist[bucket]);
+        }
+        fprintf(out, "]}\n");
+        return;
+    }
+
+    char label[32];
+    if (cpu < 0) {
+        snprintf(label, sizeof(label), "%s", name);
+    } else {
+        snprintf(label, sizeof(label), "  cpu%d", cpu);
+    }
+    fprintf(out, "%-18s %10llu %8llu %9llu %9llu %10llu\n", label,
+            (unsigned long long)stats->calls, (unsigned long long)stats->errors,
+            (unsigned long long)(completed ? stats->ns_total / completed : 0),
+            (unsigned long long)syscall_hist_percentile_ns(stats->hist, completed, 99),
+            (unsigned long long)stats->ns_max);
+}
+
+// Print every syscall that has been called, with a row per vCPU when
+// there are several (times in nanoseconds), or one JSON object per
+// syscall and vCPU
+void syscall_dump_stats(FILE *out, bool json) {
+    if (!out) {
+        return;
+    }
+
+    int cpus = scheduler_cpu_count();
+    if (cpus < 1) {
+        cpus = 1;
+    }
+    if (!json) {
+        fprintf(out, "%-18s %10s %8s %9s %9s %10s\n", "", "calls", "errors", "avg ns", "p99< ns", "max ns");
+    }
+
+    for (int num = 1; num < MIRIX_SYSCALL_MAX; num++) {
+        syscall_stats_t total;
+        if (syscall_get_stats(num, -1, &total) != 0 || total.calls == 0) {
+            continue;
+        }
+        if (!json) {
+            syscall_dump_row(out, syscall_table[num].name, -1, &total, false);
+            if (cpus == 1) {
+                continue;
+            }
+        }
+        for (int cpu = 0; cpu < cpus; cpu++) {
+            syscall_stats_t stats;
+            syscall_get_stats(num, cpu, &stats);
+            if (stats.calls) {
+                syscall_dump_row(out, syscall_table[num].name, cpu, &stats, json);
+            }
+        }
+    }
+}
+
 // Syscall implementations
 int syscall_exit(int exit_code) {
-    printf("Process exit with code: %d\n", exit_code);
     exit(exit_code);
     return exit_code;
 }
@@ -58,10 +254,6 @@ int syscall_write(mirix_write_args_t *args) {
     
     // Write to file descriptor
     ssize_t result = write(args->fd, args->buf, args->count);
-    
-    printf("syscall_write: fd=%d, count=%zu, result=%zd\n", 
-           args->fd, args->count, result);
-    
     return (int)result;
 }
 
@@ -72,10 +264,6 @@ int syscall_read(mirix_read_args_t *args) {
     
     // Read from file descriptor
     ssize_t result = read(args->fd, args->buf, args->count);
-    
-    printf("syscall_read: fd=%d, count=%zu, result=%zd\n", 
-           args->fd, args->count, result);
-    
     return (int)result;
 }
 
@@ -93,34 +281,51 @@ int syscall_ipc_recv(mirix_ipc_args_t *args) {
         return -1;
     }
     
-    mirix_message_t msg;
-    int result = ipc_receive_message(getpid(), &msg, true);
+    mirix_ipc_args_t blocking = *args;
+    blocking.timeout_ms = -1;
+    return syscall_ipc_recv_timeout(&blocking);
+}
+
+int syscall_ipc_recv_timeout(mirix_ipc_args_t *args) {
+    if (!args) {
+        return -1;
+    }
+    
+    // Copy straight from the queue into the user buffer
+    mirix_message_info_t info;
+    int result = ipc_receive_into(getpid(), &info, (void*)args->msg, args->msg_size, args->timeout_ms);
     
     if (result == 0) {
-        // Copy received message to user buffer
-        size_t copy_size = (msg.data_size < args->msg_size) ? msg.data_size : args->msg_size;
-        memcpy((void*)args->msg, msg.data, copy_size);
-        result = copy_size;
+        result = (info.data_size < args->msg_size) ? info.data_size : args->msg_size;
     }
     
     return result;
 }
 
-int syscall_fork(void) {
-    printf("syscall_fork called\n");
+int syscall_ipc_send_batch(mirix_ipc_batch_args_t *args) {
+    if (!args) {
+        return -1;
+    }
     
-    pid_t pid = fork();
+    return ipc_send_batch(getpid(), (const mirix_ipc_send_entry_t*)args->entries, args->count);
+}
+
+int syscall_ipc_recv_batch(mirix_ipc_batch_args_t *args) {
+    if (!args) {
+        return -1;
+    }
     
-    if (pid == 0) {
-        printf("Child process created\n");
-        return 0;
-    } else if (pid > 0) {
-        printf("Parent process, child PID: %d\n", pid);
-        return pid;
-    } else {
+    return ipc_receive_batch(getpid(), (mirix_ipc_recv_entry_t*)args->entries,
+                             args->count, args->timeout_ms);
+}
+
+int syscall_fork(void) {
+    pid_t pid = fork();
+    if (pid < 0) {
         perror("fork");
         return -1;
     }
+    return pid;
 }
 
 int syscall_exec(const char *path, char *const argv[]) {
@@ -128,16 +333,12 @@ int syscall_exec(const char *path, char *const argv[]) {
         return -1;
     }
     
-    printf("syscall_exec: path=%s\n", path);
-    
     int result = execvp(path, argv);
     perror("execvp");
     return result;
 }
 
 int syscall_wait(int *status) {
-    printf("syscall_wait called\n");
-    
     int stat;
     pid_t pid = wait(&stat);
     
@@ -149,61 +350,77 @@ int syscall_wait(int *status) {
 }
 
 int syscall_timer_create(uint64_t interval_ms, bool periodic) {
-    printf("syscall_timer_create: interval=%llu, periodic=%d\n", 
-           (unsigned long long)interval_ms, periodic);
-    
     // Create timer using host interface
     return host_interface_create_timer(interval_ms, periodic, NULL, NULL);
 }
 
-int syscall_timer_delete(int timer_fd) {
-    printf("syscall_timer_delete: timer_fd=%d\n", timer_fd);
-    
-    close(timer_fd);
-    return 0;
+int syscall_timer_delete(int timer_id) {
+    return host_interface_cancel_timer(timer_id);
 }
 
-// Internal syscall handlers
-static void syscall_exit_impl(void *args) {
-    int exit_code = (int)(long)args;
-    syscall_exit(exit_code);
+// Typed handlers
+static int syscall_exit_handler(void *a) {
+    return syscall_exit((int)(long)a);
 }
 
-static void syscall_write_impl(void *args) {
-    syscall_write((mirix_write_args_t*)args);
+static int syscall_write_handler(mirix_write_args_t *a) {
+    return syscall_write(a);
 }
 
-static void syscall_read_impl(void *args) {
-    syscall_read((mirix_read_args_t*)args);
+static int syscall_read_handler(mirix_read_args_t *a) {
+    return syscall_read(a);
 }
 
-static void syscall_ipc_send_impl(void *args) {
-    syscall_ipc_send((mirix_ipc_args_t*)args);
+static int syscall_ipc_send_handler(mirix_ipc_args_t *a) {
+    return syscall_ipc_send(a);
 }
 
-static void syscall_ipc_recv_impl(void *args) {
-    syscall_ipc_recv((mirix_ipc_args_t*)args);
+static int syscall_ipc_recv_handler(mirix_ipc_args_t *a) {
+    return syscall_ipc_recv(a);
 }
 
-static void syscall_fork_impl(void *args) {
-    syscall_fork();
+static int syscall_ipc_recv_timeout_handler(mirix_ipc_args_t *a) {
+    return syscall_ipc_recv_timeout(a);
 }
 
-static void syscall_exec_impl(void *args) {
-    // Args would be a structure containing path and argv
-    syscall_exec(NULL, NULL);
+static int syscall_ipc_send_batch_handler(mirix_ipc_batch_args_t *a) {
+    return syscall_ipc_send_batch(a);
 }
 
-static void syscall_wait_impl(void *args) {
-    syscall_wait((int*)args);
+static int syscall_ipc_recv_batch_handler(mirix_ipc_batch_args_t *a) {
+    return syscall_ipc_recv_batch(a);
 }
 
-static void syscall_timer_create_impl(void *args) {
-    // Args would be a structure containing timer parameters
-    syscall_timer_create(0, false);
+static int syscall_fork_handler(void *a) {
+    (void)a;
+    return syscall_fork();
 }
 
-static void syscall_timer_delete_impl(void *args) {
-    int timer_fd = (int)(long)args;
-    syscall_timer_delete(timer_fd);
+static int syscall_exec_handler(mirix_exec_args_t *a) {
+    if (!a) {
+        return -1;
+    }
+    return syscall_exec(a->path, a->argv);
+}
+
+static int syscall_wait_handler(mirix_wait_args_t *a) {
+    return syscall_wait(a ? &a->status : NULL);
+}
+
+// The caller's callback runs on expiry; the id is returned and stored
+static int syscall_timer_create_handler(mirix_timer_t *a) {
+    if (!a) {
+        return -1;
+    }
+    
+    int timer_id = host_interface_create_timer(a->interval, a->periodic, a->callback, a->callback_data);
+    a->timer_id = timer_id >= 0 ? (uint32_t)timer_id : 0;
+    return timer_id;
+}
+
+static int syscall_timer_delete_handler(mirix_timer_t *a) {
+    if (!a) {
+        return -1;
+    }
+    return syscall_timer_delete((int)a->timer_id);
 }
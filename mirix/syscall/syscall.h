@@ -3,36 +3,57 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include "../kernel.h"
 #include "../ipc/ipc.h"
 #include "../host/host_interface.h"
 
+// Syscall latency histograms are log2 nanoseconds: bucket 0 counts calls
+// under 128 ns, bucket n counts [64 << n, 128 << n) ns and the last bucket
+// everything above
+#define MIRIX_SYSCALL_HIST_BUCKETS 20
+
+// Per-syscall counters, kept per vCPU
+typedef struct {
+    uint64_t calls;
+    uint64_t errors;       // Returned a negative value
+    uint64_t ns_total;
+    uint64_t ns_max;
+    uint64_t hist[MIRIX_SYSCALL_HIST_BUCKETS];
+} syscall_stats_t;
+
 // Syscall API
 int syscall_init(void);
 void syscall_cleanup(void);
 
+// Dispatch through the table generated from MIRIX_SYSCALLS; -1 for
+// unknown numbers
+int syscall_dispatch(int syscall_num, void *args);
+const char *syscall_name(int syscall_num);
+
+// Charge a call served outside syscall_dispatch (the syscall rings)
+void syscall_account(int syscall_num, uint64_t ns, int result);
+uint64_t syscall_clock_ns(void);
+
+// Statistics (cpu -1 sums every vCPU); the dump prints a table, or one
+// JSON object per line
+int syscall_get_stats(int syscall_num, int cpu, syscall_stats_t *stats);
+void syscall_reset_stats(void);
+void syscall_dump_stats(FILE *out, bool json);
+
 // Syscall implementations
 int syscall_exit(int exit_code);
 int syscall_write(mirix_write_args_t *args);
 int syscall_read(mirix_read_args_t *args);
 int syscall_ipc_send(mirix_ipc_args_t *args);
 int syscall_ipc_recv(mirix_ipc_args_t *args);
+int syscall_ipc_recv_timeout(mirix_ipc_args_t *args);
+int syscall_ipc_send_batch(mirix_ipc_batch_args_t *args);
+int syscall_ipc_recv_batch(mirix_ipc_batch_args_t *args);
 int syscall_fork(void);
 int syscall_exec(const char *path, char *const argv[]);
 int syscall_wait(int *status);
 int syscall_timer_create(uint64_t interval_ms, bool periodic);
-int syscall_timer_delete(int timer_fd);
-
-// Internal syscall handlers
-static void syscall_exit_impl(void *args);
-static void syscall_write_impl(void *args);
-static void syscall_read_impl(void *args);
-static void syscall_ipc_send_impl(void *args);
-static void syscall_ipc_recv_impl(void *args);
-static void syscall_fork_impl(void *args);
-static void syscall_exec_impl(void *args);
-static void syscall_wait_impl(void *args);
-static void syscall_timer_create_impl(void *args);
-static void syscall_timer_delete_impl(void *args);
+int syscall_timer_delete(int timer_id);
 
 #endif // MIRIX_SYSCALL_H
@@ -0,0 +1,414 @@
+/*
+ * MIRIX Syscall Rings
+ * Shared submission/completion queues between a program and a kernel thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "syscall_ring.h"
+#include "syscall.h"
+#include "../ipc/ipc.h"
+#include "../ipc/ipc_futex.h"
+#include "../host/host_interface.h"
+
+#define SYSRING_SQ_MASK (MIRIX_SYSRING_SQ_ENTRIES - 1)
+#define SYSRING_CQ_MASK (MIRIX_SYSRING_CQ_ENTRIES - 1)
+
+// Longest the service thread blocks in a receive before checking whether
+// its ring is being torn down
+#define SYSRING_SLICE_MS 100
+
+// Kernel-side ring
+struct syscall_ring {
+    char name[MIRIX_SYSRING_NAME_MAX];
+    mirix_sysring_region_t *region;
+    int slot;                      // Index in syscall_ring_state.rings
+    uint32_t generation;
+    uint32_t pid;
+    pthread_t thread;
+    bool started;
+    bool stop;                     // Atomic
+    pthread_mutex_t cq_lock;       // Service thread and timer expiries both post
+    int timers[MIRIX_SYSRING_MAX_TIMERS];          // Host timer ids, -1 when free
+    uint64_t timer_user_data[MIRIX_SYSRING_MAX_TIMERS];
+    bool timer_periodic[MIRIX_SYSRING_MAX_TIMERS];
+};
+
+// Syscall ring state. The lock guards the ring table and every ring's
+// timer table so expiries never touch a ring being destroyed.
+static struct {
+    pthread_mutex_t lock;
+    syscall_ring_t *rings[MIRIX_SYSRING_MAX_RINGS];
+    uint32_t generation;
+    uint32_t created;
+    uint32_t idle_us;
+} syscall_ring_state = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t syscall_ring_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static inline void syscall_ring_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ volatile ("pause");
+#endif
+}
+
+static bool syscall_ring_stopping(syscall_ring_t *ring) {
+    return __atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE);
+}
+
+void syscall_ring_set_poll(uint32_t idle_us) {
+    __atomic_store_n(&syscall_ring_state.idle_us, idle_us, __ATOMIC_RELAXED);
+}
+
+// Post a completion. Submission results wait for the program to make
+// room; timer expiries are dropped and counted instead.
+static bool syscall_ring_post(syscall_ring_t *ring, const mirix_sysring_cqe_t *cqe, bool wait) {
+    mirix_sysring_region_t *region = ring->region;
+    for (;;) {
+        pthread_mutex_lock(&ring->cq_lock);
+        uint32_t tail = region->cq_tail;
+        if (tail - __atomic_load_n(&region->cq_head, __ATOMIC_ACQUIRE) < MIRIX_SYSRING_CQ_ENTRIES) {
+            region->cqes[tail & SYSRING_CQ_MASK] = *cqe;
+            __atomic_store_n(&region->cq_tail, tail + 1, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&ring->cq_lock);
+
+            // Pairs with the fence in syscall_ring_wait_cqe
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&region->cq_waiters, __ATOMIC_RELAXED)) {
+                ipc_futex_wake(&region->cq_tail, true);
+            }
+            return true;
+        }
+        pthread_mutex_unlock(&ring->cq_lock);
+
+        if (!wait || syscall_ring_stopping(ring)) {
+            __atomic_add_fetch(&region->cq_overflow, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        usleep(50);
+    }
+}
+
+// Timer expiry on the host polling thread; data packs the ring's
+// generation, slot and timer index
+static void syscall_ring_timer_expired(void *data) {
+    uintptr_t key = (uintptr_t)data;
+    int slot = (int)((key >> 8) & 0xFF);
+    int index = (int)(key & 0xFF);
+    uint32_t generation = (uint32_t)(key >> 16);
+
+    pthread_mutex_lock(&syscall_ring_state.lock);
+    syscall_ring_t *ring = syscall_ring_state.rings[slot];
+    if (!ring || (uint32_t)(ring->generation & (UINTPTR_MAX >> 16)) != generation ||
+        ring->timers[index] < 0) {
+        pthread_mutex_unlock(&syscall_ring_state.lock);
+        return;
+    }
+
+    mirix_sysring_cqe_t cqe = {
+        .user_data = ring->timer_user_data[index],
+        .res = index,
+        .flags = MIRIX_SYSRING_CQE_TIMER
+    };
+    if (!ring->timer_periodic[index]) {
+        ring->timers[index] = -1;
+    }
+    syscall_ring_post(ring, &cqe, false);
+    pthread_mutex_unlock(&syscall_ring_state.lock);
+}
+
+static int syscall_ring_timer_create(syscall_ring_t *ring, const mirix_sysring_sqe_t *sqe) {
+    if (sqe->arg <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&syscall_ring_state.lock);
+    int index = 0;
+    while (index < MIRIX_SYSRING_MAX_TIMERS && ring->timers[index] >= 0) {
+        index++;
+    }
+    if (index == MIRIX_SYSRING_MAX_TIMERS) {
+        pthread_mutex_unlock(&syscall_ring_state.lock);
+        errno = EAGAIN;
+        return -1;
+    }
+
+    bool periodic = (sqe->flags & MIRIX_SYSRING_TIMER_PERIODIC) != 0;
+    uintptr_t key = ((uintptr_t)ring->generation << 16) | ((uintptr_t)ring->slot << 8) | (uintptr_t)index;
+    ring->timer_user_data[index] = sqe->user_data;
+    ring->timer_periodic[index] = periodic;
+
+    // Expiries wait on the lock held here, so the slot is set before the first one
+    int timer_id = host_interface_create_timer((uint64_t)sqe->arg, periodic,
+                                               syscall_ring_timer_expired, (void *)key);
+    ring->timers[index] = timer_id;
+    pthread_mutex_unlock(&syscall_ring_state.lock);
+
+    if (timer_id < 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return index;
+}
+
+static int syscall_ring_timer_delete(syscall_ring_t *ring, int64_t index) {
+    pthread_mutex_lock(&syscall_ring_state.lock);
+    if (index < 0 || index >= MIRIX_SYSRING_MAX_TIMERS || ring->timers[index] < 0) {
+        pthread_mutex_unlock(&syscall_ring_state.lock);
+        errno = EINVAL;
+        return -1;
+    }
+    host_interface_cancel_timer(ring->timers[index]);
+    ring->timers[index] = -1;
+    pthread_mutex_unlock(&syscall_ring_state.lock);
+    return 0;
+}
+
+// Receive in slices so a ring whose program has gone can be torn down
+static int syscall_ring_receive(syscall_ring_t *ring, mirix_message_info_t *info,
+                                void *buf, size_t len, int64_t timeout_ms) {
+    uint64_t deadline = timeout_ms >= 0 ? syscall_ring_now_us() + (uint64_t)timeout_ms * 1000 : 0;
+    for (;;) {
+        int slice = SYSRING_SLICE_MS;
+        if (timeout_ms >= 0) {
+            uint64_t now = syscall_ring_now_us();
+            uint64_t left_ms = now < deadline ? (deadline - now + 999) / 1000 : 0;
+            if (left_ms < (uint64_t)slice) {
+                slice = (int)left_ms;
+            }
+        }
+        if (ipc_receive_into(ring->pid, info, buf, len, slice) == 0) {
+            return 0;
+        }
+        if (syscall_ring_stopping(ring) || (timeout_ms >= 0 && syscall_ring_now_us() >= deadline)) {
+            return -1;
+        }
+    }
+}
+
+// Run one request against the kernel's own services
+static void syscall_ring_execute(syscall_ring_t *ring, const mirix_sysring_sqe_t *sqe, mirix_sysring_cqe_t *cqe) {
+    mirix_sysring_region_t *region = ring->region;
+    uint8_t *buf = region->data + sqe->offset;
+    uint64_t start = syscall_clock_ns();
+    int result = -1;
+
+    cqe->user_data = sqe->user_data;
+    cqe->flags = 0;
+    cqe->aux = 0;
+    errno = 0;
+
+    if ((uint64_t)sqe->offset + sqe->len > MIRIX_SYSRING_DATA_SIZE) {
+        cqe->res = -1;
+        cqe->error = EFAULT;
+        return;
+    }
+
+    switch (sqe->opcode) {
+        case MIRIX_SYSCALL_IPC_SEND:
+            result = ipc_send_message(ring->pid, (uint32_t)sqe->fd, buf, sqe->len, sqe->ipc_flags);
+            if (result != 0 && errno == 0) {
+                errno = EAGAIN;
+            }
+            break;
+        case MIRIX_SYSCALL_IPC_RECV:
+        case MIRIX_SYSCALL_IPC_RECV_TIMEOUT: {
+            mirix_message_info_t info;
+            int64_t timeout = sqe->opcode == MIRIX_SYSCALL_IPC_RECV ? -1 : sqe->arg;
+            if (syscall_ring_receive(ring, &info, buf, sqe->len, timeout) == 0) {
+                result = info.data_size < sqe->len ? (int)info.data_size : (int)sqe->len;
+                cqe->aux = info.sender_pid;
+            } else {
+                errno = ETIMEDOUT;
+            }
+            break;
+        }
+        case MIRIX_SYSCALL_TIMER_CREATE:
+            result = syscall_ring_timer_create(ring, sqe);
+            break;
+        case MIRIX_SYSCALL_TIMER_DELETE:
+            result = syscall_ring_timer_delete(ring, sqe->arg);
+            break;
+        default:
+            // Process control and the batch calls stay on the direct path.
+            // So do WRITE and READ: a program's fd numbers mean nothing in
+            // the kernel's fd table.
+            errno = ENOSYS;
+            break;
+    }
+
+    cqe->res = result;
+    cqe->error = result < 0 ? errno : 0;
+    syscall_account((int)sqe->opcode, syscall_clock_ns() - start, result);
+}
+
+// Service thread: drain the submission queue, then spin for idle_us in
+// polling mode and sleep on the doorbell
+static void *syscall_ring_service(void *arg) {
+    syscall_ring_t *ring = (syscall_ring_t *)arg;
+    mirix_sysring_region_t *region = ring->region;
+    uint32_t head = region->sq_head;
+    uint64_t idle_since = 0;
+
+    while (!syscall_ring_stopping(ring)) {
+        uint32_t tail = __atomic_load_n(&region->sq_tail, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            while (head != tail && !syscall_ring_stopping(ring)) {
+                mirix_sysring_sqe_t sqe = region->sqes[head & SYSRING_SQ_MASK];
+                __atomic_store_n(&region->sq_head, ++head, __ATOMIC_RELEASE);
+
+                mirix_sysring_cqe_t cqe;
+                syscall_ring_execute(ring, &sqe, &cqe);
+                syscall_ring_post(ring, &cqe, true);
+            }
+            idle_since = 0;
+            continue;
+        }
+
+        uint32_t idle_us = region->idle_us;
+        if (idle_us) {
+            uint64_t now = syscall_ring_now_us();
+            if (idle_since == 0) {
+                idle_since = now;
+            }
+            if (now - idle_since < idle_us) {
+                syscall_ring_relax();
+                continue;
+            }
+        }
+
+        // Advertise the sleep, then look again: a submitter either sees
+        // NEED_WAKEUP and rings, or its tail is seen here
+        uint32_t bell = __atomic_load_n(&region->doorbell, __ATOMIC_ACQUIRE);
+        __atomic_or_fetch(&region->flags, MIRIX_SYSRING_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        // No timeout: destroy sets stop before it rings the bell, so
+        // either the bell moved past this value or stop is seen here
+        if (__atomic_load_n(&region->sq_tail, __ATOMIC_ACQUIRE) == head && !syscall_ring_stopping(ring)) {
+            ipc_futex_wait(&region->doorbell, bell, -1);
+        }
+        __atomic_and_fetch(&region->flags, ~MIRIX_SYSRING_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        idle_since = 0;
+    }
+    return NULL;
+}
+
+// Create a ring's shared region; the name goes to the program in MIRIX_SYSRING
+syscall_ring_t *syscall_ring_create(void) {
+    syscall_ring_t *ring = calloc(1, sizeof(syscall_ring_t));
+    if (!ring) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&syscall_ring_state.lock);
+    int slot = 0;
+    while (slot < MIRIX_SYSRING_MAX_RINGS && syscall_ring_state.rings[slot]) {
+        slot++;
+    }
+    if (slot == MIRIX_SYSRING_MAX_RINGS) {
+        pthread_mutex_unlock(&syscall_ring_state.lock);
+        free(ring);
+        return NULL;
+    }
+    ring->slot = slot;
+    ring->generation = ++syscall_ring_state.generation;
+    snprintf(ring->name, sizeof(ring->name), "/mirix_sysring.%d.%u",
+             (int)getpid(), syscall_ring_state.created++);
+    for (int i = 0; i < MIRIX_SYSRING_MAX_TIMERS; i++) {
+        ring->timers[i] = -1;
+    }
+    pthread_mutex_init(&ring->cq_lock, NULL);
+    syscall_ring_state.rings[slot] = ring;
+    pthread_mutex_unlock(&syscall_ring_state.lock);
+
+    shm_unlink(ring->name);
+    int fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        perror("shm_open");
+        syscall_ring_destroy(ring);
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(mirix_sysring_region_t)) != 0) {
+        perror("ftruncate");
+        close(fd);
+        syscall_ring_destroy(ring);
+        return NULL;
+    }
+    void *mapping = mmap(NULL, sizeof(mirix_sysring_region_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        syscall_ring_destroy(ring);
+        return NULL;
+    }
+
+    // Fresh segments are zero-filled
+    ring->region = (mirix_sysring_region_t *)mapping;
+    ring->region->idle_us = __atomic_load_n(&syscall_ring_state.idle_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&ring->region->magic, MIRIX_SYSRING_MAGIC, __ATOMIC_RELEASE);
+    return ring;
+}
+
+const char *syscall_ring_name(const syscall_ring_t *ring) {
+    return ring ? ring->name : NULL;
+}
+
+// Start serving a ring for the program with this pid
+int syscall_ring_start(syscall_ring_t *ring, uint32_t pid) {
+    if (!ring || !ring->region || ring->started) {
+        return -1;
+    }
+    ring->pid = pid;
+    ring->region->pid = pid;
+    if (pthread_create(&ring->thread, NULL, syscall_ring_service, ring) != 0) {
+        perror("pthread_create");
+        return -1;
+    }
+    ring->started = true;
+    return 0;
+}
+
+void syscall_ring_destroy(syscall_ring_t *ring) {
+    if (!ring) {
+        return;
+    }
+
+    if (ring->started) {
+        __atomic_store_n(&ring->stop, true, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&ring->region->doorbell, 1, __ATOMIC_RELEASE);
+        ipc_futex_wake(&ring->region->doorbell, true);
+        pthread_join(ring->thread, NULL);
+    }
+
+    // Expiries look the ring up under the lock, so none can follow this
+    pthread_mutex_lock(&syscall_ring_state.lock);
+    syscall_ring_state.rings[ring->slot] = NULL;
+    for (int i = 0; i < MIRIX_SYSRING_MAX_TIMERS; i++) {
+        if (ring->timers[i] >= 0) {
+            host_interface_cancel_timer(ring->timers[i]);
+        }
+    }
+    pthread_mutex_unlock(&syscall_ring_state.lock);
+
+    if (ring->region) {
+        munmap(ring->region, sizeof(mirix_sysring_region_t));
+        shm_unlink(ring->name);
+    }
+    pthread_mutex_destroy(&ring->cq_lock);
+    free(ring);
+}
@@ -0,0 +1,115 @@
+#ifndef MIRIX_SYSCALL_RING_H
+#define MIRIX_SYSCALL_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../kernel.h"
+
+// Shared-memory syscall rings: a program posts mirix_syscall_t requests
+// into a submission queue and a kernel thread posts results into a
+// completion queue, io_uring style. One doorbell covers any number of
+// queued calls; in polling mode the kernel thread watches the queue and
+// no doorbell is needed while it is awake.
+
+// Queue depths (powers of two); the completion queue absorbs timer expiries
+#define MIRIX_SYSRING_SQ_ENTRIES 256
+#define MIRIX_SYSRING_CQ_ENTRIES 512
+
+// Payload area shared by the program and the kernel. Requests name
+// buffers by offset into it, since the two map it at different addresses.
+#define MIRIX_SYSRING_DATA_SIZE (256 * 1024)
+
+#define MIRIX_SYSRING_MAGIC 0x4D535952 // 'MSYR'
+#define MIRIX_SYSRING_NAME_MAX 48
+
+// Environment variable naming a launched program's ring
+#define MIRIX_SYSRING_ENV "MIRIX_SYSRING"
+
+// Rings served at once, and ring-created timers per ring
+#define MIRIX_SYSRING_MAX_RINGS 64
+#define MIRIX_SYSRING_MAX_TIMERS 32
+
+// Header flags (kernel to program)
+#define MIRIX_SYSRING_NEED_WAKEUP 0x1u    // Kernel thread asleep: ring the doorbell
+
+// Submission flags
+#define MIRIX_SYSRING_TIMER_PERIODIC 0x1u // TIMER_CREATE: rearm after each expiry
+
+// Completion flags
+#define MIRIX_SYSRING_CQE_TIMER 0x1u      // Timer expiry, not a submission result
+
+// One request. Fields by opcode (others complete with ENOSYS):
+//   IPC_SEND               fd = target pid, offset/len of the payload, ipc_flags
+//   IPC_RECV(_TIMEOUT)     offset/len of the buffer, arg = timeout ms (RECV waits
+//                          forever, stalling the ring until a message comes)
+//   TIMER_CREATE           arg = interval ms, flags; expiries complete with user_data
+//   TIMER_DELETE           arg = timer id
+typedef struct {
+    uint64_t user_data;    // Echoed in the completion
+    uint32_t opcode;       // mirix_syscall_t
+    int32_t fd;
+    uint32_t offset;       // Into the data area
+    uint32_t len;
+    uint32_t flags;
+    uint32_t ipc_flags;
+    int64_t arg;
+} mirix_sysring_sqe_t;
+
+// One result: res is what the direct call returns, error its errno
+typedef struct {
+    uint64_t user_data;
+    int32_t res;
+    int32_t error;
+    uint32_t flags;
+    uint32_t aux;          // IPC_RECV: sender pid
+} mirix_sysring_cqe_t;
+
+// Shared region. Producer and consumer indices sit on their own cache
+// lines; indices run freely and are masked on use.
+typedef struct {
+    uint32_t magic;
+    uint32_t pid;          // Program the ring serves
+    uint32_t idle_us;      // Polling mode: kernel spin before sleeping (0 = doorbell mode)
+    uint32_t flags;        // MIRIX_SYSRING_NEED_WAKEUP
+    uint32_t doorbell;     // Futex word the kernel thread sleeps on
+    uint32_t cq_overflow;  // Timer expiries dropped on a full completion queue
+    uint8_t pad0[40];
+    uint32_t sq_head;      // Kernel end
+    uint8_t pad1[60];
+    uint32_t sq_tail;      // Program end
+    uint8_t pad2[60];
+    uint32_t cq_head;      // Program end
+    uint32_t cq_waiters;   // Program threads parked on cq_tail
+    uint8_t pad3[56];
+    uint32_t cq_tail;      // Kernel end
+    uint8_t pad4[60];
+    mirix_sysring_sqe_t sqes[MIRIX_SYSRING_SQ_ENTRIES];
+    mirix_sysring_cqe_t cqes[MIRIX_SYSRING_CQ_ENTRIES];
+    uint8_t data[MIRIX_SYSRING_DATA_SIZE];
+} mirix_sysring_region_t;
+
+// Kernel side
+typedef struct syscall_ring syscall_ring_t;
+
+// Kernel threads poll for this long before sleeping (0 = doorbell only)
+void syscall_ring_set_poll(uint32_t idle_us);
+
+// Create a ring before forking a program, start serving it once the pid
+// is known, and destroy it after the program exits
+syscall_ring_t *syscall_ring_create(void);
+const char *syscall_ring_name(const syscall_ring_t *ring);
+int syscall_ring_start(syscall_ring_t *ring, uint32_t pid);
+void syscall_ring_destroy(syscall_ring_t *ring);
+
+// Program side (libsyscall); one thread submits and one reaps
+int syscall_ring_attach(void);
+void syscall_ring_detach(void);
+void *syscall_ring_buffer(size_t *size);
+mirix_sysring_sqe_t *syscall_ring_get_sqe(void);
+int syscall_ring_submit(void);
+mirix_sysring_cqe_t *syscall_ring_peek_cqe(void);
+mirix_sysring_cqe_t *syscall_ring_wait_cqe(int timeout_ms);
+void syscall_ring_cqe_seen(void);
+
+#endif // MIRIX_SYSCALL_RING_H
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "syscall_ring.h"
+#include "syscall.h"
+#include "../ipc/ipc.h"
+#include "../host/host_interface.h"
+#include "../libsyscall/libsyscall.h"
+
+// Syscall ring regression tests
+// The test is both sides: the kernel (ring service thread, host event
+// loop on its own thread) and the program (ring API and libsyscall) for
+// a ring that serves this process's own pid.
+
+#define TEST_ID_BASE 0x7d000000u
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+static syscall_ring_t *test_ring;
+static pthread_t test_host_thread;
+static bool test_host_stop;
+
+// Timer expiries run on whoever polls host events, as in the kernel
+static void *test_host_loop(void *arg) {
+    (void)arg;
+    while (!__atomic_load_n(&test_host_stop, __ATOMIC_ACQUIRE)) {
+        host_interface_poll_events(-1);
+    }
+    return NULL;
+}
+
+static void test_begin(const char *name) {
+    printf("%s\n", name);
+    host_interface_init();
+    ipc_system_init_mode(MIRIX_IPC_MODE_PRIVATE);
+    syscall_init();
+
+    test_ring = syscall_ring_create();
+    if (test_ring) {
+        setenv(MIRIX_SYSRING_ENV, syscall_ring_name(test_ring), 1);
+        syscall_ring_start(test_ring, (uint32_t)getpid());
+    }
+    __atomic_store_n(&test_host_stop, false, __ATOMIC_RELEASE);
+    pthread_create(&test_host_thread, NULL, test_host_loop, NULL);
+}
+
+static void test_end(void) {
+    __atomic_store_n(&test_host_stop, true, __ATOMIC_RELEASE);
+    host_interface_wakeup();
+    pthread_join(test_host_thread, NULL);
+
+    syscall_ring_detach();
+    syscall_ring_destroy(test_ring);
+    test_ring = NULL;
+    unsetenv(MIRIX_SYSRING_ENV);
+    syscall_cleanup();
+    ipc_system_cleanup();
+    host_interface_cleanup();
+}
+
+// Wait for the service thread to go to sleep on the doorbell
+static bool test_wait_need_wakeup(mirix_sysring_region_t *region) {
+    for (int i = 0; i < 2000; i++) {
+        if (__atomic_load_n(&region->flags, __ATOMIC_ACQUIRE) & MIRIX_SYSRING_NEED_WAKEUP) {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+// Submit to a sleeping service thread: the doorbell wakes it, the send
+// lands in the receiver's mailbox and the result comes back as a CQE.
+// A raw-fd WRITE is refused.
+static void test_round_trip(void) {
+    const uint32_t receiver = TEST_ID_BASE;
+    TEST_CHECK(test_ring != NULL, "ring not created");
+    TEST_CHECK(syscall_ring_attach() == 0, "attach failed");
+
+    size_t size = 0;
+    uint8_t *data = syscall_ring_buffer(&size);
+    TEST_CHECK(data && size == MIRIX_SYSRING_DATA_SIZE, "no data area");
+    mirix_sysring_region_t *region = (mirix_sysring_region_t *)(data - offsetof(mirix_sysring_region_t, data));
+
+    for (int round = 0; round < 3; round++) {
+        TEST_CHECK(test_wait_need_wakeup(region), "round %d: service thread never slept", round);
+
+        memcpy(data, "ping", 4);
+        mirix_sysring_sqe_t *sqe = syscall_ring_get_sqe();
+        TEST_CHECK(sqe != NULL, "round %d: submission queue full", round);
+        sqe->opcode = MIRIX_SYSCALL_IPC_SEND;
+        sqe->fd = (int32_t)receiver;
+        sqe->offset = 0;
+        sqe->len = 4;
+        sqe->user_data = 100 + (uint64_t)round;
+
+        sqe = syscall_ring_get_sqe();
+        TEST_CHECK(sqe != NULL, "round %d: submission queue full", round);
+        sqe->opcode = MIRIX_SYSCALL_WRITE;
+        sqe->fd = 1;
+        sqe->len = 4;
+        sqe->user_data = 200 + (uint64_t)round;
+        TEST_CHECK(syscall_ring_submit() == 2, "round %d: submit did not publish 2 entries", round);
+
+        mirix_sysring_cqe_t *cqe = syscall_ring_wait_cqe(2000);
+        TEST_CHECK(cqe != NULL, "round %d: no completion for the send", round);
+        TEST_CHECK(cqe->user_data == 100 + (uint64_t)round && cqe->res == 0,
+                   "round %d: send completed as %llu res %d", round, (unsigned long long)cqe->user_data, cqe->res);
+        syscall_ring_cqe_seen();
+
+        cqe = syscall_ring_wait_cqe(2000);
+        TEST_CHECK(cqe != NULL, "round %d: no completion for the write", round);
+        TEST_CHECK(cqe->user_data == 200 + (uint64_t)round && cqe->res == -1 && cqe->error == ENOSYS,
+                   "round %d: write completed as res %d error %d", round, cqe->res, cqe->error);
+        syscall_ring_cqe_seen();
+
+        char buf[8];
+        mirix_message_info_t info;
+        TEST_CHECK(ipc_receive_into(receiver, &info, buf, sizeof(buf), 0) == 0, "round %d: send not delivered", round);
+        TEST_CHECK(info.sender_pid == (uint32_t)getpid() && info.data_size == 4 && memcmp(buf, "ping", 4) == 0,
+                   "round %d: delivered %zu bytes from %u", round, info.data_size, info.sender_pid);
+    }
+}
+
+// Timers created through libsyscall fire from the host event loop and
+// come back as timer completions
+static void test_timers(void) {
+    TEST_CHECK(test_ring != NULL, "ring not created");
+
+    int once = mirix_sys_timer_create(20, 0);
+    TEST_CHECK(once >= 0, "one-shot timer not created (errno %d)", errno);
+    TEST_CHECK(mirix_sys_timer_wait(2000) == once, "one-shot timer did not fire");
+    TEST_CHECK(mirix_sys_timer_wait(100) == -1 && errno == ETIMEDOUT, "one-shot timer fired twice");
+
+    int periodic = mirix_sys_timer_create(10, MIRIX_SYSRING_TIMER_PERIODIC);
+    TEST_CHECK(periodic >= 0, "periodic timer not created (errno %d)", errno);
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK(mirix_sys_timer_wait(2000) == periodic, "periodic expiry %d missing", i);
+    }
+    TEST_CHECK(mirix_sys_timer_delete(periodic) == 0, "periodic timer not deleted");
+    TEST_CHECK(mirix_sys_timer_delete(periodic) == -1 && errno == EINVAL, "deleted timer deleted again");
+}
+
+int main(void) {
+    test_begin("round trip");
+    test_round_trip();
+    test_end();
+
+    test_begin("timers");
+    test_timers();
+    test_end();
+
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All syscall ring tests passed\n");
+    return 0;
+}
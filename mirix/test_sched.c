@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+
+// Scheduler regression tests
+// Policy tests drive one CPU by hand with scheduler_tick, so which process
+// a switch picks is deterministic; stealing and removal during dispatch
+// run on real vCPU threads.
+
+#define TEST_PID_BASE 0x7d000000u
+#define TEST_WAIT_MS 5000
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+static uint64_t test_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void test_spin_us(uint64_t us) {
+    uint64_t until = test_now_ns() + us * 1000ULL;
+    while (test_now_ns() < until) {
+    }
+}
+
+static int test_add(uint32_t pid, int priority, mirix_kernel_status_t status) {
+    mirix_process_t process;
+    memset(&process, 0, sizeof(process));
+    process.pid = pid;
+    snprintf(process.name, sizeof(process.name), "test-%08x", pid);
+    process.status = status;
+    process.priority = priority;
+    return scheduler_add_process(&process);
+}
+
+static void test_begin(const char *name, int cpus) {
+    printf("%s\n", name);
+    scheduler_init_cpus(cpus);
+}
+
+static void test_end(void) {
+    scheduler_stop();
+    scheduler_cleanup();
+    scheduler_set_dispatch(NULL);
+}
+
+// Run one quantum on the hand-driven CPU and return the pid it picked (0 = none)
+static uint32_t test_quantum(void) {
+    for (int i = 0; i < 1000; i++) {
+        scheduler_tick();
+    }
+    mirix_process_t *current = scheduler_get_current_process();
+    return current ? current->pid : 0;
+}
+
+// Mirrors sched_pid_hash, to build probe chains on purpose
+#define TEST_INDEX_SIZE (MIRIX_SCHED_INITIAL_PROCESSES * 2)
+
+static uint32_t test_pid_home(uint32_t pid) {
+    return (pid * 2654435761u) & (TEST_INDEX_SIZE - 1);
+}
+
+// Smallest pid at or above TEST_PID_BASE with the given index home; adding
+// multiples of the index size keeps the home
+static uint32_t test_pid_at(uint32_t home) {
+    uint32_t pid = TEST_PID_BASE;
+    while (test_pid_home(pid) != home) {
+        pid++;
+    }
+    return pid;
+}
+
+#define TEST_CHAIN 4
+
+// Deleting from the pid index shifts later entries of a probe run back,
+// including runs that wrap past the end of the index and entries whose
+// home lies inside the run
+static void test_pid_index(void) {
+    uint32_t wrapping[TEST_CHAIN], following[TEST_CHAIN];
+    for (uint32_t i = 0; i < TEST_CHAIN; i++) {
+        // Homes end-2 (wraps to positions 0 and 1) and 0 (pushed behind them)
+        wrapping[i] = test_pid_at(TEST_INDEX_SIZE - 2) + i * TEST_INDEX_SIZE;
+        following[i] = test_pid_at(0) + i * TEST_INDEX_SIZE;
+    }
+    for (int i = 0; i < TEST_CHAIN; i++) {
+        TEST_CHECK(test_add(wrapping[i], MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0,
+                   "pid %#x not added", wrapping[i]);
+        TEST_CHECK(test_add(following[i], MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0,
+                   "pid %#x not added", following[i]);
+    }
+    TEST_CHECK(test_add(wrapping[0], MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == -1,
+               "duplicate pid accepted");
+
+    // Empty the wrapping run from the front; the rest must stay reachable
+    for (int removed = 0; removed < TEST_CHAIN; removed++) {
+        TEST_CHECK(scheduler_remove_process(wrapping[removed]) == 0, "pid %#x not removed", wrapping[removed]);
+        TEST_CHECK(scheduler_find_process(wrapping[removed]) == NULL, "removed pid %#x still found",
+                   wrapping[removed]);
+        for (int i = removed + 1; i < TEST_CHAIN; i++) {
+            mirix_process_t *process = scheduler_find_process(wrapping[i]);
+            TEST_CHECK(process && process->pid == wrapping[i], "pid %#x lost", wrapping[i]);
+        }
+        for (int i = 0; i < TEST_CHAIN; i++) {
+            mirix_process_t *process = scheduler_find_process(following[i]);
+            TEST_CHECK(process && process->pid == following[i], "pid %#x lost", following[i]);
+        }
+    }
+
+    // Middle of a run, then add back into the hole
+    TEST_CHECK(scheduler_remove_process(following[1]) == 0, "pid %#x not removed", following[1]);
+    TEST_CHECK(scheduler_find_process(following[1]) == NULL, "removed pid %#x still found", following[1]);
+    TEST_CHECK(scheduler_find_process(following[3]) != NULL, "pid %#x lost", following[3]);
+    TEST_CHECK(test_add(following[1], MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0,
+               "pid %#x not re-added", following[1]);
+    for (int i = 0; i < TEST_CHAIN; i++) {
+        TEST_CHECK(scheduler_remove_process(following[i]) == 0, "pid %#x not removed", following[i]);
+    }
+    TEST_CHECK(scheduler_remove_process(following[0]) == -1, "pid removed twice");
+}
+
+// The highest priority (lowest number) runnable process always wins;
+// equal priorities take turns; lower ones run once the higher stop
+static void test_priority(void) {
+    uint32_t high = TEST_PID_BASE + 1, peer = TEST_PID_BASE + 2, low = TEST_PID_BASE + 3;
+    TEST_CHECK(test_add(low, 40, MIRIX_KERNEL_RUNNING) == 0, "low not added");
+    TEST_CHECK(test_add(high, 10, MIRIX_KERNEL_RUNNING) == 0, "high not added");
+
+    for (int i = 0; i < 4; i++) {
+        uint32_t pid = test_quantum();
+        TEST_CHECK(pid == high, "quantum %d ran %#x", i, pid);
+    }
+
+    TEST_CHECK(test_add(peer, 10, MIRIX_KERNEL_RUNNING) == 0, "peer not added");
+    uint32_t previous = test_quantum();
+    for (int i = 0; i < 4; i++) {
+        uint32_t pid = test_quantum();
+        TEST_CHECK((pid == high || pid == peer) && pid != previous, "quantum %d ran %#x after %#x", i, pid,
+                   previous);
+        previous = pid;
+    }
+
+    TEST_CHECK(scheduler_set_status(high, MIRIX_KERNEL_STOPPED) == 0, "high not stopped");
+    TEST_CHECK(scheduler_set_priority(peer, 50) == 0, "peer priority not changed");
+    for (int i = 0; i < 3; i++) {
+        uint32_t pid = test_quantum();
+        TEST_CHECK(pid == low, "quantum %d ran %#x", i, pid);
+    }
+}
+
+#define TEST_WEIGHT_QUANTA 400
+#define TEST_SLICE_US 200
+
+// Two groups with weights 1024 and 3072 split one CPU about 1:3
+static void test_weights(void) {
+    int light = scheduler_add_group("light", 1024, 0);
+    int heavy = scheduler_add_group("heavy", 3072, 0);
+    TEST_CHECK(light > 0 && heavy > 0, "groups not added");
+
+    uint32_t light_pid = TEST_PID_BASE + 1, heavy_pid = TEST_PID_BASE + 2;
+    TEST_CHECK(test_add(light_pid, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0, "light not added");
+    TEST_CHECK(test_add(heavy_pid, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0, "heavy not added");
+    TEST_CHECK(scheduler_set_group(light_pid, light) == 0 && scheduler_set_group(heavy_pid, heavy) == 0,
+               "processes not moved to their groups");
+    scheduler_set_status(light_pid, MIRIX_KERNEL_RUNNING);
+    scheduler_set_status(heavy_pid, MIRIX_KERNEL_RUNNING);
+
+    int light_quanta = 0, heavy_quanta = 0;
+    for (int i = 0; i < TEST_WEIGHT_QUANTA; i++) {
+        uint32_t pid = test_quantum();
+        light_quanta += pid == light_pid;
+        heavy_quanta += pid == heavy_pid;
+        test_spin_us(TEST_SLICE_US);
+    }
+    test_quantum();
+
+    scheduler_latency_stats_t light_stats, heavy_stats;
+    TEST_CHECK(scheduler_get_process_stats(light_pid, &light_stats) == 0 &&
+               scheduler_get_process_stats(heavy_pid, &heavy_stats) == 0, "no stats");
+    TEST_CHECK(light_quanta > 0 && light_quanta + heavy_quanta == TEST_WEIGHT_QUANTA,
+               "quanta split %d:%d", light_quanta, heavy_quanta);
+
+    // Slices are about equal, so picks follow the weights; the runtime the
+    // picks were based on also carries host preemption noise
+    double picks = (double)heavy_quanta / (double)light_quanta;
+    double ratio = (double)heavy_stats.run_ns_total / (double)light_stats.run_ns_total;
+    TEST_CHECK(picks > 2.5 && picks < 3.5, "quanta split %d:%d", light_quanta, heavy_quanta);
+    TEST_CHECK(ratio > 2.0 && ratio < 4.5, "runtime ratio %.2f", ratio);
+}
+
+// A group capped at 20% of a vCPU gets about that much of an otherwise
+// idle CPU, measured over several cap periods
+static void test_cap(void) {
+    int capped = scheduler_add_group("capped", MIRIX_SCHED_DEFAULT_WEIGHT, 20);
+    TEST_CHECK(capped > 0, "group not added");
+
+    uint32_t pid = TEST_PID_BASE + 1;
+    TEST_CHECK(test_add(pid, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0, "process not added");
+    TEST_CHECK(scheduler_set_group(pid, capped) == 0, "process not moved to its group");
+    scheduler_set_status(pid, MIRIX_KERNEL_RUNNING);
+
+    uint64_t span_ns = 5 * MIRIX_SCHED_CAP_PERIOD_US * 1000ULL;
+    uint64_t start = test_now_ns();
+    int throttled = 0;
+    while (test_now_ns() - start < span_ns) {
+        throttled += test_quantum() == 0;
+        test_spin_us(TEST_SLICE_US);
+    }
+    test_quantum();
+    uint64_t elapsed = test_now_ns() - start;
+
+    scheduler_latency_stats_t stats;
+    TEST_CHECK(scheduler_get_process_stats(pid, &stats) == 0, "no stats");
+    double share = (double)stats.run_ns_total / (double)elapsed;
+    TEST_CHECK(throttled > 0, "never throttled");
+    TEST_CHECK(share > 0.15 && share < 0.27, "capped group got %.1f%% of the CPU", share * 100.0);
+}
+
+// Deadline admission on one vCPU stops at MIRIX_SCHED_DL_MAX_PERCENT of it
+static void test_edf_admission(void) {
+    uint32_t a = TEST_PID_BASE + 1, b = TEST_PID_BASE + 2, c = TEST_PID_BASE + 3, d = TEST_PID_BASE + 4;
+    for (uint32_t pid = a; pid <= d; pid++) {
+        TEST_CHECK(test_add(pid, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0, "pid %#x not added", pid);
+    }
+
+    TEST_CHECK(scheduler_set_deadline(a, 500, 0, 1000) == 0, "50%% not admitted");
+    TEST_CHECK(scheduler_set_deadline(b, 400, 0, 1000) == 0, "50%% + 40%% not admitted");
+    TEST_CHECK(scheduler_set_deadline(c, 100, 0, 1000) == -1, "50%% + 40%% + 10%% admitted");
+    TEST_CHECK(scheduler_set_deadline(c, 100, 500, 1000) == -1, "density 20%% on top of 90%% admitted");
+    TEST_CHECK(scheduler_set_deadline(d, 50, 0, 1000) == 0, "95%% in total not admitted");
+    TEST_CHECK(scheduler_set_deadline(c, 10, 0, 1000) == -1, "96%% in total admitted");
+
+    // Changing a task's parameters is checked without its old share
+    TEST_CHECK(scheduler_set_deadline(a, 450, 0, 1000) == 0, "shrinking an admitted task rejected");
+    TEST_CHECK(scheduler_set_deadline(a, 510, 0, 1000) == -1, "growing past the limit admitted");
+
+    // Leaving the deadline class gives its share back
+    TEST_CHECK(scheduler_set_deadline(b, 0, 0, 0) == 0, "leaving the deadline class failed");
+    TEST_CHECK(scheduler_set_deadline(c, 100, 0, 1000) == 0, "freed share not reused");
+
+    scheduler_cpu_stats_t stats;
+    TEST_CHECK(scheduler_get_cpu_stats(0, &stats) == 0, "no cpu stats");
+    TEST_CHECK(stats.dl_bandwidth_percent >= 59 && stats.dl_bandwidth_percent <= 60,
+               "admitted bandwidth %u%%", stats.dl_bandwidth_percent);
+}
+
+#define TEST_STEAL_PROCESSES 6
+#define TEST_STEAL_MS 100
+
+// Dispatches per process and vCPU, written by the vCPU threads
+static uint32_t test_ran[TEST_STEAL_PROCESSES][2];
+
+static void test_steal_dispatch(mirix_process_t *process, int cpu) {
+    uint32_t i = process->pid - TEST_PID_BASE - 1;
+    if (i < TEST_STEAL_PROCESSES) {
+        __atomic_add_fetch(&test_ran[i][cpu], 1, __ATOMIC_RELAXED);
+    }
+    usleep(TEST_SLICE_US);
+}
+
+// Everything starts queued on vCPU 0; the idle vCPU 1 steals unpinned
+// processes but never the pinned one
+static void test_steal(void) {
+    scheduler_set_dispatch(test_steal_dispatch);
+    for (uint32_t i = 0; i < TEST_STEAL_PROCESSES; i++) {
+        uint32_t pid = TEST_PID_BASE + 1 + i;
+        TEST_CHECK(test_add(pid, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_STOPPED) == 0, "pid %#x not added", pid);
+        TEST_CHECK(scheduler_set_affinity(pid, 0, i == 0) == 0, "pid %#x affinity not set", pid);
+    }
+    for (uint32_t i = 0; i < TEST_STEAL_PROCESSES; i++) {
+        scheduler_set_status(TEST_PID_BASE + 1 + i, MIRIX_KERNEL_RUNNING);
+    }
+
+    TEST_CHECK(scheduler_start() == 0, "vCPUs not started");
+    usleep(TEST_STEAL_MS * 1000);
+    scheduler_stop();
+
+    scheduler_cpu_stats_t stats;
+    TEST_CHECK(scheduler_get_cpu_stats(1, &stats) == 0, "no cpu stats");
+    TEST_CHECK(stats.steals > 0, "vCPU 1 never stole");
+    TEST_CHECK(test_ran[0][0] > 0, "pinned process never ran");
+    TEST_CHECK(test_ran[0][1] == 0, "pinned process ran %u times on vCPU 1", test_ran[0][1]);
+
+    uint32_t stolen_runs = 0;
+    for (int i = 1; i < TEST_STEAL_PROCESSES; i++) {
+        stolen_runs += test_ran[i][1];
+    }
+    TEST_CHECK(stolen_runs > 0, "no unpinned process ran on vCPU 1");
+}
+
+static int test_remove_stage;
+static uint32_t test_remove_seen;
+
+static void test_remove_dispatch(mirix_process_t *process, int cpu) {
+    (void)cpu;
+    if (process->pid == TEST_PID_BASE + 1 && __atomic_load_n(&test_remove_stage, __ATOMIC_ACQUIRE) == 0) {
+        __atomic_store_n(&test_remove_stage, 1, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&test_remove_stage, __ATOMIC_ACQUIRE) != 2) {
+            usleep(1000);
+        }
+        // The entry must still be intact while the vCPU holds it
+        __atomic_store_n(&test_remove_seen, process->pid, __ATOMIC_RELEASE);
+        return;
+    }
+    if (process->pid == TEST_PID_BASE + 2) {
+        __atomic_store_n(&test_remove_stage, 3, __ATOMIC_RELEASE);
+    }
+    usleep(TEST_SLICE_US);
+}
+
+static bool test_wait_stage(int stage) {
+    for (int i = 0; i < TEST_WAIT_MS; i++) {
+        if (__atomic_load_n(&test_remove_stage, __ATOMIC_ACQUIRE) == stage) {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+// Removing a process while a vCPU is inside dispatch for it leaves the
+// entry alone until dispatch returns; the slot is reused afterwards
+static void test_remove_dispatching(void) {
+    scheduler_set_dispatch(test_remove_dispatch);
+    TEST_CHECK(test_add(TEST_PID_BASE + 1, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_RUNNING) == 0,
+               "process not added");
+    TEST_CHECK(scheduler_start() == 0, "vCPU not started");
+    TEST_CHECK(test_wait_stage(1), "process never dispatched");
+
+    // Let dispatch return before checking, so a failure cannot wedge the vCPU
+    int removed = scheduler_remove_process(TEST_PID_BASE + 1);
+    mirix_process_t *found = scheduler_find_process(TEST_PID_BASE + 1);
+    __atomic_store_n(&test_remove_stage, 2, __ATOMIC_RELEASE);
+    TEST_CHECK(removed == 0, "process not removed");
+    TEST_CHECK(found == NULL, "removed process still found");
+
+    TEST_CHECK(test_add(TEST_PID_BASE + 2, MIRIX_SCHED_DEFAULT_PRIORITY, MIRIX_KERNEL_RUNNING) == 0,
+               "second process not added");
+    TEST_CHECK(test_wait_stage(3), "second process never dispatched");
+    TEST_CHECK(__atomic_load_n(&test_remove_seen, __ATOMIC_ACQUIRE) == TEST_PID_BASE + 1,
+               "dispatch saw pid %#x", test_remove_seen);
+
+    mirix_process_t *second = scheduler_find_process(TEST_PID_BASE + 2);
+    TEST_CHECK(second && second->pid == TEST_PID_BASE + 2, "second process lost");
+}
+
+int main(void) {
+    test_begin("pid index", 1);
+    test_pid_index();
+    test_end();
+
+    test_begin("priority", 1);
+    test_priority();
+    test_end();
+
+    test_begin("group weights", 1);
+    test_weights();
+    test_end();
+
+    test_begin("group cap", 1);
+    test_cap();
+    test_end();
+
+    test_begin("edf admission", 1);
+    test_edf_admission();
+    test_end();
+
+    test_begin("steal", 2);
+    test_steal();
+    test_end();
+
+    test_begin("remove while dispatching", 1);
+    test_remove_dispatching();
+    test_end();
+
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All scheduler tests passed\n");
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "uthread.h"
+#include "scheduler.h"
+#if defined(__x86_64__)
+#include "arch/x86_64/arch.h"
+#endif
+
+// Context switch and green-thread regression tests
+// The switch tests drive arch_context_switch directly; the green-thread
+// tests run a process's threads on real vCPU threads.
+
+#define TEST_PID 0x7c000000u
+#define TEST_WAIT_MS 5000
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        test_failures++; \
+        return; \
+    } \
+} while (0)
+
+// Wait up to TEST_WAIT_MS for a flag set by a green thread
+static bool test_wait_flag(int *flag, int value) {
+    for (int i = 0; i < TEST_WAIT_MS; i++) {
+        if (__atomic_load_n(flag, __ATOMIC_ACQUIRE) == value) {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+#if defined(__x86_64__)
+
+#ifdef __APPLE__
+#define TEST_ASM_FUNCTION(name) ".globl _" name "\n_" name ":\n"
+#define TEST_ASM_CALL(name) "    callq _" name "\n"
+#else
+#define TEST_ASM_FUNCTION(name) ".globl " name "\n.type " name ", @function\n" name ":\n"
+#define TEST_ASM_CALL(name) "    callq " name "\n"
+#endif
+
+// Load a pattern into every callee-saved register, switch from -> to and
+// store what those registers hold once something switches back in out[]
+// (rbx, rbp, r12-r15)
+void test_switch_patterned(arch_context_t *from, arch_context_t *to, uint64_t *out);
+
+// Clobber the callee-saved registers, MXCSR and the x87 control word,
+// then switch from -> to
+void test_switch_clobbered(arch_context_t *from, arch_context_t *to);
+
+__asm__(
+    ".text\n"
+    ".p2align 4\n"
+    TEST_ASM_FUNCTION("test_switch_patterned")
+    "    pushq %rbx\n"
+    "    pushq %rbp\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    pushq %rdx\n"                     // out, and realigns the stack
+    "    movabsq $0x1111111111111111, %rbx\n"
+    "    movabsq $0x2222222222222222, %rbp\n"
+    "    movabsq $0x3333333333333333, %r12\n"
+    "    movabsq $0x4444444444444444, %r13\n"
+    "    movabsq $0x5555555555555555, %r14\n"
+    "    movabsq $0x6666666666666666, %r15\n"
+    TEST_ASM_CALL("arch_context_switch")
+    "    popq %rdx\n"
+    "    movq %rbx, 0(%rdx)\n"
+    "    movq %rbp, 8(%rdx)\n"
+    "    movq %r12, 16(%rdx)\n"
+    "    movq %r13, 24(%rdx)\n"
+    "    movq %r14, 32(%rdx)\n"
+    "    movq %r15, 40(%rdx)\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbp\n"
+    "    popq %rbx\n"
+    "    ret\n"
+    ".p2align 4\n"
+    TEST_ASM_FUNCTION("test_switch_clobbered")
+    "    pushq %rbx\n"
+    "    pushq %rbp\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    movl $0x7f80, (%rsp)\n"           // All exceptions masked, round to zero
+    "    ldmxcsr (%rsp)\n"
+    "    movw $0x0f7f, (%rsp)\n"           // x87 round to zero
+    "    fldcw (%rsp)\n"
+    "    movq $-1, %rbx\n"
+    "    movq $-1, %rbp\n"
+    "    movq $-1, %r12\n"
+    "    movq $-1, %r13\n"
+    "    movq $-1, %r14\n"
+    "    movq $-1, %r15\n"
+    TEST_ASM_CALL("arch_context_switch")
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbp\n"
+    "    popq %rbx\n"
+    "    ret\n"
+);
+
+static arch_context_t test_main_context;
+static arch_context_t test_clobber_context;
+static uint8_t test_clobber_stack[64 * 1024];
+static int test_clobber_entries;
+
+static void test_clobber_entry(void *arg) {
+    (void)arg;
+    for (;;) {
+        test_clobber_entries++;
+        test_switch_clobbered(&test_clobber_context, &test_main_context);
+    }
+}
+
+// Callee-saved registers, MXCSR and the x87 control word of the caller
+// survive a round trip through a context that changes all of them
+static void test_context_switch(void) {
+    static const uint64_t pattern[6] = {
+        0x1111111111111111ULL, 0x2222222222222222ULL, 0x3333333333333333ULL,
+        0x4444444444444444ULL, 0x5555555555555555ULL, 0x6666666666666666ULL
+    };
+    static const char *names[6] = { "rbx", "rbp", "r12", "r13", "r14", "r15" };
+    TEST_CHECK(arch_context_init(&test_clobber_context, test_clobber_stack, sizeof(test_clobber_stack),
+                                 test_clobber_entry, NULL) == 0, "context init failed");
+
+    uint32_t mxcsr_before, mxcsr_after;
+    uint16_t fpucw_before, fpucw_after;
+    __asm__ volatile ("stmxcsr %0\n"
+                      "fnstcw %1\n"
+                      : "=m" (mxcsr_before), "=m" (fpucw_before));
+
+    for (int round = 0; round < 3; round++) {
+        uint64_t out[6];
+        test_switch_patterned(&test_main_context, &test_clobber_context, out);
+        __asm__ volatile ("stmxcsr %0\n"
+                          "fnstcw %1\n"
+                          : "=m" (mxcsr_after), "=m" (fpucw_after));
+
+        for (int i = 0; i < 6; i++) {
+            TEST_CHECK(out[i] == pattern[i], "round %d: %s came back as %#llx", round, names[i],
+                       (unsigned long long)out[i]);
+        }
+        TEST_CHECK(mxcsr_after == mxcsr_before, "round %d: mxcsr %#x became %#x", round,
+                   mxcsr_before, mxcsr_after);
+        TEST_CHECK(fpucw_after == fpucw_before, "round %d: x87 control word %#x became %#x", round,
+                   fpucw_before, fpucw_after);
+    }
+    TEST_CHECK(test_clobber_entries == 3, "context ran %d times for 3 switches", test_clobber_entries);
+}
+
+#endif
+
+static void test_begin(const char *name) {
+    printf("%s\n", name);
+}
+
+static void test_end(void) {
+}
+
+// Green threads of one process on two vCPUs
+static void test_begin_runtime(const char *name) {
+    test_begin(name);
+    scheduler_init_cpus(2);
+    uthread_runtime_init();
+
+    mirix_process_t process;
+    memset(&process, 0, sizeof(process));
+    process.pid = TEST_PID;
+    strcpy(process.name, "test-uthread");
+    process.status = MIRIX_KERNEL_STOPPED;
+    process.priority = MIRIX_SCHED_DEFAULT_PRIORITY;
+    scheduler_add_process(&process);
+    scheduler_start();
+}
+
+static void test_end_runtime(void) {
+    scheduler_stop();
+    uthread_runtime_cleanup();
+    scheduler_remove_process(TEST_PID);
+    scheduler_cleanup();
+    test_end();
+}
+
+#define TEST_WORKERS 4
+#define TEST_ROUNDS 5
+
+// Threads of one process never run at the same time, so the trace needs
+// no lock
+static int test_trace[TEST_WORKERS * TEST_ROUNDS];
+static int test_trace_len;
+static int test_join_failures;
+static int test_main_done;
+
+static void test_worker(void *arg) {
+    int id = (int)(intptr_t)arg;
+    for (int i = 0; i < TEST_ROUNDS; i++) {
+        test_trace[test_trace_len++] = id;
+        uthread_yield();
+    }
+}
+
+static void test_main_thread(void *arg) {
+    (void)arg;
+    uthread_t *workers[TEST_WORKERS];
+    for (int i = 0; i < TEST_WORKERS; i++) {
+        workers[i] = uthread_create(TEST_PID, test_worker, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < TEST_WORKERS; i++) {
+        if (!workers[i] || uthread_join(workers[i]) != 0) {
+            test_join_failures++;
+        }
+    }
+    __atomic_store_n(&test_main_done, 1, __ATOMIC_RELEASE);
+}
+
+// create -> yield -> join: workers take turns in creation order and the
+// creating thread gets each of them back
+static void test_create_yield_join(void) {
+    uthread_t *main_thread = uthread_create(TEST_PID, test_main_thread, NULL);
+    TEST_CHECK(main_thread != NULL, "main thread not created");
+    TEST_CHECK(uthread_detach(main_thread) == 0, "main thread not detached");
+    TEST_CHECK(test_wait_flag(&test_main_done, 1), "main thread did not finish");
+
+    TEST_CHECK(test_join_failures == 0, "%d joins failed", test_join_failures);
+    TEST_CHECK(test_trace_len == TEST_WORKERS * TEST_ROUNDS, "trace has %d entries", test_trace_len);
+    for (int i = 0; i < test_trace_len; i++) {
+        TEST_CHECK(test_trace[i] == i % TEST_WORKERS, "step %d ran worker %d", i, test_trace[i]);
+    }
+}
+
+static int test_park_stage;
+
+static void test_park_thread(void *arg) {
+    (void)arg;
+    __atomic_store_n(&test_park_stage, 1, __ATOMIC_RELEASE);
+    uthread_park();
+    __atomic_store_n(&test_park_stage, 2, __ATOMIC_RELEASE);
+}
+
+// A host thread unparks a parked green thread
+static void test_park_unpark(void) {
+    uthread_t *thread = uthread_create(TEST_PID, test_park_thread, NULL);
+    TEST_CHECK(thread != NULL, "thread not created");
+    TEST_CHECK(uthread_detach(thread) == 0, "thread not detached");
+    TEST_CHECK(test_wait_flag(&test_park_stage, 1), "thread never ran");
+
+    usleep(10000);
+    TEST_CHECK(__atomic_load_n(&test_park_stage, __ATOMIC_ACQUIRE) == 1, "park returned without unpark");
+    uthread_unpark(thread);
+    TEST_CHECK(test_wait_flag(&test_park_stage, 2), "unpark did not wake the thread");
+}
+
+int main(void) {
+#if defined(__x86_64__)
+    test_begin("context switch");
+    test_context_switch();
+    test_end();
+#endif
+
+    test_begin_runtime("create yield join");
+    test_create_yield_join();
+    test_end_runtime();
+
+    test_begin_runtime("park unpark");
+    test_park_unpark();
+    test_end_runtime();
+
+    if (test_failures) {
+        printf("%d test(s) failed\n", test_failures);
+        return 1;
+    }
+    printf("All uthread tests passed\n");
+    return 0;
+}
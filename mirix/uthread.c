@@ -0,0 +1,504 @@
+#include "uthread.h"
+#include "scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__)
+#include "arch/x86_64/arch.h"
+typedef arch_context_t uthread_context_t;
+#else
+#include <ucontext.h>
+typedef ucontext_t uthread_context_t;
+#endif
+
+typedef enum {
+    UTHREAD_READY,
+    UTHREAD_RUNNING,
+    UTHREAD_PARKED,
+    UTHREAD_DONE
+} uthread_state_t;
+
+typedef struct uthread_proc uthread_proc_t;
+
+struct uthread {
+    uthread_context_t context;
+    uthread_proc_t *proc;
+    uthread_t *next;            // Ready queue link
+    void *stack;                // Mapping base (guard page included)
+    uthread_fn fn;
+    void *arg;
+    uthread_state_t state;
+    bool wake_pending;          // Unparked while not parked
+    bool exited;                // Returned or called uthread_exit; stack still live
+    bool detached;
+    uthread_t *joiner;
+};
+
+// Green threads of one process. Only the vCPU currently dispatching the
+// process pops the ready queue, so a thread that queued itself is never
+// resumed before its switch away has finished.
+struct uthread_proc {
+    pthread_mutex_t lock;
+    uint32_t pid;
+    uthread_t *ready_head;
+    uthread_t *ready_tail;
+    bool idle;                  // Nothing ready: process is stopped in the scheduler
+    uthread_proc_t *next;       // All procs, for cleanup
+};
+
+// Per vCPU thread: the context dispatch switches from, and the thread on it
+typedef struct {
+    uthread_context_t context;
+    uthread_t *current;
+} uthread_cpu_t;
+
+static struct {
+    pthread_mutex_t lock;       // procs list, stack cache
+    uthread_proc_t *procs;
+    void *stack_cache[MIRIX_UTHREAD_STACK_CACHE];
+    int stack_cached;
+    size_t page_size;
+    bool initialized;
+} uthread_state = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Switches between quantum checks in dispatch (power of two)
+#define MIRIX_UTHREAD_CLOCK_INTERVAL 8
+
+static __thread uthread_cpu_t uthread_cpu;
+
+static void uthread_dispatch(mirix_process_t *process, int cpu);
+
+static uthread_cpu_t *uthread_cpu_address(void) {
+    return &uthread_cpu;
+}
+
+// A green thread can resume on a different vCPU than the one it left, so
+// the TLS address must be recomputed after every switch. Calling through a
+// volatile pointer keeps the compiler from treating it as constant and
+// hoisting it across a switch.
+static uthread_cpu_t *(*volatile uthread_this_cpu)(void) = uthread_cpu_address;
+
+static uint64_t uthread_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__x86_64__)
+
+static int uthread_context_init(uthread_t *thread, void (*entry)(void *), size_t stack_size) {
+    return arch_context_init(&thread->context, (char *)thread->stack + uthread_state.page_size,
+                             stack_size, entry, thread);
+}
+
+static void uthread_context_switch(uthread_context_t *from, uthread_context_t *to) {
+    arch_context_switch(from, to);
+}
+
+#else
+
+static void uthread_context_trampoline(unsigned int hi, unsigned int lo) {
+    uthread_t *thread = (uthread_t *)(((uintptr_t)hi << 16 << 16) | (uintptr_t)lo);
+    thread->fn(thread->arg);
+    uthread_exit();
+}
+
+static int uthread_context_init(uthread_t *thread, void (*entry)(void *), size_t stack_size) {
+    (void)entry;
+    if (getcontext(&thread->context) < 0) {
+        return -1;
+    }
+    uintptr_t self = (uintptr_t)thread;
+    thread->context.uc_stack.ss_sp = (char *)thread->stack + uthread_state.page_size;
+    thread->context.uc_stack.ss_size = stack_size;
+    thread->context.uc_link = NULL;
+    makecontext(&thread->context, (void (*)(void))uthread_context_trampoline, 2,
+                (unsigned int)(self >> 16 >> 16), (unsigned int)self);
+    return 0;
+}
+
+static void uthread_context_switch(uthread_context_t *from, uthread_context_t *to) {
+    swapcontext(from, to);
+}
+
+#endif
+
+// Stacks are mapped with a PROT_NONE guard page at the low end so an
+// overflow faults instead of running into the neighbouring mapping
+static void *uthread_stack_alloc(void) {
+    pthread_mutex_lock(&uthread_state.lock);
+    if (uthread_state.stack_cached > 0) {
+        void *stack = uthread_state.stack_cache[--uthread_state.stack_cached];
+        pthread_mutex_unlock(&uthread_state.lock);
+        return stack;
+    }
+    pthread_mutex_unlock(&uthread_state.lock);
+
+    size_t length = MIRIX_UTHREAD_STACK_SIZE + uthread_state.page_size;
+    void *stack = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED) {
+        return NULL;
+    }
+    if (mprotect(stack, uthread_state.page_size, PROT_NONE) < 0) {
+        munmap(stack, length);
+        return NULL;
+    }
+    return stack;
+}
+
+static void uthread_stack_free(void *stack) {
+    pthread_mutex_lock(&uthread_state.lock);
+    if (uthread_state.stack_cached < MIRIX_UTHREAD_STACK_CACHE) {
+        uthread_state.stack_cache[uthread_state.stack_cached++] = stack;
+        stack = NULL;
+    }
+    pthread_mutex_unlock(&uthread_state.lock);
+
+    if (stack) {
+        munmap(stack, MIRIX_UTHREAD_STACK_SIZE + uthread_state.page_size);
+    }
+}
+
+// Green-thread state of a process, created on its first thread
+static uthread_proc_t *uthread_proc_get(uint32_t pid) {
+    mirix_process_t *process = scheduler_find_process(pid);
+    if (!process) {
+        return NULL;
+    }
+
+    uthread_proc_t *proc = (uthread_proc_t *)__atomic_load_n(&process->user_threads, __ATOMIC_ACQUIRE);
+    if (proc) {
+        return proc;
+    }
+
+    pthread_mutex_lock(&uthread_state.lock);
+    proc = process->user_threads;
+    if (!proc) {
+        proc = calloc(1, sizeof(uthread_proc_t));
+        if (proc) {
+            pthread_mutex_init(&proc->lock, NULL);
+            proc->pid = pid;
+            proc->idle = true;
+            proc->next = uthread_state.procs;
+            uthread_state.procs = proc;
+            __atomic_store_n(&process->user_threads, (void *)proc, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&uthread_state.lock);
+    return proc;
+}
+
+// Queue a thread; the caller holds proc->lock
+static void uthread_make_ready(uthread_proc_t *proc, uthread_t *thread) {
+    thread->state = UTHREAD_READY;
+    thread->next = NULL;
+    if (proc->ready_tail) {
+        proc->ready_tail->next = thread;
+    } else {
+        proc->ready_head = thread;
+    }
+    proc->ready_tail = thread;
+
+    if (proc->idle) {
+        proc->idle = false;
+        scheduler_set_status(proc->pid, MIRIX_KERNEL_RUNNING);
+    }
+}
+
+static uthread_t *uthread_pop_ready(uthread_proc_t *proc) {
+    uthread_t *thread = proc->ready_head;
+    if (thread) {
+        proc->ready_head = thread->next;
+        if (!proc->ready_head) {
+            proc->ready_tail = NULL;
+        }
+        thread->next = NULL;
+    }
+    return thread;
+}
+
+static void uthread_reclaim(uthread_t *thread) {
+    uthread_stack_free(thread->stack);
+    free(thread);
+}
+
+static void uthread_start(void *arg) {
+    uthread_t *thread = arg;
+    thread->fn(thread->arg);
+    uthread_exit();
+}
+
+// Leave the current green thread for the vCPU's dispatch loop
+static void uthread_switch_out(uthread_t *thread) {
+    uthread_cpu_t *cpu = uthread_this_cpu();
+    uthread_context_switch(&thread->context, &cpu->context);
+}
+
+// Initialize the green-thread runtime
+int uthread_runtime_init(void) {
+    if (uthread_state.initialized) {
+        return 0;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    uthread_state.page_size = page_size > 0 ? (size_t)page_size : 4096;
+    uthread_state.procs = NULL;
+    uthread_state.stack_cached = 0;
+    uthread_state.initialized = true;
+
+    scheduler_set_dispatch(uthread_dispatch);
+    printf("Green threads initialized (%d KB stacks)\n", MIRIX_UTHREAD_STACK_SIZE / 1024);
+    return 0;
+}
+
+// Release runtime state; the scheduler must already be stopped
+void uthread_runtime_cleanup(void) {
+    if (!uthread_state.initialized) {
+        return;
+    }
+
+    scheduler_set_dispatch(NULL);
+
+    uthread_proc_t *proc = uthread_state.procs;
+    while (proc) {
+        uthread_proc_t *next = proc->next;
+        mirix_process_t *process = scheduler_find_process(proc->pid);
+        if (process) {
+            process->user_threads = NULL;
+        }
+        pthread_mutex_destroy(&proc->lock);
+        free(proc);
+        proc = next;
+    }
+    uthread_state.procs = NULL;
+
+    for (int i = 0; i < uthread_state.stack_cached; i++) {
+        munmap(uthread_state.stack_cache[i], MIRIX_UTHREAD_STACK_SIZE + uthread_state.page_size);
+    }
+    uthread_state.stack_cached = 0;
+    uthread_state.initialized = false;
+}
+
+// Create a green thread in a process
+uthread_t* uthread_create(uint32_t pid, uthread_fn fn, void *arg) {
+    if (!uthread_state.initialized || !fn) {
+        return NULL;
+    }
+
+    uthread_proc_t *proc = uthread_proc_get(pid);
+    if (!proc) {
+        return NULL;
+    }
+
+    uthread_t *thread = calloc(1, sizeof(uthread_t));
+    if (!thread) {
+        return NULL;
+    }
+
+    thread->stack = uthread_stack_alloc();
+    if (!thread->stack) {
+        free(thread);
+        return NULL;
+    }
+
+    thread->proc = proc;
+    thread->fn = fn;
+    thread->arg = arg;
+    if (uthread_context_init(thread, uthread_start, MIRIX_UTHREAD_STACK_SIZE) < 0) {
+        uthread_stack_free(thread->stack);
+        free(thread);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&proc->lock);
+    uthread_make_ready(proc, thread);
+    pthread_mutex_unlock(&proc->lock);
+    return thread;
+}
+
+// Wait for a thread to finish and free it
+int uthread_join(uthread_t *thread) {
+    uthread_t *self = uthread_self();
+    if (!thread || !self || thread == self || thread->proc != self->proc) {
+        return -1;
+    }
+
+    uthread_proc_t *proc = thread->proc;
+    pthread_mutex_lock(&proc->lock);
+    if (thread->detached || thread->joiner) {
+        pthread_mutex_unlock(&proc->lock);
+        return -1;
+    }
+    thread->joiner = self;
+    while (thread->state != UTHREAD_DONE) {
+        // Exit unparks the joiner; the permit covers an exit that races us
+        pthread_mutex_unlock(&proc->lock);
+        uthread_park();
+        pthread_mutex_lock(&proc->lock);
+    }
+    pthread_mutex_unlock(&proc->lock);
+
+    uthread_reclaim(thread);
+    return 0;
+}
+
+// Let the thread free itself when it finishes
+int uthread_detach(uthread_t *thread) {
+    if (!thread) {
+        return -1;
+    }
+
+    uthread_proc_t *proc = thread->proc;
+    pthread_mutex_lock(&proc->lock);
+    if (thread->detached || thread->joiner) {
+        pthread_mutex_unlock(&proc->lock);
+        return -1;
+    }
+    bool done = thread->state == UTHREAD_DONE;
+    thread->detached = true;
+    pthread_mutex_unlock(&proc->lock);
+
+    if (done) {
+        uthread_reclaim(thread);
+    }
+    return 0;
+}
+
+// Give the rest of this turn to the next ready thread of the process
+void uthread_yield(void) {
+    uthread_t *self = uthread_self();
+    if (!self) {
+        return;
+    }
+
+    pthread_mutex_lock(&self->proc->lock);
+    uthread_make_ready(self->proc, self);
+    pthread_mutex_unlock(&self->proc->lock);
+    uthread_switch_out(self);
+}
+
+// Finish the current thread
+void uthread_exit(void) {
+    uthread_t *self = uthread_self();
+    if (!self) {
+        pthread_exit(NULL);
+    }
+
+    // Dispatch marks the thread done, wakes the joiner and frees a detached
+    // thread once we are off this stack
+    self->exited = true;
+    uthread_switch_out(self);
+    abort();
+}
+
+// Current green thread, or NULL on a host thread
+uthread_t* uthread_self(void) {
+    return uthread_this_cpu()->current;
+}
+
+// Sleep until uthread_unpark
+void uthread_park(void) {
+    uthread_t *self = uthread_self();
+    if (!self) {
+        return;
+    }
+
+    pthread_mutex_lock(&self->proc->lock);
+    if (self->wake_pending) {
+        self->wake_pending = false;
+        pthread_mutex_unlock(&self->proc->lock);
+        return;
+    }
+    self->state = UTHREAD_PARKED;
+    pthread_mutex_unlock(&self->proc->lock);
+    uthread_switch_out(self);
+}
+
+// Wake a parked thread, or let its next park return at once
+void uthread_unpark(uthread_t *thread) {
+    if (!thread) {
+        return;
+    }
+
+    uthread_proc_t *proc = thread->proc;
+    pthread_mutex_lock(&proc->lock);
+    if (thread->state == UTHREAD_PARKED) {
+        uthread_make_ready(proc, thread);
+    } else if (thread->state != UTHREAD_DONE) {
+        thread->wake_pending = true;
+    }
+    pthread_mutex_unlock(&proc->lock);
+}
+
+// Scheduler dispatch hook: run the process's ready green threads on this
+// vCPU until the quantum is used up, a deadline task needs the vCPU, or
+// none are left
+static void uthread_dispatch(mirix_process_t *process, int cpu_id) {
+    uthread_proc_t *proc = (uthread_proc_t *)__atomic_load_n(&process->user_threads, __ATOMIC_ACQUIRE);
+    if (!proc) {
+        // No green threads (a program running on the host): take it off
+        // the run queues. uthread_proc_get creates the queue idle under
+        // the same lock, so the first thread created wakes it again.
+        pthread_mutex_lock(&uthread_state.lock);
+        if (!__atomic_load_n(&process->user_threads, __ATOMIC_ACQUIRE)) {
+            scheduler_set_status(process->pid, MIRIX_KERNEL_STOPPED);
+            pthread_mutex_unlock(&uthread_state.lock);
+            return;
+        }
+        pthread_mutex_unlock(&uthread_state.lock);
+        proc = (uthread_proc_t *)process->user_threads;
+    }
+
+    uthread_cpu_t *cpu = uthread_this_cpu();
+    uint64_t deadline = uthread_clock_ns() + MIRIX_SCHED_QUANTUM_US * 1000ULL;
+
+    uint32_t switches = 0;
+
+    pthread_mutex_lock(&proc->lock);
+    uthread_t *thread;
+    while ((thread = uthread_pop_ready(proc)) != NULL) {
+        thread->state = UTHREAD_RUNNING;
+        pthread_mutex_unlock(&proc->lock);
+
+        cpu->current = thread;
+        uthread_context_switch(&cpu->context, &thread->context);
+        cpu->current = NULL;
+
+        // Back here after the thread yielded, parked or exited
+        pthread_mutex_lock(&proc->lock);
+        if (thread->exited) {
+            thread->state = UTHREAD_DONE;
+            uthread_t *joiner = thread->joiner;
+            bool detached = thread->detached;
+            pthread_mutex_unlock(&proc->lock);
+
+            if (joiner) {
+                uthread_unpark(joiner);
+            } else if (detached) {
+                uthread_reclaim(thread);
+            }
+            pthread_mutex_lock(&proc->lock);
+        }
+
+        // Reading the clock costs more than a switch, so only check the
+        // quantum every few switches
+        if ((++switches & (MIRIX_UTHREAD_CLOCK_INTERVAL - 1)) == 0 &&
+            (uthread_clock_ns() >= deadline || scheduler_need_resched(cpu_id))) {
+            break;
+        }
+    }
+
+    // Nothing left to run: take the process off the run queues until a
+    // thread is created or unparked
+    if (!proc->ready_head && !proc->idle) {
+        proc->idle = true;
+        scheduler_set_status(proc->pid, MIRIX_KERNEL_STOPPED);
+    }
+    pthread_mutex_unlock(&proc->lock);
+}
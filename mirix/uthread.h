@@ -0,0 +1,48 @@
+#ifndef MIRIX_UTHREAD_H
+#define MIRIX_UTHREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// M:N green threads: any number of user threads per process, run by
+// whichever vCPU thread the scheduler dispatches the process on. Switching
+// between them is a register/stack swap (arch_context_switch), not a host
+// thread switch. Scheduling inside a process is cooperative: a thread runs
+// until it yields, parks, exits or its process's quantum has run out at
+// one of those points.
+
+// Stack per green thread, plus one guard page below it
+#define MIRIX_UTHREAD_STACK_SIZE (64 * 1024)
+
+// Freed stacks kept for reuse
+#define MIRIX_UTHREAD_STACK_CACHE 256
+
+typedef struct uthread uthread_t;
+typedef void (*uthread_fn)(void *arg);
+
+// Runtime API; init installs the scheduler dispatch hook, so call it
+// before scheduler_start()
+int uthread_runtime_init(void);
+void uthread_runtime_cleanup(void);
+
+// Start fn(arg) as a green thread of a process registered with the scheduler
+uthread_t* uthread_create(uint32_t pid, uthread_fn fn, void *arg);
+
+// Wait for a thread of the same process to finish and reclaim it
+int uthread_join(uthread_t *thread);
+
+// Reclaim the thread as soon as it finishes; it can no longer be joined
+int uthread_detach(uthread_t *thread);
+
+// Calls below are made from a green thread
+void uthread_yield(void);
+void uthread_exit(void) __attribute__((noreturn));
+uthread_t* uthread_self(void);
+
+// Block until unparked; an unpark that arrives first is not lost
+void uthread_park(void);
+// Make a parked thread runnable (from any thread, green or host)
+void uthread_unpark(uthread_t *thread);
+
+#endif // MIRIX_UTHREAD_H